@@ -0,0 +1,164 @@
+// Time of the Voronoi dilation used for meshing, serial and split across threads, on synthetic fish masks:
+// an ellipsoidal body with a thin dorsal fin and a forked tail, as a selection of the low resolution volume.
+// The input is read from one vector per dexel ("vectors") and from a PackedVolume ("packed").
+// Rebuild with FISH_DEFORMATION_VOR3D_SWEEP_SET set to 0, 1 or 2 to compare the containers of the sweeps.
+//
+// Usage: bench_dilation [length] [radius] [num_iterations]
+
+#include <vor3d/CompressedVolume.h>
+#include <vor3d/PackedVolume.h>
+#include <vor3d/SweepSet.h>
+#include <vor3d/VoronoiVorPower.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+// Dexels of a fish w voxels long and about w/4 voxels tall and wide, laid out the way
+// Meshing_Menu::dilate_volume builds them: one dexel per (z, y) row with segments along x
+vor3d::CompressedVolume make_fish(int w) {
+    const int h = std::max(w / 4, 8), d = std::max(w / 4, 8);
+    vor3d::CompressedVolume dexels(Eigen::Vector3d(0.0, 0.0, 0.0), Eigen::Vector3d(d, h, w), 1.0, 0);
+
+    auto inside = [&](int x, int y, int z) {
+        const double u = (x + 0.5) / w, v = (y + 0.5) / h - 0.5, s = (z + 0.5) / d - 0.5;
+        // Body, tapering towards the tail
+        const double bx = (u - 0.4) / 0.35, by = v / (0.3 * (1.2 - u)), bz = s / (0.18 * (1.2 - u));
+        if (bx*bx + by*by + bz*bz < 1.0) {
+            return true;
+        }
+        // Dorsal fin, a thin plate above the body
+        if (std::abs(s) < 0.02 && u > 0.3 && u < 0.55 && v > 0.0 && v < 0.45 - (u - 0.3)) {
+            return true;
+        }
+        // Forked tail
+        if (std::abs(s) < 0.03 && u > 0.72 && u < 0.98) {
+            const double spread = (u - 0.72) * 1.6;
+            return std::abs(std::abs(v) - spread) < 0.06;
+        }
+        return false;
+    };
+
+    for (int z = 0; z < d; z++) {
+        for (int y = 0; y < h; y++) {
+            bool outside = true;
+            int seg_entry = 0;
+            for (int x = 0; x <= w; x++) {
+                const bool voxel_inside = x < w && inside(x, y, z);
+                if (outside && voxel_inside) {
+                    seg_entry = x;
+                    outside = false;
+                } else if (!outside && !voxel_inside) {
+                    dexels.appendSegment(z, y, seg_entry, x, -1);
+                    outside = true;
+                }
+            }
+        }
+    }
+    return dexels;
+}
+
+// True if a and b have the same segments, with endpoints at most tolerance apart
+bool same_dexels(const vor3d::CompressedVolume& a, const vor3d::CompressedVolume& b, double tolerance) {
+    if (a.gridSize() != b.gridSize()) {
+        return false;
+    }
+    for (int y = 0; y < a.gridSize()(1); y++) {
+        for (int x = 0; x < a.gridSize()(0); x++) {
+            const std::vector<vor3d::Scalar>& ra = a.at(x, y);
+            const std::vector<vor3d::Scalar>& rb = b.at(x, y);
+            if (ra.size() != rb.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < ra.size(); i++) {
+                if (std::abs(ra[i] - rb[i]) > tolerance) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Volume>
+double run(const Volume& input, double radius, const vor3d::ParallelOptions& parallel,
+           int iterations, vor3d::CompressedVolume& output) {
+    vor3d::VoronoiMorphoVorPower op(parallel);
+    double best_seconds = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        double time_1, time_2;
+        const auto start = std::chrono::steady_clock::now();
+        op.dilation(input, output, radius, time_1, time_2);
+        const auto end = std::chrono::steady_clock::now();
+        best_seconds = std::min(best_seconds, std::chrono::duration<double>(end - start).count());
+    }
+    return best_seconds;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const int length = argc > 1 ? std::atoi(argv[1]) : 256;
+    const double radius = argc > 2 ? std::atof(argv[2]) : 3.0;
+    const int iterations = argc > 3 ? std::atoi(argv[3]) : 3;
+    const int hw = std::max(1, int(std::thread::hardware_concurrency()));
+
+    std::printf("radius %.1f, best of %d runs, %d hardware threads, %s sweep sets\n\n", radius, iterations, hw,
+                vor3d::sweepSetName());
+    std::printf("%-14s %-8s %8s %8s %10s %9s %s\n", "mask", "layout", "threads", "grain", "ms", "speedup",
+                "matches serial");
+
+    // Half, full and double the usual size of the low resolution volume
+    for (int w : { length / 2, length, length * 2 }) {
+        const vor3d::CompressedVolume input = make_fish(w);
+        const vor3d::PackedVolume packed_input(input);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%dx%dx%d", w, int(input.gridSize()(1)), int(input.gridSize()(0)));
+
+        vor3d::ParallelOptions serial;
+        serial.num_threads = 1;
+        vor3d::CompressedVolume reference, output;
+        const double serial_seconds = run(input, radius, serial, iterations, reference);
+        std::printf("%-14s %-8s %8d %8s %10.1f %9.2f %s\n", name, "vectors", 1, "-", serial_seconds * 1e3, 1.0, "yes");
+
+        // Packed endpoints are floats, so its output matches up to single precision rounding
+        vor3d::CompressedVolume packed_reference;
+        const double packed_seconds = run(packed_input, radius, serial, iterations, packed_reference);
+        std::printf("%-14s %-8s %8d %8s %10.1f %9.2f %s\n", name, "packed", 1, "-", packed_seconds * 1e3,
+                    serial_seconds / packed_seconds, same_dexels(packed_reference, reference, 1e-4) ? "yes" : "NO");
+
+        std::vector<int> thread_counts;
+        for (int t = 2; t < hw; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        if (hw > 1) {
+            thread_counts.push_back(hw);
+        }
+        for (int num_threads : thread_counts) {
+            for (int grain : { 1, 4, 8, 16, 32 }) {
+                vor3d::ParallelOptions parallel;
+                parallel.num_threads = num_threads;
+                parallel.grain_size = grain;
+                const double seconds = run(input, radius, parallel, iterations, output);
+                std::printf("%-14s %-8s %8d %8d %10.1f %9.2f %s\n", name, "vectors", num_threads, grain,
+                            seconds * 1e3, serial_seconds / seconds, same_dexels(output, reference, 0.0) ? "yes" : "NO");
+
+                const double packed_parallel_seconds = run(packed_input, radius, parallel, iterations, output);
+                std::printf("%-14s %-8s %8d %8d %10.1f %9.2f %s\n", name, "packed", num_threads, grain,
+                            packed_parallel_seconds * 1e3, serial_seconds / packed_parallel_seconds,
+                            same_dexels(output, packed_reference, 0.0) ? "yes" : "NO");
+            }
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Save and load times of the large arrays of a project (the dilated tet mesh and its geodesic distances)
+// with igl::serialize, as legacy .fish.pro files were written, and with the chunked project file format.
+//
+// Usage: bench_project_io [num_vertices] [output_directory]
+
+#include <utils/project_file.h>
+#include <utils/timer.h>
+
+#include <Eigen/Core>
+#include <igl/serialize.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+
+namespace {
+
+struct TetMesh {
+    Eigen::MatrixXd TV;
+    Eigen::MatrixXi TT;
+    Eigen::MatrixXi TF;
+    Eigen::VectorXi connected_components;
+    Eigen::VectorXd geodesic_dists;
+
+    size_t size_in_bytes() const {
+        return size_t(TV.size()) * sizeof(double) + size_t(TT.size() + TF.size()) * sizeof(int) +
+               size_t(connected_components.size()) * sizeof(int) + size_t(geodesic_dists.size()) * sizeof(double);
+    }
+
+    bool operator==(const TetMesh& other) const {
+        return TV == other.TV && TT == other.TT && TF == other.TF &&
+               connected_components == other.connected_components && geodesic_dists == other.geodesic_dists;
+    }
+};
+
+// A tet mesh has about 5 tets and 2 boundary faces per vertex
+void make_mesh(size_t num_vertices, TetMesh& mesh) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+    std::uniform_int_distribution<int> vertex(0, int(num_vertices) - 1);
+
+    mesh.TV.resize(num_vertices, 3);
+    for (Eigen::Index i = 0; i < mesh.TV.size(); i++) { mesh.TV(i) = coord(rng); }
+    mesh.TT.resize(num_vertices * 5, 4);
+    for (Eigen::Index i = 0; i < mesh.TT.size(); i++) { mesh.TT(i) = vertex(rng); }
+    mesh.TF.resize(num_vertices * 2, 3);
+    for (Eigen::Index i = 0; i < mesh.TF.size(); i++) { mesh.TF(i) = vertex(rng); }
+    mesh.connected_components.setZero(Eigen::Index(num_vertices));
+    mesh.geodesic_dists.resize(Eigen::Index(num_vertices));
+    for (Eigen::Index i = 0; i < mesh.geodesic_dists.size(); i++) { mesh.geodesic_dists(i) = coord(rng); }
+}
+
+void save_igl(const TetMesh& mesh, const std::string& filename) {
+    std::vector<char> buffer;
+    igl::serialize(mesh.TV, std::string("dilated_tet_mesh.TV"), buffer);
+    igl::serialize(mesh.TT, std::string("dilated_tet_mesh.TT"), buffer);
+    igl::serialize(mesh.TF, std::string("dilated_tet_mesh.TF"), buffer);
+    igl::serialize(mesh.connected_components, std::string("dilated_tet_mesh.connected_components"), buffer);
+    igl::serialize(mesh.geodesic_dists, std::string("dilated_tet_mesh.geodesic_dists"), buffer);
+    igl::serialize(buffer, "state", filename, true);
+}
+
+void load_igl(TetMesh& mesh, const std::string& filename) {
+    std::vector<char> buffer;
+    igl::deserialize(buffer, "state", filename);
+    igl::deserialize(mesh.TV, std::string("dilated_tet_mesh.TV"), buffer);
+    igl::deserialize(mesh.TT, std::string("dilated_tet_mesh.TT"), buffer);
+    igl::deserialize(mesh.TF, std::string("dilated_tet_mesh.TF"), buffer);
+    igl::deserialize(mesh.connected_components, std::string("dilated_tet_mesh.connected_components"), buffer);
+    igl::deserialize(mesh.geodesic_dists, std::string("dilated_tet_mesh.geodesic_dists"), buffer);
+}
+
+bool save_project_file(const TetMesh& mesh, const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    ProjectFileWriter writer;
+    if (!writer.open(filename, logger)) {
+        return false;
+    }
+    writer.write_matrix("dilated_tet_mesh.TV", mesh.TV);
+    writer.write_matrix("dilated_tet_mesh.TT", mesh.TT);
+    writer.write_matrix("dilated_tet_mesh.TF", mesh.TF);
+    writer.write_matrix("dilated_tet_mesh.connected_components", mesh.connected_components);
+    writer.write_matrix("dilated_tet_mesh.geodesic_dists", mesh.geodesic_dists);
+    return writer.close();
+}
+
+bool load_project_file(TetMesh& mesh, const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    ProjectFileReader reader;
+    if (!reader.open(filename, logger)) {
+        return false;
+    }
+    return reader.read_matrix("dilated_tet_mesh.TV", mesh.TV) &&
+           reader.read_matrix("dilated_tet_mesh.TT", mesh.TT) &&
+           reader.read_matrix("dilated_tet_mesh.TF", mesh.TF) &&
+           reader.read_matrix("dilated_tet_mesh.connected_components", mesh.connected_components) &&
+           reader.read_matrix("dilated_tet_mesh.geodesic_dists", mesh.geodesic_dists);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const size_t num_vertices = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(2000000);
+    const std::string directory = argc > 2 ? argv[2] : ".";
+    std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("bench_project_io");
+
+    TetMesh mesh;
+    make_mesh(num_vertices, mesh);
+    std::printf("%zu vertices, %.1f MB of mesh arrays\n\n", num_vertices, double(mesh.size_in_bytes()) * 1e-6);
+    std::printf("%-16s %12s %12s %12s %s\n", "format", "save ms", "load ms", "file MB", "round trips");
+
+    const std::string igl_filename = directory + "/bench_project_io.igl.fish.pro";
+    const std::string project_filename = directory + "/bench_project_io.fish.pro";
+
+    TetMesh loaded;
+    Timer timer;
+    save_igl(mesh, igl_filename);
+    const double igl_save = timer.elapsed();
+    timer.reset();
+    load_igl(loaded, igl_filename);
+    const double igl_load = timer.elapsed();
+    const bool igl_ok = loaded == mesh;
+
+    MappedFile igl_file;
+    igl_file.open(igl_filename, logger);
+    std::printf("%-16s %12.1f %12.1f %12.1f %s\n", "igl::serialize", igl_save * 1e3, igl_load * 1e3,
+                double(igl_file.size()) * 1e-6, igl_ok ? "yes" : "NO");
+    igl_file.close();
+
+    loaded = TetMesh();
+    timer.reset();
+    bool ok = save_project_file(mesh, project_filename, logger);
+    const double project_save = timer.elapsed();
+    timer.reset();
+    ok = ok && load_project_file(loaded, project_filename, logger);
+    const double project_load = timer.elapsed();
+    ok = ok && loaded == mesh;
+
+    MappedFile project_file;
+    project_file.open(project_filename, logger);
+    std::printf("%-16s %12.1f %12.1f %12.1f %s\n", "project file", project_save * 1e3, project_load * 1e3,
+                double(project_file.size()) * 1e-6, ok ? "yes" : "NO");
+    project_file.close();
+
+    std::remove(igl_filename.c_str());
+    std::remove(project_filename.c_str());
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Throughput of quantize_to_uint8 for every kernel and sample format.
+//
+// Usage: bench_quantize [num_voxels] [num_iterations]
+
+#include <utils/quantize.h>
+#include <utils/parallel_for.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// Fill a volume with noise over most of the format's range so the clamps are exercised
+void fill_samples(VoxelFormat format, size_t count, std::vector<uint8_t>& out) {
+    out.resize(count * voxel_format_size(format));
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-0.1f, 1.1f);
+    for (size_t i = 0; i < count; i++) {
+        const float v = std::min(std::max(dist(rng), 0.0f), 1.0f);
+        switch (format) {
+        case VoxelFormat::UINT8: out[i] = VoxelTraits<uint8_t>::from_normalized(v); break;
+        case VoxelFormat::UINT16: reinterpret_cast<uint16_t*>(out.data())[i] = VoxelTraits<uint16_t>::from_normalized(v); break;
+        case VoxelFormat::FLOAT32: reinterpret_cast<float*>(out.data())[i] = dist(rng); break;
+        default: break;
+        }
+    }
+}
+
+double run(VoxelFormat format, const std::vector<uint8_t>& in, size_t count, std::vector<uint8_t>& out,
+           unsigned num_threads, QuantizeKernel kernel, int iterations) {
+    // Warm up, this also faults in the output pages
+    quantize_to_uint8(format, in.data(), count, 0.1, 0.9, out.data(), num_threads, kernel);
+
+    double best_seconds = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        quantize_to_uint8(format, in.data(), count, 0.1, 0.9, out.data(), num_threads, kernel);
+        const auto end = std::chrono::steady_clock::now();
+        best_seconds = std::min(best_seconds, std::chrono::duration<double>(end - start).count());
+    }
+    return best_seconds;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(256) * 256 * 256;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::printf("%zu voxels, best of %d runs, best kernel is %s\n\n",
+                count, iterations, quantize_kernel_name(QuantizeKernel::AUTO));
+    std::printf("%-8s %-8s %8s %12s %12s %s\n", "format", "kernel", "threads", "ms", "GB/s in", "matches scalar");
+
+    const QuantizeKernel kernels[] = { QuantizeKernel::SCALAR, QuantizeKernel::SSE2, QuantizeKernel::AVX2 };
+    std::vector<unsigned> thread_counts = { 1 };
+    if (default_num_threads() > 1) {
+        thread_counts.push_back(default_num_threads());
+    }
+    for (VoxelFormat format : { VoxelFormat::UINT8, VoxelFormat::UINT16, VoxelFormat::FLOAT32 }) {
+        std::vector<uint8_t> in, reference(count), out(count);
+        fill_samples(format, count, in);
+        quantize_to_uint8(format, in.data(), count, 0.1, 0.9, reference.data(), 1, QuantizeKernel::SCALAR);
+
+        for (QuantizeKernel kernel : kernels) {
+            if (kernel != QuantizeKernel::SCALAR && best_quantize_kernel() == QuantizeKernel::SCALAR) {
+                continue;
+            }
+            if (kernel == QuantizeKernel::AVX2 && best_quantize_kernel() != QuantizeKernel::AVX2) {
+                continue;
+            }
+            for (unsigned num_threads : thread_counts) {
+                const double seconds = run(format, in, count, out, num_threads, kernel, iterations);
+                const bool matches = std::memcmp(out.data(), reference.data(), count) == 0;
+                std::printf("%-8s %-8s %8u %12.3f %12.2f %s\n",
+                            voxel_format_to_string(format), quantize_kernel_name(kernel), num_threads,
+                            seconds * 1e3, double(in.size()) / seconds * 1e-9, matches ? "yes" : "NO");
+            }
+        }
+    }
+
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <fstream>
 
 #include "datfile.h"
+#include "volume_data.h"
 
 
 bool compute_surface_mesh(DatFile& datfile,
@@ -20,47 +21,42 @@ bool compute_surface_mesh(DatFile& datfile,
   } else  {
     raw_filename = datfile.m_directory + string("/") + datfile.m_raw_filename;
   }
-  assert(datfile.m_format == string("UINT8"));
-
-  const size_t num_datfile_bytes = datfile.w * datfile.h * datfile.d;
-  char* data = new char[num_datfile_bytes];
-  ifstream rawfile(raw_filename, std::ifstream::binary);
-  if (!rawfile.good()) {
-    cerr << "ERROR: RawFile '" << raw_filename << "' does not exist." << endl;
+  const VoxelFormat format = voxel_format_from_string(datfile.m_format);
+  if (format == VoxelFormat::INVALID) {
+    cerr << "ERROR: Unsupported voxel format '" << datfile.m_format << "'." << endl;
     return false;
   }
-  rawfile.read(data, num_datfile_bytes);
-  if (!rawfile) {
-    cout << "ERROR: Only read " << rawfile.gcount() <<
-            " bytes from Raw File '" << datfile.m_raw_filename <<
-            "' but expected to read " << num_datfile_bytes <<
-            " bytes." << endl;
+
+  const size_t num_voxels = size_t(datfile.w) * size_t(datfile.h) * size_t(datfile.d);
+  VolumeData data;
+  if (!data.load(raw_filename, num_voxels, format, spdlog::get("Extract Surface"))) {
     return false;
   }
-  rawfile.close();
 
   cout << "Generating Marching Cubes Input..." << endl;
   Eigen::MatrixXd GP((datfile.w+2)*(datfile.h+2)*(datfile.d+2), 3);
   Eigen::VectorXd SV(GP.rows());
 
-  int readcount = 0;
-  int appendcount = 0;
-  for (int zi = 0; zi < datfile.d+2; zi++) {
-    for (int yi = 0; yi < datfile.h+2; yi++) {
-      for (int xi = 0; xi < datfile.w+2; xi++) {
-        if (xi == 0 || yi == 0 || zi == 0 || xi == (datfile.w+1) ||
-            yi == (datfile.h+1) || zi == (datfile.d+1)) {
-          SV[readcount] = -1.0;
-        } else {
-          SV[readcount] = double((unsigned char)(data[appendcount]));
-          appendcount += 1;
+  // Read the samples in their native type, padded by one voxel of outside on every side
+  data.visit([&](auto* samples) {
+    size_t readcount = 0;
+    size_t appendcount = 0;
+    for (int zi = 0; zi < datfile.d+2; zi++) {
+      for (int yi = 0; yi < datfile.h+2; yi++) {
+        for (int xi = 0; xi < datfile.w+2; xi++) {
+          if (xi == 0 || yi == 0 || zi == 0 || xi == (datfile.w+1) ||
+              yi == (datfile.h+1) || zi == (datfile.d+1)) {
+            SV[readcount] = -1.0;
+          } else {
+            SV[readcount] = double(samples[appendcount]);
+            appendcount += 1;
+          }
+          GP.row(readcount) = Eigen::RowVector3d(xi, yi, zi);
+          readcount += 1;
         }
-        GP.row(readcount) = Eigen::RowVector3d(xi, yi, zi);
-        readcount += 1;
       }
     }
-  }
-  delete data;
+  });
 
   datfile.m_bb_min = Eigen::RowVector3d(1.0, 1.0, 1.0);
   datfile.m_bb_max = Eigen::RowVector3d(datfile.w, datfile.h, datfile.d);
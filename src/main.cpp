@@ -123,7 +123,28 @@ bool pre_draw(igl::opengl::glfw::Viewer& viewer) {
     return false;
 }
 
+// Rewrite a project saved by an older version in the current project file format
+int convert_project(const std::string& in_filename, const std::string& out_filename) {
+    _state.logger = spdlog::stdout_color_mt(FISH_LOGGER_NAME);
+    _state.logger->set_level(FISH_LOGGER_LEVEL);
+    _state.cage.set_logger(_state.logger);
+
+    if (!_state.load_project(in_filename)) {
+        _state.logger->error("Could not read project '{}'", in_filename);
+        return EXIT_FAILURE;
+    }
+    if (!_state.save_project(out_filename)) {
+        return EXIT_FAILURE;
+    }
+    _state.logger->info("Converted '{}' to '{}'", in_filename, out_filename);
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char** argv) {
+    if (argc == 4 && std::string(argv[1]) == "--convert-project") {
+        return convert_project(argv[2], argv[3]);
+    }
+
     previous_state = Application_State::NoState;
     igl::opengl::glfw::Viewer viewer;
     // viewer.core.background_color = Eigen::Vector4f(0.1f, 0.1f, 0.1f, 1.f);
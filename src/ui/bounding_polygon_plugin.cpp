@@ -45,6 +45,8 @@ void Bounding_Polygon_Menu::initialize() {
     // Initialize the 3d volume viewer
     widget_3d.initialize(viewer, this);
     widget_3d.volume_renderer.set_transfer_function(tf_widget.transfer_function());
+    tf_widget.set_histogram(state.low_res_volume.statistics, state.low_res_volume.min_value,
+                            state.low_res_volume.max_value);
 
     exporter.init(128, 128, 1024);
 
@@ -276,28 +278,41 @@ void Bounding_Polygon_Menu::post_draw_save(int window_width) {
 
         state.input_metadata.project_name = save_file_name;
 
-        igl::serialize(state, "state", save_project_path, true);
+        if (!state.save_project(save_project_path)) {
+            state.logger->error("Failed to save project to '{}'", save_project_path);
+        }
+        // Export from the coarsest level of the pyramid with at least as many samples as the output
+        std::vector<double> kf_depths;
+        state.cage.keyframe_depths(kf_depths);
+        const Eigen::Vector4d kfbb = state.cage.keyframe_bounding_box();
+        const double output_scale = std::max({ double(output_dims[0]) / std::max(fabs(kfbb[1] - kfbb[0]), 1.0),
+                                               double(output_dims[1]) / std::max(fabs(kfbb[3] - kfbb[2]), 1.0),
+                                               double(output_dims[2]) / std::max(kf_depths.back(), 1.0) });
+        const State::LoadedVolume& volume = state.volume_level(state.volume_level_for_scale(output_scale));
+        state.logger->info("Exporting from the volume downsampled by {}", volume.level_factor);
+
         DatFile out_datfile;
         out_datfile.w = output_dims[0];
         out_datfile.h = output_dims[1];
         out_datfile.d = output_dims[2];
         out_datfile.m_raw_filename = save_file_name + ".raw";
-        out_datfile.m_format = "UINT8";
+        out_datfile.m_format = voxel_format_to_string(volume.texture_format());
         out_datfile.serialize(save_datfile_path, state.logger);
 
         {
-            glBindTexture(GL_TEXTURE_3D, state.hi_res_volume.volume_texture);
+            glBindTexture(GL_TEXTURE_3D, volume.volume_texture);
             GLint old_min_filter, old_mag_filter;
             glGetTexParameteriv(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, &old_min_filter);
             glGetTexParameteriv(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, &old_mag_filter);
             glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glBindTexture(GL_TEXTURE_3D, 0);
+            exporter.set_export_format(volume.texture_format());
             exporter.set_export_dims(output_dims[0], output_dims[1], output_dims[2]);
-            exporter.update(state.cage, state.hi_res_volume.volume_texture, G3f(state.low_res_volume.dims()));
+            exporter.update(state.cage, volume.texture_binding(), G3f(state.low_res_volume.dims()));
             exporter.write_texture_data_to_file(save_rawfile_path);
             cage_dirty = true;
-            glBindTexture(GL_TEXTURE_3D, state.hi_res_volume.volume_texture);
+            glBindTexture(GL_TEXTURE_3D, volume.volume_texture);
             glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, old_min_filter);
             glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, old_mag_filter);
             glBindTexture(GL_TEXTURE_3D, 0);
@@ -345,8 +360,10 @@ bool Bounding_Polygon_Menu::post_draw() {
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         exporter.set_export_dims(width, height, depth);
-        GLuint tex = use_hires_texture ? state.hi_res_volume.volume_texture : state.low_res_volume.volume_texture;
-        exporter.update(state.cage, tex, G3i(state.low_res_volume.dims()));
+        // The straightened volume has export_rescale_factor samples per low resolution voxel
+        const int level = use_hires_texture ? state.volume_level_for_scale(widget_3d.export_rescale_factor)
+                                            : state.num_volume_levels() - 1;
+        exporter.update(state.cage, state.volume_level(level).texture_binding(), G3i(state.low_res_volume.dims()));
 
         glBindTexture(GL_TEXTURE_3D, state.low_res_volume.volume_texture);
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, old_min_filter);
@@ -486,9 +503,18 @@ bool Bounding_Polygon_Menu::post_draw() {
         }
     }
     ImGui::SameLine();
-    if (ImGui::Checkbox("Show Hi-Res Texture", &use_hires_texture)) {
+    if (ImGui::Checkbox("Show Finer Texture Levels", &use_hires_texture)) {
         cage_dirty = true;
     }
+    if (ImGui::Checkbox("Lighting", &lighting)) {
+        widget_3d.volume_renderer.set_lighting(lighting);
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Skip Empty Space", &skip_empty_space)) {
+        widget_3d.volume_renderer.set_empty_space_skipping(skip_empty_space);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Frame time: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
 
     bool pushed_disabled_style = false;
     if (show_edit_transfer_function) {
@@ -35,6 +35,8 @@ public:
     VolumeExporter exporter;
 
     bool use_hires_texture = true;
+    bool skip_empty_space = true;
+    bool lighting = false;
 private:
 
     void post_draw_save(int window_width);
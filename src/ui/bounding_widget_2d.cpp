@@ -11,6 +11,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
+#include <glm/gtx/component_wise.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 #include <vector>
@@ -71,7 +72,6 @@ in vec3 uv;
 
 out vec4 out_color;
 
-uniform sampler3D tex;
 uniform sampler1D tf;
 
 void main() {
@@ -80,7 +80,7 @@ void main() {
         out_color = vec4(0.0, 0.0, 0.0, 0.0);
     }
     else {
-        float v = texture(tex, uv).r;
+        float v = sample_volume(uv);
         out_color = vec4(vec3(v), 1.0);
     }
 }
@@ -237,14 +237,14 @@ void Bounding_Polygon_Widget::initialize(igl::opengl::glfw::Viewer* viewer, Boun
     this->parent = parent;
 
     igl::opengl::create_shader_program(PlaneVertexShader,
-                                       PlaneFragmentShader, {}, plane.program);
+                                       add_volume_sampling_glsl(PlaneFragmentShader), {}, plane.program);
 
     plane.window_size_location = glGetUniformLocation(plane.program, "window_size");
     plane.ll_location = glGetUniformLocation(plane.program, "ll");
     plane.lr_location = glGetUniformLocation(plane.program, "lr");
     plane.ul_location = glGetUniformLocation(plane.program, "ul");
     plane.ur_location = glGetUniformLocation(plane.program, "ur");
-    plane.texture_location = glGetUniformLocation(plane.program, "tex");
+    plane.volume.init(plane.program);
     plane.tf_location = glGetUniformLocation(plane.program, "tf");
 
     glGenVertexArrays(1, &empty_vao);
@@ -591,10 +591,12 @@ bool Bounding_Polygon_Widget::post_draw(BoundingCage::KeyFrameIterator kf, bool
         glUniform3fv(plane.ul_location, 1, glm::value_ptr(ul));
         glUniform3fv(plane.ur_location, 1, glm::value_ptr(ur));
 
-        glActiveTexture(GL_TEXTURE0);
-        GLuint tex = parent->use_hires_texture ? state.hi_res_volume.volume_texture : state.low_res_volume.volume_texture;
-        glBindTexture(GL_TEXTURE_3D, tex);
-        glUniform1i(plane.texture_location, 0);
+        // The slice spans 2*zoom low resolution voxels across the texture, sample it from the pyramid level
+        // with about one voxel per pixel
+        const double pixels_per_voxel = double(glm::compMax(offscreen.texture_size)) / (2.0 * view.zoom);
+        const int level = parent->use_hires_texture ? state.volume_level_for_scale(pixels_per_voxel)
+                                                    : state.num_volume_levels() - 1;
+        bind_volume_texture(plane.volume, state.volume_level(level).texture_binding(), 0);
 
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
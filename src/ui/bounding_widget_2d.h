@@ -100,7 +100,7 @@ private:
         GLint ul_location = -1;
         GLint ur_location = -1;
 
-        GLint texture_location = -1;
+        VolumeSamplingUniforms volume;
         GLint tf_location = -1;
     } plane;
 
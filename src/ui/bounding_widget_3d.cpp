@@ -367,8 +367,15 @@ bool Bounding_Widget_3d::post_draw_curved(const glm::vec4& viewport, BoundingCag
 
     glViewport(viewport_pos.x, viewport_pos.y, viewport_size.x, viewport_size.y);
 
-    volume_renderer.set_step_size(1.0 / glm::length(glm::vec3(volume_dims)));
-    volume_renderer.begin(volume_dims, _state.low_res_volume.volume_texture);
+    // Render from the pyramid level with about one voxel per pixel of the volume on screen
+    const double pixels_per_voxel = double(glm::compMax(viewport_size)) * double(_viewer->core.camera_zoom) /
+                                    double(glm::compMax(volume_dims));
+    const int level = _parent->use_hires_texture ? _state.volume_level_for_scale(pixels_per_voxel)
+                                                 : _state.num_volume_levels() - 1;
+    const State::LoadedVolume& level_volume = _state.volume_level(level);
+    const glm::ivec3 level_dims = G3i(level_volume.dims());
+    volume_renderer.set_step_size(1.0 / glm::length(glm::vec3(level_dims)));
+    volume_renderer.begin(level_dims, level_volume.texture_binding());
     for (int i = 0; i < sorted_cells.size(); i++) {
         auto cell = sorted_cells[i];
         Eigen::MatrixXd cV = cell->mesh_vertices();
@@ -12,6 +12,8 @@
 #include <utils/string_utils.h>
 #include <imgui/imgui_internal.h>
 
+#include <algorithm>
+
 extern Meshing_Menu meshing_menu;
 
 Initial_File_Selection_Menu::Initial_File_Selection_Menu(State& state) : _state(state) {}
@@ -70,30 +72,47 @@ bool Initial_File_Selection_Menu::post_draw() {
         ImGui::BeginPopupModal("Loading CT Scan");
         ImGui::Text("Loading CT Scan. Please wait as this can take a few seconds.");
         ImGui::NewLine();
+        if (ingest_progress.slices_total > 0) {
+            ImGui::Text("Reading image slices (%.1f slices/s):", ingest_progress.slices_per_second.load());
+            ImGui::ProgressBar(ingest_progress.fraction());
+        }
+        ImGui::Text("Low resolution volume:");
+        ImGui::ProgressBar(low_res_progress.fraction());
+        ImGui::Text("Full resolution volume:");
+        ImGui::ProgressBar(hi_res_progress.fraction());
+        if (low_res_progress.fraction() >= 1.0f && !done_loading) {
+            ImGui::Text("Computing topological features...");
+        }
+        if (is_uploading) {
+            ImGui::Text("Uploading to the GPU:");
+            ImGui::ProgressBar(texture_uploader.fraction());
+        }
+        ImGui::NewLine();
         ImGui::EndPopup();
 
-        if (done_loading) {
-            // Volume texture
-            if (_state.low_res_volume.volume_texture == 0) {
-                _state.logger->debug("Creating low resolution volume texture...");
-                glGenTextures(1, &_state.low_res_volume.volume_texture);
+        // Keep redrawing so the progress bars move
+        glfwPostEmptyEvent();
+
+        if (done_loading && !is_uploading) {
+            // Create the textures and queue their contents, they are streamed over the next frames
+            _state.logger->debug("Uploading volume textures...");
+            texture_uploader.init();
+            _state.low_res_volume.upload_gl_volume_texture(texture_uploader);
+            _state.low_res_volume.upload_gl_index_texture(texture_uploader);
+            _state.low_res_volume.upload_gl_gradient_texture(texture_uploader);
+            _state.hi_res_volume.upload_gl_volume_texture(texture_uploader);
+            _state.hi_res_volume.upload_gl_gradient_texture(texture_uploader);
+            for (State::LoadedVolume& level : _state.mid_res_volumes) {
+                level.upload_gl_volume_texture(texture_uploader);
+                level.upload_gl_gradient_texture(texture_uploader);
             }
-            _state.logger->debug("Creating low resolution volume texture...");
-            _state.low_res_volume.load_gl_volume_texture(low_res_byte_data);
-
-            _state.logger->debug("Creating low resolution index texture...");
-            _state.low_res_volume.load_gl_index_texture();
-
-            if (_state.hi_res_volume.volume_texture == 0) {
-                _state.logger->debug("Creating high resolution volume texture...");
-                glGenTextures(1, &_state.hi_res_volume.volume_texture);
-            }
-            _state.logger->debug("Creating high resolution volume texture...");
-            _state.hi_res_volume.load_gl_volume_texture(high_res_byte_data);
-
-            low_res_byte_data.clear();
-            high_res_byte_data.clear();
+            is_uploading = true;
+        }
 
+        if (is_uploading && texture_uploader.step()) {
+            _state.logger->debug("Done uploading volume textures.");
+            texture_uploader.destroy();
+            is_uploading = false;
             is_loading = false;
             done_loading = false;
             glBindTexture(GL_TEXTURE_3D, 0);
@@ -177,6 +196,18 @@ bool Initial_File_Selection_Menu::post_draw() {
             _state.dirty_flags.file_loading_dirty = true;
         }
         ImGui::PopItemWidth();
+
+        ImGui::Spacing();
+        ImGui::Text("Contour Tree Downsampling Factor:");
+        ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.8f);
+        if (ImGui::InputInt("##Contour Tree Downsample Factor", &_state.input_metadata.contour_tree_factor)) {
+            _state.input_metadata.contour_tree_factor = std::max(_state.input_metadata.contour_tree_factor, 1);
+            _state.dirty_flags.file_loading_dirty = true;
+        }
+        ImGui::PopItemWidth();
+
+        ImGui::Spacing();
+        ImGui::Checkbox("Compress Full Resolution Volume", &_state.input_metadata.compress_full_res);
         ImGui::NewLine();
 
     } else {
@@ -209,6 +240,10 @@ bool Initial_File_Selection_Menu::post_draw() {
         show_new_scan_menu = true;
     }
 
+    ImGui::Spacing();
+    ImGui::Checkbox("Compact 8-bit Volume Texture", &_state.hi_res_volume.compact_texture);
+    ImGui::Checkbox("Precompute Gradients for Lighting", &_state.hi_res_volume.precompute_gradients);
+
     if (debug.enabled) {
         ImGui::Text("RawFile:");
         ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.8f);
@@ -234,13 +269,14 @@ bool Initial_File_Selection_Menu::post_draw() {
             _state.logger->trace("Hacking rawfile {}", debug.rawfile_path);
             _state.low_res_volume.metadata = DatFile(debug.rawfile_path, _state.logger);
             std::string rawfile_path = pathinfo.first + std::string("/") + _state.low_res_volume.metadata.m_raw_filename;
-            load_rawfile(rawfile_path, _state.low_res_volume.dims(),
-                         _state.low_res_volume.volume_data, _state.logger, true /* normalize */);
-            _state.low_res_volume.preprocess_volume_texture(low_res_byte_data);
+            _state.low_res_volume.volume_data.load(rawfile_path, _state.low_res_volume.num_voxels(),
+                                                   voxel_format_from_string(_state.low_res_volume.metadata.m_format),
+                                                   _state.logger);
+            _state.low_res_volume.volume_data.prefetch(nullptr, &_state.low_res_volume.statistics);
+            _state.low_res_volume.min_value = _state.low_res_volume.statistics.min_value;
+            _state.low_res_volume.max_value = _state.low_res_volume.statistics.max_value;
             _state.hi_res_volume = _state.low_res_volume;
-
-            load_rawfile(rawfile_path, _state.hi_res_volume.dims(), high_res_byte_data, _state.logger);
-            load_rawfile(rawfile_path, _state.hi_res_volume.dims(), low_res_byte_data, _state.logger);
+            _state.mid_res_volumes.clear();
 
             _state.logger->trace("Hacking metadata");
             _state.input_metadata.input_dir = pathinfo.first;
@@ -256,7 +292,7 @@ bool Initial_File_Selection_Menu::post_draw() {
                 glGenTextures(1, &_state.low_res_volume.volume_texture);
             }
             _state.logger->debug("Hacking low resolution volume texture...");
-            _state.low_res_volume.load_gl_volume_texture(low_res_byte_data);
+            _state.low_res_volume.load_gl_volume_texture();
 
             _state.logger->debug("Hacking low resolution index texture...");
             _state.low_res_volume.load_gl_index_texture();
@@ -266,12 +302,9 @@ bool Initial_File_Selection_Menu::post_draw() {
                 glGenTextures(1, &_state.hi_res_volume.volume_texture);
             }
             _state.logger->debug("Hacking high resolution volume texture...");
-            _state.hi_res_volume.load_gl_volume_texture(high_res_byte_data);
-
-            low_res_byte_data.clear();
-            high_res_byte_data.clear();
+            _state.hi_res_volume.load_gl_volume_texture();
 
-            meshing_menu.debug.masking_volume_hack = _state.hi_res_volume.volume_data;
+            _state.hi_res_volume.volume_data.normalized_copy(meshing_menu.debug.masking_volume_hack);
             meshing_menu.debug.enabled = true;
             _state.dirty_flags.file_loading_dirty = false;
             _state.set_application_state(Application_State::Meshing);
@@ -314,24 +347,51 @@ bool Initial_File_Selection_Menu::post_draw() {
         }
 
         auto thread_fun = [&]() {
+            // Show the error and close the loading popup, so the input can be fixed and loaded again
+            auto fail_loading = [&](const std::string& message) {
+                error_message = message;
+                show_error_popup = true;
+                done_loading = false;
+                is_loading = false;
+                glfwPostEmptyEvent();
+            };
+
+            ingest_progress.reset();
             // load_volume_data clears _state.segmented_features.selected_features which we don't want to do
             // if we're deserializing. So we'll back it up and restore it.
             std::vector<uint32_t> selected_features_backup;
 
             if (show_new_scan_menu) {
                 mkpath(_state.input_metadata.output_dir.c_str(), 0777 /* mode */);
-                ImageData::writeOutput(_state.input_metadata.input_dir, _state.input_metadata.prefix,
-                                       _state.input_metadata.start_index, _state.input_metadata.end_index,
-                                       _state.input_metadata.file_extension, _state.input_metadata.output_dir,
-                                       _state.input_metadata.full_res_prefix(),
-                                       _state.input_metadata.low_res_prefix(),
-                                       _state.input_metadata.downsample_factor,
-                                       true /* write_original */);
+                ImageStack stack;
+                stack.directory = _state.input_metadata.input_dir;
+                stack.prefix = _state.input_metadata.prefix;
+                stack.extension = _state.input_metadata.file_extension;
+                stack.start_index = _state.input_metadata.start_index;
+                stack.end_index = _state.input_metadata.end_index;
+                stack.index_width = _state.input_metadata.index_width;
+
+                // Every level of the volume pyramid is written in the same pass over the images
+                std::vector<IngestOutput> outputs;
+                const std::vector<int> factors = _state.input_metadata.pyramid_factors();
+                for (size_t i = 0; i < factors.size(); i++) {
+                    IngestOutput output;
+                    output.path_prefix = i + 1 == factors.size() ? _state.input_metadata.low_res_path_prefx()
+                                                                 : _state.input_metadata.level_path_prefix(factors[i]);
+                    output.factor = factors[i];
+                    output.compress = i == 0 && _state.input_metadata.compress_full_res;
+                    outputs.push_back(output);
+                }
+                if (!ingest_image_stack(stack, outputs, _state.logger, &ingest_progress)) {
+                    fail_loading("Error: The scan images could not be read.");
+                    return;
+                }
                 _state.input_metadata.project_name = "";
+                _state.low_res_volume.statistics.clear();
+                _state.hi_res_volume.statistics.clear();
             } else {
-                if (!igl::deserialize(_state, "state", std::string(existing_project_path_buf))) {
-                    show_error_popup = true;
-                    error_message = "Existing project must be a valid project file";
+                if (!_state.load_project(std::string(existing_project_path_buf))) {
+                    fail_loading("Existing project must be a valid project file");
                     return;
                 }
 
@@ -345,11 +405,72 @@ bool Initial_File_Selection_Menu::post_draw() {
                 _state.input_metadata.file_extension = "";
             }
 
-            _state.load_volume_data(_state.low_res_volume, _state.input_metadata.low_res_prefix(), true /* load topological features */);
-            _state.low_res_volume.preprocess_volume_texture(low_res_byte_data);
-
-            _state.hi_res_volume.metadata = DatFile(_state.input_metadata.full_res_path_prefix() + ".dat", _state.logger);
-            load_rawfile(_state.input_metadata.full_res_path_prefix() + ".raw", _state.hi_res_volume.dims(), high_res_byte_data, _state.logger);
+            low_res_progress.reset();
+            hi_res_progress.reset();
+
+            // The hi-res volume stays memory mapped (or compressed) and is uploaded in its native format.
+            // 8-bit scans are shown as is, deeper ones are stretched to their value range.
+            // It is read concurrently with the low-res volume and its topological features.
+            bool hi_res_failed = false;
+            std::thread hi_res_thread([&]() {
+                State::LoadedVolume& hi_res_volume = _state.hi_res_volume;
+                hi_res_volume.metadata = DatFile(_state.input_metadata.full_res_path_prefix() + ".dat", _state.logger);
+                if (!_state.load_volume_samples(hi_res_volume, true /* keep_compressed */, &hi_res_progress)) {
+                    hi_res_failed = true;
+                    return;
+                }
+                if (hi_res_volume.format() == VoxelFormat::UINT8) {
+                    hi_res_volume.min_value = 0.0;
+                    hi_res_volume.max_value = 1.0;
+                }
+                hi_res_volume.prepare_gl_volume_texture(max_texture_size);
+                hi_res_volume.level_factor = 1;
+
+                // The intermediate levels of the pyramid are small next to the full resolution volume.
+                // They are shown with the display range of the full resolution volume.
+                std::vector<State::LoadedVolume>& mid_res_volumes = _state.mid_res_volumes;
+                const std::vector<int> factors = _state.input_metadata.pyramid_factors();
+                size_t num_levels = 0;
+                for (size_t i = 1; i + 1 < factors.size(); i++) {
+                    const std::string datfile_path = _state.input_metadata.level_path_prefix(factors[i]) + ".dat";
+                    if (get_file_type(datfile_path.c_str()) != FT_REGULAR_FILE) {
+                        break;
+                    }
+                    mid_res_volumes.resize(num_levels + 1);
+                    State::LoadedVolume& level = mid_res_volumes[num_levels];
+                    level.metadata = DatFile(datfile_path, _state.logger);
+                    level.statistics.clear();
+                    if (!_state.load_volume_samples(level, false /* keep_compressed */, nullptr)) {
+                        break;
+                    }
+                    level.level_factor = factors[i];
+                    level.min_value = hi_res_volume.min_value;
+                    level.max_value = hi_res_volume.max_value;
+                    level.compact_texture = hi_res_volume.compact_texture;
+                    level.precompute_gradients = hi_res_volume.precompute_gradients;
+                    level.prepare_gl_volume_texture(max_texture_size);
+                    num_levels += 1;
+                }
+                mid_res_volumes.resize(num_levels);
+                _state.logger->debug("Loaded {} intermediate volume levels", num_levels);
+            });
+
+            const bool low_res_ok = _state.load_volume_data(_state.low_res_volume, _state.input_metadata.low_res_prefix(),
+                                                            true /* load topological features */, &low_res_progress);
+            if (low_res_ok) {
+                _state.low_res_volume.level_factor = std::max(_state.input_metadata.downsample_factor, 1);
+                _state.low_res_volume.precompute_gradients = _state.hi_res_volume.precompute_gradients;
+                _state.low_res_volume.prepare_gl_volume_texture(max_texture_size);
+            }
+            hi_res_thread.join();
+            if (!low_res_ok) {
+                fail_loading("Error: The low resolution volume or its topological features could not be loaded.");
+                return;
+            }
+            if (hi_res_failed) {
+                fail_loading("Error: The full resolution volume could not be loaded.");
+                return;
+            }
 
              if (!show_new_scan_menu) {
                  _state.segmented_features.selected_features = selected_features_backup;
@@ -375,6 +496,7 @@ bool Initial_File_Selection_Menu::post_draw() {
             }
         }
 
+        glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_texture_size);
         is_loading = true;
         _state.timing_logger->info("END_INTERACT FILE_SELECTION {}", _timer.elapsed());
         done_loading = false;
@@ -481,5 +603,7 @@ bool Initial_File_Selection_Menu::process_new_project_form() {
     _state.input_metadata.prefix = prefix;
     _state.input_metadata.start_index = first_index;
     _state.input_metadata.end_index = last_index;
+    _state.input_metadata.index_width =
+        first_index_str.size() == last_index_str.size() ? int(first_index_str.size()) : 0;
     return true;
 }
@@ -7,7 +7,10 @@
 #include <thread>
 
 #include <utils/utils.h>
+#include <utils/image_stack.h>
+#include <utils/volume_data.h>
 #include <utils/timer.h>
+#include <utils/gl/texture_uploader.h>
 
 struct State;
 
@@ -33,12 +36,20 @@ private:
 
     bool show_new_scan_menu = true;
 
-    std::vector<uint8_t> low_res_byte_data;
-    std::vector<uint8_t> high_res_byte_data;
+    // Progress of the volumes being read by the loading thread, shown in the loading popup
+    IngestProgress ingest_progress;
+    VolumeLoadProgress low_res_progress;
+    VolumeLoadProgress hi_res_progress;
+
     std::atomic_bool done_loading;
     std::atomic_bool is_loading;
     std::thread loading_thread;
 
+    // Once loading is done the textures are streamed to the GPU over several frames
+    TextureUploader texture_uploader;
+    bool is_uploading = false;
+    int max_texture_size = 0;
+
     bool process_new_project_form();
 
     struct {
@@ -5,6 +5,8 @@
 #include "state.h"
 #include "trimesh.h"
 
+#include <utils/parallel_for.h>
+
 #include <Eigen/Core>
 #include <GLFW/glfw3.h>
 #include <igl/boundary_facets.h>
@@ -13,38 +15,46 @@
 #include <igl/writeOBJ.h>
 #include <igl/copyleft/marching_cubes.h>
 #include <imgui/imgui.h>
+#include <utility>
 #include <vector>
 #include <vor3d/CompressedVolume.h>
 #include <vor3d/VoronoiVorPower.h>
 
 namespace {
 
-void volume_to_dexels(const Eigen::VectorXf& scalars, Eigen::RowVector3i volume_size,
-                      vor3d::CompressedVolume& dexels)
+// Rows of voxels converted to dexels per task
+constexpr size_t DEXEL_ROWS_PER_CHUNK = 64;
+
+// Emit the runs of voxels for which inside(voxel_index) is true along each x row as the segments
+// of the dexel for that row. Rows map to distinct dexels, so they are converted in parallel.
+template <typename InsideFn>
+void volume_to_dexels(Eigen::RowVector3i volume_size, const InsideFn& inside, vor3d::CompressedVolume& dexels)
 {
     const int w = volume_size[0], h = volume_size[1], d = volume_size[2];
     dexels = vor3d::CompressedVolume(Eigen::Vector3d(0.0, 0.0, 0.0),
         Eigen::Vector3d(d, h, w), 1.0, 0);
 
-    int start_idx = 0;
-    for (int z = 0; z < d; z++) {
-        for (int y = 0; y < h; y++) {
+    parallel_for_chunks(0, size_t(d) * size_t(h), DEXEL_ROWS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            const int z = int(row / size_t(h));
+            const int y = int(row % size_t(h));
+            size_t start_idx = row * size_t(w);
             bool outside = true;
             int seg_entry = 0;
             for (int x = 0; x < w; x++) {
-                if (outside && scalars[start_idx] > 0.0) {
+                const bool voxel_inside = inside(start_idx);
+                if (outside && voxel_inside) {
                     seg_entry = x;
                     outside = false;
                 }
-                else if (!outside && scalars[start_idx] <= 0.0) {
+                else if (!outside && !voxel_inside) {
                     dexels.appendSegment(z, y, seg_entry, x, -1);
                     outside = true;
                 }
                 start_idx += 1;
             }
         }
-    }
-
+    });
 }
 
 void dexels_to_mesh(int n_samples, const vor3d::CompressedVolume& dexels,
@@ -125,22 +135,11 @@ void Meshing_Menu::initialize() {
 
         if (!debug.enabled) {
             std::vector<uint32_t> feature_list = _state.segmented_features.selected_features;
-            // The feature list used in export_selected_volume uses a zero-based indexing, we use
+            // The feature list used in select_feature_arcs uses a zero-based indexing, we use
             // 0 for the non-feature, so we have to convert into the zero-based indexing here
             std::transform(feature_list.begin(), feature_list.end(), feature_list.begin(),
                 [](uint32_t v) { return v - 1; });
-            export_selected_volume(feature_list);
-        } else {
-            skeleton_masking_volume = debug.masking_volume_hack;
-            for (int i = 0; i < skeleton_masking_volume.size(); ++i) {
-                unsigned int idx = _state.low_res_volume.index_data[i];
-                if (skeleton_masking_volume[i] != 0.0) {
-                    skeleton_masking_volume[i] = 1.0;
-                }
-                else {
-                    skeleton_masking_volume[i] = -1.0;
-                }
-            }
+            select_feature_arcs(feature_list);
         }
         dilate_volume();
         if (extracted_surface.V_fat.rows() == 0) {
@@ -217,16 +216,36 @@ bool Meshing_Menu::post_draw() {
 
 
 void Meshing_Menu::dilate_volume() {
-    vor3d::CompressedVolume input;
-    volume_to_dexels(skeleton_masking_volume, _state.low_res_volume.dims(), input);
-
-    vor3d::VoronoiMorphoVorPower op = vor3d::VoronoiMorphoVorPower();
+    // Each operation reads one of these and writes the other. Erosions negate their input in place,
+    // so cleaning up the selection never copies a whole volume.
+    vor3d::CompressedVolume front, back;
+    volume_to_dexels(_state.low_res_volume.dims(), [&](size_t i) { return voxel_selected(i); }, front);
+
+    vor3d::ParallelOptions parallel;
+    parallel.num_threads = _state.dilated_tet_mesh.dilation_num_threads;
+    parallel.grain_size = _state.dilated_tet_mesh.dilation_grain_size;
+    vor3d::VoronoiMorphoVorPower op(parallel);
     double time_1;
     double time_2;
-    vor3d::CompressedVolume output;
-    op.dilation(input, output, _state.dilated_tet_mesh.dilation_radius, time_1, time_2);
 
-    dexels_to_mesh(2 * _state.low_res_volume.dims()[0], output, extracted_surface.V_fat, extracted_surface.F_fat);
+    // Opening first removes specks that closing would otherwise merge into the fish
+    const double opening_radius = _state.dilated_tet_mesh.opening_radius;
+    if (opening_radius > 0.0) {
+        op.erosion(std::move(front), back, opening_radius, time_1, time_2);
+        op.dilation(back, front, opening_radius, time_1, time_2);
+        _state.logger->info("Opened the selection with radius {}", opening_radius);
+    }
+    const double closing_radius = _state.dilated_tet_mesh.closing_radius;
+    if (closing_radius > 0.0) {
+        op.dilation(front, back, closing_radius, time_1, time_2);
+        op.erosion(std::move(back), front, closing_radius, time_1, time_2);
+        _state.logger->info("Closed the selection with radius {}", closing_radius);
+    }
+
+    op.dilation(front, back, _state.dilated_tet_mesh.dilation_radius, time_1, time_2);
+    _state.logger->info("Dilation sweeps took {:.1f} ms and {:.1f} ms", time_1, time_2);
+
+    dexels_to_mesh(2 * _state.low_res_volume.dims()[0], back, extracted_surface.V_fat, extracted_surface.F_fat);
 }
 
 
@@ -311,7 +330,7 @@ void Meshing_Menu::extract_surface_mesh() {
                     SV[readcount] = -1.0;
                 }
                 else {
-                    SV[readcount] = skeleton_masking_volume[appendcount];
+                    SV[readcount] = voxel_selected(appendcount) ? 1.0 : -1.0;
                     appendcount += 1;
                 }
                 GP.row(readcount) = Eigen::RowVector3d(xi, yi, zi);
@@ -332,28 +351,29 @@ void Meshing_Menu::extract_surface_mesh() {
 }
 
 
-void Meshing_Menu::export_selected_volume(const std::vector<uint32_t>& feature_list)
+void Meshing_Menu::select_feature_arcs(const std::vector<uint32_t>& feature_list)
 {
     _state.logger->debug("Feature list size: {}", feature_list.size());
-    skeleton_masking_volume.resize(_state.low_res_volume.volume_data.size());
     std::vector<contourtree::Feature> features = _state.segmented_features.topological_features.getFeatures(_state.segmented_features.num_selected_features, 0.f);
 
-    std::vector<uint32_t> good_arcs;
+    const size_t num_arcs = size_t(_state.segmented_features.topological_features.ctdata.noArcs);
+    selected_arcs.assign(num_arcs, 0);
     for (uint32_t f : feature_list) {
         _state.logger->debug("Feature: {}", f);
         _state.logger->debug("Feature arcs size: {}", features[f].arcs.size());
-        good_arcs.insert(good_arcs.end(), features[f].arcs.begin(), features[f].arcs.end());
-        _state.logger->debug("Good arcs size: {}", good_arcs.size());
+        for (uint32_t arc : features[f].arcs) {
+            if (arc < num_arcs) {
+                selected_arcs[arc] = 1;
+            }
+        }
     }
-    std::sort(good_arcs.begin(), good_arcs.end());
+}
 
-    for (int i = 0; i < skeleton_masking_volume.size(); ++i) {
-        unsigned int idx = _state.low_res_volume.index_data[i];
-        if (std::binary_search(good_arcs.begin(), good_arcs.end(), idx)) {
-            skeleton_masking_volume[i] = 1.0;
-        }
-        else {
-            skeleton_masking_volume[i] = -1.0;
-        }
+bool Meshing_Menu::voxel_selected(size_t i) const
+{
+    if (debug.enabled) {
+        return debug.masking_volume_hack[Eigen::Index(i)] != 0.0f;
     }
+    const uint32_t arc = _state.low_res_volume.index_data[Eigen::Index(i)];
+    return arc < selected_arcs.size() && selected_arcs[arc] != 0;
 }
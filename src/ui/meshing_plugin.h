@@ -4,7 +4,9 @@
 #include "fish_ui_viewer_plugin.h"
 
 #include <atomic>
+#include <cstdint>
 #include <thread>
+#include <vector>
 
 #include <utils/timer.h>
 
@@ -38,9 +40,14 @@ private:
     std::atomic_bool is_meshing;
     std::atomic_bool done_meshing;
 
-    Eigen::VectorXf skeleton_masking_volume;
+    // One byte per arc of the contour tree, set for the arcs of the selected features
+    std::vector<uint8_t> selected_arcs;
+
+    void select_feature_arcs(const std::vector<uint32_t>& feature_list);
+
+    // True if voxel i of the low resolution volume is part of a selected feature
+    bool voxel_selected(size_t i) const;
 
-    void export_selected_volume(const std::vector<uint32_t>& feature_list);
     void tetrahedralize_surface_mesh();
     void dilate_volume();
     void extract_surface_mesh();
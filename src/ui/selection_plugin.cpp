@@ -118,9 +118,9 @@ void Selection_Menu::draw_selection_volume() {
         selection_list_is_dirty = true;
         _state.segmented_features.recompute_feature_map();
 
-        uint32_t* buffer_data = _state.segmented_features.buffer_data.data();
-        size_t num_features =_state.segmented_features.buffer_data.size();
-        selection_renderer.set_contour_data(buffer_data, num_features);
+        const std::vector<uint32_t>& buffer_data = _state.segmented_features.buffer_data;
+        selection_renderer.update_contour_data(buffer_data.data(), buffer_data.size(),
+                                               _state.segmented_features.changed_ranges);
         number_features_is_dirty = false;
         _state.dirty_flags.mesh_dirty = true;
     }
@@ -143,6 +143,7 @@ void Selection_Menu::draw_selection_volume() {
     rendering_params.highlight_factor = highlight_factor;
     rendering_params.emphasize_by_selection = static_cast<int>(emphasize_by_selection);
     rendering_params.color_by_id = color_by_id;
+    rendering_params.skip_empty_space = skip_empty_space;
 
     const int maxDim = glm::compMax(rendering_params.volume_dimensions);
     const float md = static_cast<float>(maxDim);
@@ -160,14 +161,15 @@ void Selection_Menu::draw_selection_volume() {
     selection_renderer.volume_pass(
                 rendering_params,
                 _state.low_res_volume.index_texture,
-                _state.low_res_volume.volume_texture);
+                _state.low_res_volume.texture_binding());
 
     glm::ivec2 inv_mouse_coords { viewer->current_mouse_x, viewer->core.viewport[3] - viewer->current_mouse_y };
     glm::vec3 picking = selection_renderer.picking_pass(
                 rendering_params,
                 inv_mouse_coords,
                 _state.low_res_volume.index_texture,
-                _state.low_res_volume.volume_texture);
+                _state.low_res_volume.volume_texture,
+                should_select);
     current_selected_feature = static_cast<int>(picking.x);
 
     if (should_select) {
@@ -290,6 +292,49 @@ bool Selection_Menu::post_draw() {
             _state.dirty_flags.mesh_dirty = true;
         }
         ImGui::PopItemWidth();
+
+        // Opening removes specks and thin spurs from noisy selections, closing fills small holes and gaps
+        float opening_radius = (float)_state.dilated_tet_mesh.opening_radius;
+        float closing_radius = (float)_state.dilated_tet_mesh.closing_radius;
+        ImGui::Spacing();
+        ImGui::Text("Opening Radius (0 = off):");
+        ImGui::PushItemWidth(-1);
+        if (ImGui::InputFloat("##openingradius", &opening_radius, 0.5, 1.0)) {
+            _state.dilated_tet_mesh.opening_radius = std::max((double)opening_radius, 0.0);
+            _state.dirty_flags.mesh_dirty = true;
+        }
+        ImGui::PopItemWidth();
+
+        ImGui::Spacing();
+        ImGui::Text("Closing Radius (0 = off):");
+        ImGui::PushItemWidth(-1);
+        if (ImGui::InputFloat("##closingradius", &closing_radius, 0.5, 1.0)) {
+            _state.dilated_tet_mesh.closing_radius = std::max((double)closing_radius, 0.0);
+            _state.dirty_flags.mesh_dirty = true;
+        }
+        ImGui::PopItemWidth();
+
+        // Only changes how fast the dilation runs, not its result
+        ImGui::Spacing();
+        ImGui::Text("Dilation Threads (0 = all cores):");
+        ImGui::PushItemWidth(-1);
+        if (ImGui::InputInt("##dilationthreads", &_state.dilated_tet_mesh.dilation_num_threads)) {
+            _state.dilated_tet_mesh.dilation_num_threads = std::max(_state.dilated_tet_mesh.dilation_num_threads, 0);
+        }
+        ImGui::PopItemWidth();
+
+        ImGui::Spacing();
+        ImGui::Text("Dilation Rows per Task:");
+        ImGui::PushItemWidth(-1);
+        if (ImGui::InputInt("##dilationgrain", &_state.dilated_tet_mesh.dilation_grain_size)) {
+            _state.dilated_tet_mesh.dilation_grain_size = std::max(_state.dilated_tet_mesh.dilation_grain_size, 1);
+        }
+        ImGui::PopItemWidth();
+
+        // Toggling this compares frame times with and without empty space skipping
+        ImGui::Spacing();
+        ImGui::Checkbox("Skip Empty Space", &skip_empty_space);
+        ImGui::Text("Frame time: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
     }
     ImGui::NewLine();
     ImGui::Separator();
@@ -45,6 +45,7 @@ private:
     std::vector<TfNode> transfer_function;
     int current_selected_feature = -1;
     bool color_by_id = true;
+    bool skip_empty_space = true;
 
     // Keep in sync with volume_fragment_shader.h and Combobox code generation
     enum class Emphasis {
@@ -1,80 +1,426 @@
 #include "state.h"
 
+#include <utils/gl/voxel_format_gl.h>
+#include <utils/content_hash.h>
+#include <utils/contour_tree_cache.h>
+#include <utils/partition_refinement.h>
+#include <utils/quantize.h>
+#include <utils/volume_gradients.h>
+#include <utils/parallel_for.h>
+#include <utils/project_file.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+namespace {
+// Bytes of a texture streamed per upload, whole slices are uploaded at a time
+constexpr size_t TEXTURE_UPLOAD_BYTES = size_t(64) << 20;
+
+// Volume textures bigger than this are uploaded as bricks, so empty space doesn't use GPU memory
+constexpr size_t BRICKED_TEXTURE_MIN_BYTES = size_t(1) << 30;
+
+// Gradient textures take 4 bytes per voxel, bigger volumes are lit with central differences instead
+constexpr size_t GRADIENT_TEXTURE_MAX_BYTES = size_t(1) << 30;
+
+// Number of bricks gathered and converted at once before they are uploaded
+constexpr size_t BRICK_UPLOAD_BATCH_SIZE = 256;
+
+// Changed entries of the feature map at most this far apart are uploaded as one range
+constexpr size_t FEATURE_MAP_RANGE_GAP = 256;
+
+// Past this many ranges, the span covering all of them is uploaded in one call instead
+constexpr size_t FEATURE_MAP_MAX_RANGES = 64;
+
+// Slices of a compressed volume decompressed at once while scanning it
+constexpr size_t SLICE_WINDOW_BYTES = size_t(64) << 20;
+
+// Slices of a volume requested in increasing z. Compressed slices are decompressed once, into a window
+// that keeps them until they are released, so layers with overlapping slices can share them.
+class SliceWindow {
+public:
+    explicit SliceWindow(const State::LoadedVolume& volume) : _volume(volume) {
+        _slice_bytes = size_t(volume.metadata.w) * size_t(volume.metadata.h) * voxel_format_size(volume.format());
+        if (volume.compressed_data) {
+            // Whole blocks, so none of them is decompressed twice
+            const int block_depth = volume.compressed_data->slab_depth();
+            const int min_depth = int(std::max<size_t>(1, SLICE_WINDOW_BYTES / std::max<size_t>(_slice_bytes, 1)));
+            _read_depth = std::max(1, (min_depth + block_depth - 1) / block_depth) * block_depth;
+        }
+    }
+
+    // Samples of slices [z_begin, z_end). z_begin must not be before a released slice.
+    const uint8_t* slices(int z_begin, int z_end) {
+        if (!_volume.compressed_data) {
+            return _volume.read_slices(z_begin, z_end, _buffer);
+        }
+        assert(z_begin >= _z_begin);
+        if (z_end > _z_end) {
+            // Drop the released slices, then decompress up to the end of the block holding z_end
+            const int keep_begin = std::min(_z_release, _z_end);
+            _buffer.erase(_buffer.begin(), _buffer.begin() + size_t(keep_begin - _z_begin) * _slice_bytes);
+            _z_begin = keep_begin;
+            const int read_end = std::min((z_end + _read_depth - 1) / _read_depth * _read_depth, _volume.metadata.d);
+            _buffer.resize(size_t(read_end - _z_begin) * _slice_bytes);
+            _volume.compressed_data->read_slices(_z_end, read_end, _buffer.data() + size_t(_z_end - _z_begin) * _slice_bytes);
+            _z_end = read_end;
+        }
+        return _buffer.data() + size_t(z_begin - _z_begin) * _slice_bytes;
+    }
+
+    // Slices before z are not requested anymore
+    void release(int z) {
+        _z_release = std::max(_z_release, z);
+    }
+
+private:
+    const State::LoadedVolume& _volume;
+    size_t _slice_bytes = 0;
+    int _read_depth = 1;
+    std::vector<uint8_t> _buffer;
+    int _z_begin = 0, _z_end = 0, _z_release = 0;
+};
+
+void write_statistics(ProjectFileWriter& writer, const std::string& prefix, const VolumeStatistics& statistics) {
+    writer.write_value(prefix + ".format", static_cast<int32_t>(statistics.format));
+    writer.write_value(prefix + ".num_voxels", statistics.num_voxels);
+    writer.write_value(prefix + ".min_value", statistics.min_value);
+    writer.write_value(prefix + ".max_value", statistics.max_value);
+    writer.write_value(prefix + ".histogram_min", statistics.histogram_min);
+    writer.write_value(prefix + ".histogram_max", statistics.histogram_max);
+    writer.write_vector(prefix + ".histogram", statistics.histogram);
+}
+
+// Statistics are optional, they are recomputed when the volume is loaded if they're missing
+void read_statistics(const ProjectFileReader& reader, const std::string& prefix, VolumeStatistics& statistics) {
+    statistics.clear();
+    int32_t format = static_cast<int32_t>(VoxelFormat::INVALID);
+    reader.read_value(prefix + ".format", format);
+    statistics.format = static_cast<VoxelFormat>(format);
+    reader.read_value(prefix + ".num_voxels", statistics.num_voxels);
+    reader.read_value(prefix + ".min_value", statistics.min_value);
+    reader.read_value(prefix + ".max_value", statistics.max_value);
+    reader.read_value(prefix + ".histogram_min", statistics.histogram_min);
+    reader.read_value(prefix + ".histogram_max", statistics.histogram_max);
+    reader.read_vector(prefix + ".histogram", statistics.histogram);
+}
+}
+
 
 void State::SegmentedFeatures::recompute_feature_map() {
     selected_features.clear();
-    buffer_data.clear();
-    features = topological_features.getFeatures(num_selected_features, 0.f);
+    changed_ranges.clear();
+
+    auto cached = feature_cache.find(num_selected_features);
+    if (cached == feature_cache.end()) {
+        cached = feature_cache.emplace(num_selected_features,
+                                       topological_features.getFeatures(num_selected_features, 0.f)).first;
+    }
+    features = cached->second;
 
     uint32_t size = topological_features.ctdata.noArcs;
-    buffer_data.resize(size + 1 + 1, static_cast<uint32_t>(-1));
-    buffer_data[0] = static_cast<uint32_t>(features.size());
+    std::vector<uint32_t> new_data(size + 1 + 1, static_cast<uint32_t>(-1));
+    new_data[0] = static_cast<uint32_t>(features.size());
     for (size_t i = 0; i < features.size(); ++i) {
         for (uint32_t j : features[i].arcs) {
             // +1 since the first value of the vector contains the number of features
-            buffer_data[j + 1] = static_cast<uint32_t>(i);
+            new_data[j + 1] = static_cast<uint32_t>(i);
         }
     }
-}
 
-void State::LoadedVolume::preprocess_volume_texture(std::vector<uint8_t>& byte_data) {
-    // Pre-load and normalize data for the low res volume GL texture
-    const Eigen::RowVector3i volume_dims = dims();
-    const int size = volume_dims[0]*volume_dims[1]*volume_dims[2];
-    byte_data.clear();
-    byte_data.resize(size);
-    const double min_value = min_value;
-    const double value_range = max_value - min_value;
-    const float* texture_data = volume_data.data();
-    std::transform(
-        texture_data,
-        texture_data + size,
-        byte_data.begin(),
-        [min_value, value_range](double d) {
-            return static_cast<uint8_t>(((d - min_value)/value_range) * std::numeric_limits<uint8_t>::max());
+    // Only the arcs whose feature changed need to be sent to the GPU. Nearby changes are merged
+    // so a scattered update doesn't turn into thousands of tiny uploads.
+    if (new_data.size() == buffer_data.size()) {
+        for (size_t i = 0; i < new_data.size(); i++) {
+            if (new_data[i] == buffer_data[i]) {
+                continue;
+            }
+            if (!changed_ranges.empty() && i - changed_ranges.back().second <= FEATURE_MAP_RANGE_GAP) {
+                changed_ranges.back().second = i + 1;
+            } else {
+                changed_ranges.emplace_back(i, i + 1);
+            }
         }
-    );
+        if (changed_ranges.size() > FEATURE_MAP_MAX_RANGES) {
+            changed_ranges = { std::make_pair(changed_ranges.front().first, changed_ranges.back().second) };
+        }
+    } else {
+        changed_ranges.emplace_back(0, new_data.size());
+    }
+    buffer_data.swap(new_data);
 }
 
-
-void State::load_volume_data(State::LoadedVolume& volume, std::string prefix, bool load_topology) {
+bool State::load_volume_data(State::LoadedVolume& volume, std::string prefix, bool load_topology,
+                             VolumeLoadProgress* progress) {
     std::string prefix_with_path = input_metadata.output_dir + "/" + prefix;
 
     // Load the volume data
     volume.metadata = DatFile(prefix_with_path + ".dat", logger);
-    load_rawfile(prefix_with_path + ".raw", volume.dims(),
-                 volume.volume_data, logger, true /* normalize */);
-    volume.max_value = volume.volume_data.maxCoeff();
-    volume.min_value = volume.volume_data.minCoeff();
+    if (!load_volume_samples(volume, false /* keep_compressed */, progress)) {
+        logger->error("Could not load the volume '{}'.", prefix_with_path);
+        return false;
+    }
 
     if (load_topology) {
-        // Compute the topological features
-        Eigen::Vector3i lrv = volume.dims();
-        preProcessing(prefix_with_path, lrv[0], lrv[1], lrv[2]);
-        segmented_features.topological_features.loadData(prefix_with_path);
+        // The contour tree library reads one byte per voxel, so deeper volumes are quantized to
+        // their value range first, like they are for a compact texture
+        const Eigen::RowVector3i dims = volume.dims();
+        VolumeData quantized_volume;
+        const VolumeData* tree_volume = &volume.volume_data;
+        if (!volume.volume_data.empty() && volume.volume_data.format() != VoxelFormat::UINT8) {
+            quantized_volume.allocate(volume.num_voxels(), VoxelFormat::UINT8);
+            quantize_to_uint8(volume.volume_data.format(), volume.volume_data.bytes(), volume.num_voxels(),
+                              volume.min_value, volume.max_value, quantized_volume.mutable_bytes());
+            tree_volume = &quantized_volume;
+        }
+
+        // For finely sampled volumes the contour tree is computed on a coarser copy, written next to
+        // the volume, and its partition is refined back to the resolution of the volume afterwards.
+        // A quantized volume gets its own copy too, since <prefix>.raw holds the deeper samples.
+        const int ct_factor = volume.volume_data.empty() ? 1 : std::max(1, input_metadata.contour_tree_factor);
+        VolumeData coarse_volume;
+        const VolumeData* ct_volume = tree_volume;
+        Eigen::RowVector3i ct_dims = dims;
+        std::string ct_prefix = prefix_with_path;
+        if (ct_factor > 1 || tree_volume != &volume.volume_data) {
+            ct_prefix = prefix_with_path + "-ct" + std::to_string(ct_factor);
+        }
+        if (ct_factor > 1) {
+            ct_dims = downsampled_dims(dims, ct_factor);
+            downsample_volume(*tree_volume, dims, ct_factor, coarse_volume);
+            ct_volume = &coarse_volume;
+            logger->info("Computing the contour tree at {}x{}x{}", ct_dims[0], ct_dims[1], ct_dims[2]);
+        }
+
+        // Compute the topological features, unless they were already computed from the same samples
+        Eigen::Vector3i lrv = ct_dims;
+        const uint64_t hash = content_hash(ct_volume->bytes(), ct_volume->size_in_bytes());
+        if (!ct_volume->empty() && contour_tree_cache_valid(ct_prefix, hash, lrv, logger)) {
+            logger->info("Using the cached contour tree of '{}'", ct_prefix);
+        } else {
+            if (ct_prefix != prefix_with_path) {
+                // Only the contour tree library reads this copy, so it has no .dat file
+                std::ofstream out(ct_prefix + ".raw", std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char*>(ct_volume->bytes()), std::streamsize(ct_volume->size_in_bytes()));
+                out.close();
+                if (!out) {
+                    logger->error("Could not write the contour tree input '{}.raw'.", ct_prefix);
+                    return false;
+                }
+            }
+            preProcessing(ct_prefix, lrv[0], lrv[1], lrv[2]);
+            if (!ct_volume->empty()) {
+                write_contour_tree_cache(ct_prefix, hash, lrv, logger);
+            }
+        }
+        segmented_features.topological_features.loadData(ct_prefix);
+        segmented_features.feature_cache.clear();
+        segmented_features.buffer_data.clear();
         segmented_features.recompute_feature_map();
 
-        // Load the low-res index data
-        const size_t num_bytes = volume.num_voxels() * sizeof(uint32_t);
-        std::ifstream file;
-        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        file.open(prefix_with_path + ".part.raw", std::ifstream::binary);
-        typedef decltype(volume.index_data) IndexType;
-        volume.index_data.resize(num_bytes / sizeof(IndexType::Scalar));
-        file.read(reinterpret_cast<char*>(volume.index_data.data()), num_bytes);
+        // Load the index data of the volume the contour tree was computed on
+        const size_t num_ct_voxels = size_t(ct_dims[0]) * size_t(ct_dims[1]) * size_t(ct_dims[2]);
+        VectorXui ct_index(num_ct_voxels);
+        std::ifstream file(ct_prefix + ".part.raw", std::ifstream::binary);
+        file.read(reinterpret_cast<char*>(ct_index.data()), num_ct_voxels * sizeof(uint32_t));
+        if (!file) {
+            logger->error("Could not read the partition '{}.part.raw'.", ct_prefix);
+            return false;
+        }
+
+        if (ct_factor > 1) {
+            volume.index_data.resize(volume.num_voxels());
+            refine_partition(*ct_volume, ct_index.data(), ct_dims, *tree_volume, dims, ct_factor,
+                             volume.index_data.data());
+        } else {
+            volume.index_data.swap(ct_index);
+        }
+    }
+    return true;
+}
+
+bool State::load_volume_samples(State::LoadedVolume& volume, bool keep_compressed, VolumeLoadProgress* progress) {
+    const std::string rawfile_path = volume.metadata.m_directory + "/" + volume.metadata.m_raw_filename;
+    const VoxelFormat format = voxel_format_from_string(volume.metadata.m_format);
+    volume.volume_data.clear();
+    volume.compressed_data.reset();
+
+    // Statistics saved with the project are reused, otherwise they are gathered in the same pass that reads the samples
+    const bool have_statistics = volume.statistics.valid_for(format, volume.num_voxels());
+    VolumeStatistics* statistics = have_statistics ? nullptr : &volume.statistics;
+    if (have_statistics) {
+        logger->debug("Using saved statistics for '{}'", rawfile_path);
+    }
+
+    bool ok = true;
+    if (volume.metadata.m_compression.empty()) {
+        ok = volume.volume_data.load(rawfile_path, volume.num_voxels(), format, logger);
+        if (ok) {
+            volume.volume_data.prefetch(progress, statistics);
+        }
+    } else if (volume.metadata.m_compression != BLOCKED_VOLUME_COMPRESSION) {
+        logger->error("RawFile '{}' uses unsupported compression '{}'.", rawfile_path, volume.metadata.m_compression);
+        ok = false;
+    } else {
+        std::shared_ptr<BlockedVolumeFile> compressed = std::make_shared<BlockedVolumeFile>();
+        ok = compressed->open(rawfile_path, logger);
+        if (ok && (compressed->dims() != volume.dims() || compressed->format() != format)) {
+            logger->error("RawFile '{}' does not match the dimensions and format in its .dat file.", rawfile_path);
+            ok = false;
+        }
+
+        if (ok && keep_compressed) {
+            volume.compressed_data = compressed;
+            if (progress) {
+                progress->bytes_total = compressed->compressed_size();
+                progress->bytes_done = 0;
+            }
+            if (statistics) {
+                ok = compressed->compute_statistics(*statistics);
+            }
+            if (progress) {
+                progress->bytes_done = compressed->compressed_size();
+            }
+        } else if (ok) {
+            ok = compressed->read(volume.volume_data, progress, statistics);
+        }
+    }
+
+    if (!ok) {
+        volume.statistics.clear();
+        return false;
+    }
+    volume.min_value = volume.statistics.min_value;
+    volume.max_value = volume.statistics.max_value;
+    return true;
+}
+
+
+const State::LoadedVolume& State::volume_level(int level) const {
+    if (level <= 0) {
+        return hi_res_volume;
+    }
+    if (level <= int(mid_res_volumes.size())) {
+        return mid_res_volumes[size_t(level - 1)];
+    }
+    return low_res_volume;
+}
+
+int State::volume_level_factor(int level) const {
+    return volume_level(level).level_factor;
+}
+
+int State::volume_level_for_scale(double scale) const {
+    // A level has low_res_volume.level_factor / level_factor samples per low resolution voxel
+    const double max_factor = double(low_res_volume.level_factor) / std::max(scale, 1e-6);
+    for (int level = num_volume_levels() - 1; level > 0; level--) {
+        if (double(volume_level_factor(level)) <= max_factor) {
+            return level;
+        }
     }
+    return 0;
 }
 
 
-void State::LoadedVolume::load_gl_volume_texture(const std::vector<uint8_t>& byte_data) {
-    if (byte_data.size() == 0) {
+const uint8_t* State::LoadedVolume::read_slices(int z_begin, int z_end, std::vector<uint8_t>& buffer) const {
+    const size_t slice_voxels = size_t(metadata.w) * size_t(metadata.h);
+    const size_t voxel_size = voxel_format_size(format());
+    if (compressed_data) {
+        buffer.resize(size_t(z_end - z_begin) * slice_voxels * voxel_size);
+        compressed_data->read_slices(z_begin, z_end, buffer.data());
+        return buffer.data();
+    }
+    return volume_data.bytes() + size_t(z_begin) * slice_voxels * voxel_size;
+}
+
+void State::LoadedVolume::prepare_gl_volume_texture(int max_texture_size) {
+    use_bricks = false;
+    occupied_bricks.clear();
+    macro_cells = MacroCellGrid();
+    if (volume_data.empty() && !compressed_data) {
         return;
     }
+
+    // Volumes that don't fit in one texture are uploaded as bricks. The bricks with anything above the display
+    // minimum in them are found up front, so the atlas can be sized before the upload.
+    const size_t texture_bytes = num_voxels() * voxel_format_size(texture_format());
+    use_bricks = dims().maxCoeff() > max_texture_size || texture_bytes > BRICKED_TEXTURE_MIN_BYTES;
+    const BrickGrid grid = use_bricks ? BrickGrid(metadata.w, metadata.h, metadata.d) : BrickGrid();
+    occupied_bricks.assign(grid.num_bricks(), 0);
+
+    // Find the displayed value range of every macro cell and the occupied bricks in a single pass over the
+    // samples. Layers of cells and of bricks are handled in the order they end in, so the slices they share
+    // are only read (and decompressed) once.
+    macro_cells = MacroCellGrid(metadata.w, metadata.h, metadata.d);
+    SliceWindow window(*this);
+    std::vector<uint8_t> layer_occupied;
+    int cz = 0, bz = 0;
+    while (cz < macro_cells.nz || bz < grid.nz) {
+        int cell_z_begin = 0, cell_z_end = 0, brick_z_begin = 0, brick_z_end = 0;
+        if (cz < macro_cells.nz) {
+            macro_cells.layer_slices(cz, cell_z_begin, cell_z_end);
+        }
+        if (bz < grid.nz) {
+            grid.layer_slices(bz, brick_z_begin, brick_z_end);
+        }
+
+        if (bz == grid.nz || (cz < macro_cells.nz && cell_z_end <= brick_z_end)) {
+            const VolumeSlab slab = { format(), window.slices(cell_z_begin, cell_z_end), cell_z_begin, cell_z_end };
+            find_cell_value_ranges(macro_cells, slab, cz, min_value, max_value);
+            cz++;
+        } else {
+            const VolumeSlab slab = { format(), window.slices(brick_z_begin, brick_z_end), brick_z_begin, brick_z_end };
+            find_occupied_bricks(grid, slab, bz, min_value, layer_occupied);
+            std::copy(layer_occupied.begin(), layer_occupied.end(), occupied_bricks.begin() + size_t(bz) * grid.layer_size());
+            bz++;
+        }
+
+        // Slices before the next layers of both grids are done with
+        int next_z_begin = metadata.d, z_end;
+        if (cz < macro_cells.nz) {
+            macro_cells.layer_slices(cz, next_z_begin, z_end);
+        }
+        if (bz < grid.nz) {
+            int brick_begin;
+            grid.layer_slices(bz, brick_begin, z_end);
+            next_z_begin = std::min(next_z_begin, brick_begin);
+        }
+        window.release(next_z_begin);
+    }
+
+    // The arcs in each cell if the volume is segmented
+    if (size_t(index_data.size()) == num_voxels()) {
+        find_cell_index_values(macro_cells, index_data.data());
+    }
+}
+
+void State::LoadedVolume::upload_gl_volume_texture(TextureUploader& uploader) {
+    if (volume_data.empty() && !compressed_data) {
+        return;
+    }
+    if (bricked_texture) {
+        // The atlas is owned by bricked_texture
+        bricked_texture->destroy();
+        bricked_texture.reset();
+        volume_texture = 0;
+    }
     if (volume_texture != 0) {
         glDeleteTextures(1, &volume_texture);
+        volume_texture = 0;
+    }
+    if (use_bricks) {
+        upload_gl_bricked_volume_texture(uploader);
+        return;
     }
 
     const Eigen::RowVector3i volume_dims = dims();
+    const VoxelFormat format = this->format();
+
+    // Compact textures store every format as 8 bit, the samples are stretched to [0, 255] as they are uploaded
+    const VoxelFormat gl_format = texture_format();
+    const bool quantize = gl_format != format;
+    const bool rescale = needs_rescale();
 
     glGenTextures(1, &volume_texture);
     glBindTexture(GL_TEXTURE_3D, volume_texture);
@@ -88,13 +434,206 @@ void State::LoadedVolume::load_gl_volume_texture(const std::vector<uint8_t>& byt
     //    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, gl_internal_format(gl_format), volume_dims[0], volume_dims[1], volume_dims[2], 0,
+                 GL_RED, gl_pixel_type(gl_format), nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // One upload per slab. If the samples are compressed or need to be converted, that happens
+    // on the uploader's worker threads, straight into the pixel buffer.
+    const size_t slice_voxels = size_t(volume_dims[0]) * size_t(volume_dims[1]);
+    const size_t gl_slice_bytes = slice_voxels * voxel_format_size(gl_format);
+    const int slab_depth = int(std::max<size_t>(1, std::min<size_t>(TEXTURE_UPLOAD_BYTES / gl_slice_bytes, volume_dims[2])));
+    for (int z = 0; z < volume_dims[2]; z += slab_depth) {
+        const int depth = std::min(slab_depth, volume_dims[2] - z);
+        const size_t slab_voxels = size_t(depth) * slice_voxels;
+
+        TextureUploader::Upload upload;
+        upload.texture = volume_texture;
+        upload.format = GL_RED;
+        upload.type = gl_pixel_type(gl_format);
+        upload.num_bytes = size_t(depth) * gl_slice_bytes;
+        upload.boxes.push_back({ glm::ivec3(0, 0, z), glm::ivec3(volume_dims[0], volume_dims[1], depth), 0 });
+        upload.fill = [this, z, depth, slab_voxels, format, quantize, rescale](uint8_t* dst) {
+            if (compressed_data && !quantize && !rescale) {
+                compressed_data->read_slices(z, z + depth, dst);
+                return;
+            }
+            std::vector<uint8_t> buffer;
+            const uint8_t* samples = read_slices(z, z + depth, buffer);
+            if (quantize) {
+                quantize_to_uint8(format, samples, slab_voxels, min_value, max_value, dst);
+            } else if (rescale) {
+                rescale_samples(format, samples, slab_voxels, min_value, max_value, dst);
+            } else {
+                std::memcpy(dst, samples, slab_voxels * voxel_format_size(format));
+            }
+        };
+        uploader.enqueue(std::move(upload));
+    }
+}
+
+void State::LoadedVolume::upload_gl_bricked_volume_texture(TextureUploader& uploader) {
+    std::shared_ptr<spdlog::logger> logger = spdlog::get(FISH_LOGGER_NAME);
+    const VoxelFormat format = this->format();
+    const VoxelFormat gl_format = texture_format();
+    const BrickGrid grid(metadata.w, metadata.h, metadata.d);
+    const size_t num_resident = size_t(std::count(occupied_bricks.begin(), occupied_bricks.end(), uint8_t(1)));
+
+    std::shared_ptr<BrickedVolumeTexture> bricked = std::make_shared<BrickedVolumeTexture>();
+    if (!bricked->init(grid, num_resident, gl_format)) {
+        if (logger) {
+            logger->error("Could not allocate a texture for {} of {} bricks of the volume.", num_resident, grid.num_bricks());
+        }
+        bricked->destroy();
+        return;
+    }
+    bricked_texture = bricked;
+    volume_texture = bricked->atlas_texture();
+
+    // Every batch of a layer reads the same slices. Compressed slices are decompressed once and shared.
+    struct LayerCache {
+        std::mutex mutex;
+        int bz = -1;
+        std::shared_ptr<std::vector<uint8_t>> slices;
+    };
+    std::shared_ptr<LayerCache> layer_cache = std::make_shared<LayerCache>();
+
+    // One upload per batch of bricks in a layer: the bricks are gathered and converted on the
+    // uploader's worker threads and copied to their slots in the atlas from a single pixel buffer
+    const size_t brick_bytes = VOLUME_BRICK_VOXELS * voxel_format_size(format);
+    const size_t gl_brick_bytes = VOLUME_BRICK_VOXELS * voxel_format_size(gl_format);
+    const bool quantize = gl_format != format;
+    const bool rescale = needs_rescale();
+    for (int bz = 0; bz < grid.nz; bz++) {
+        const uint8_t* layer = occupied_bricks.data() + size_t(bz) * grid.layer_size();
+        for (size_t i = 0; i < grid.layer_size(); i += BRICK_UPLOAD_BATCH_SIZE) {
+            std::vector<std::pair<int, int>> batch;
+            TextureUploader::Upload upload;
+            for (size_t j = i; j < std::min(grid.layer_size(), i + BRICK_UPLOAD_BATCH_SIZE); j++) {
+                if (layer[j]) {
+                    const int bx = int(j % size_t(grid.nx));
+                    const int by = int(j / size_t(grid.nx));
+                    const glm::ivec3 slot = bricked->add_brick(bx, by, bz);
+                    upload.boxes.push_back({ slot, glm::ivec3(VOLUME_BRICK_SIZE), batch.size() * gl_brick_bytes });
+                    batch.emplace_back(bx, by);
+                }
+            }
+            if (batch.empty()) {
+                continue;
+            }
+
+            upload.texture = volume_texture;
+            upload.format = GL_RED;
+            upload.type = gl_pixel_type(gl_format);
+            upload.num_bytes = batch.size() * gl_brick_bytes;
+            upload.fill = [this, grid, bz, batch, layer_cache, format, brick_bytes, quantize, rescale](uint8_t* dst) {
+                int z_begin, z_end;
+                grid.layer_slices(bz, z_begin, z_end);
+                std::vector<uint8_t> unused;
+                std::shared_ptr<std::vector<uint8_t>> slices;
+                const uint8_t* samples = nullptr;
+                if (compressed_data) {
+                    std::lock_guard<std::mutex> lock(layer_cache->mutex);
+                    if (layer_cache->bz != bz) {
+                        layer_cache->slices = std::make_shared<std::vector<uint8_t>>();
+                        read_slices(z_begin, z_end, *layer_cache->slices);
+                        layer_cache->bz = bz;
+                    }
+                    slices = layer_cache->slices;
+                    samples = slices->data();
+                } else {
+                    samples = read_slices(z_begin, z_end, unused);
+                }
+                const VolumeSlab slab = { format, samples, z_begin, z_end };
+
+                // Gather straight into the pixel buffer unless the samples need converting
+                std::vector<uint8_t> gathered;
+                uint8_t* bricks = dst;
+                if (quantize || rescale) {
+                    gathered.resize(batch.size() * brick_bytes);
+                    bricks = gathered.data();
+                }
+                parallel_for_chunks(0, batch.size(), 1, [&](size_t begin, size_t end) {
+                    for (size_t b = begin; b < end; b++) {
+                        gather_brick(grid, slab, batch[b].first, batch[b].second, bz, min_value, bricks + b * brick_bytes);
+                    }
+                });
+
+                const size_t batch_voxels = batch.size() * VOLUME_BRICK_VOXELS;
+                if (quantize) {
+                    quantize_to_uint8(format, bricks, batch_voxels, min_value, max_value, dst);
+                } else if (rescale) {
+                    rescale_samples(format, bricks, batch_voxels, min_value, max_value, dst);
+                }
+            };
+            uploader.enqueue(std::move(upload));
+        }
+    }
+    // Every resident brick has its slot now, so the page table can go up before the bricks do
+    bricked->finish();
 
-    const uint8_t* volume_data = byte_data.data();
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RED, volume_dims[0], volume_dims[1], volume_dims[2], 0,
-                 GL_RED, GL_UNSIGNED_BYTE, volume_data);
+    if (logger) {
+        logger->debug("Uploading {} of {} bricks of the volume, {} MB of texture memory.",
+                      num_resident, grid.num_bricks(), bricked->atlas_size_in_bytes() / (1024 * 1024));
+    }
 }
 
-void State::LoadedVolume::load_gl_index_texture() {
+void State::LoadedVolume::upload_gl_gradient_texture(TextureUploader& uploader) {
+    if (gradient_texture != 0) {
+        glDeleteTextures(1, &gradient_texture);
+        gradient_texture = 0;
+    }
+    if (!precompute_gradients || (volume_data.empty() && !compressed_data)) {
+        return;
+    }
+
+    const Eigen::RowVector3i volume_dims = dims();
+    const size_t slice_bytes = size_t(volume_dims[0]) * size_t(volume_dims[1]) * GRADIENT_VOXEL_BYTES;
+    if (use_bricks || slice_bytes * size_t(volume_dims[2]) > GRADIENT_TEXTURE_MAX_BYTES) {
+        std::shared_ptr<spdlog::logger> logger = spdlog::get(FISH_LOGGER_NAME);
+        if (logger) {
+            logger->info("Not precomputing gradients of the {}x{}x{} volume, it is too big. Lighting takes central differences.",
+                         volume_dims[0], volume_dims[1], volume_dims[2]);
+        }
+        return;
+    }
+
+    glGenTextures(1, &gradient_texture);
+    glBindTexture(GL_TEXTURE_3D, gradient_texture);
+    GLfloat transparent_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glTexParameterfv(GL_TEXTURE_3D, GL_TEXTURE_BORDER_COLOR, transparent_color);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8_SNORM, volume_dims[0], volume_dims[1], volume_dims[2], 0,
+                 GL_RGBA, GL_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // One upload per slab, each reading the slices on either side of it for the central differences
+    const int slab_depth = int(std::max<size_t>(1, std::min<size_t>(TEXTURE_UPLOAD_BYTES / slice_bytes, volume_dims[2])));
+    for (int z = 0; z < volume_dims[2]; z += slab_depth) {
+        const int depth = std::min(slab_depth, volume_dims[2] - z);
+        TextureUploader::Upload upload;
+        upload.texture = gradient_texture;
+        upload.format = GL_RGBA;
+        upload.type = GL_BYTE;
+        upload.num_bytes = size_t(depth) * slice_bytes;
+        upload.boxes.push_back({ glm::ivec3(0, 0, z), glm::ivec3(volume_dims[0], volume_dims[1], depth), 0 });
+        upload.fill = [this, z, depth, volume_dims](uint8_t* dst) {
+            const int z_begin = std::max(z - 1, 0);
+            const int z_end = std::min(z + depth + 1, volume_dims[2]);
+            std::vector<uint8_t> buffer;
+            const VolumeSlab slab = { format(), read_slices(z_begin, z_end, buffer), z_begin, z_end };
+            compute_gradients(slab, volume_dims[0], volume_dims[1], volume_dims[2], z, z + depth,
+                              min_value, max_value, reinterpret_cast<int8_t*>(dst));
+        };
+        uploader.enqueue(std::move(upload));
+    }
+}
+
+void State::LoadedVolume::upload_gl_index_texture(TextureUploader& uploader) {
     if (index_data.size() == 0) {
         return;
     }
@@ -104,53 +643,179 @@ void State::LoadedVolume::load_gl_index_texture() {
 
     const Eigen::RowVector3i volume_dims = dims();
 
+    glGenTextures(1, &index_texture);
     glBindTexture(GL_TEXTURE_3D, index_texture);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    uint32_t* idata = index_data.data();
     glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, volume_dims[0], volume_dims[1], volume_dims[2],
-                 0, GL_RED_INTEGER, GL_UNSIGNED_INT, idata);
+                 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    const size_t slice_bytes = size_t(volume_dims[0]) * size_t(volume_dims[1]) * sizeof(uint32_t);
+    const int slab_depth = int(std::max<size_t>(1, std::min<size_t>(TEXTURE_UPLOAD_BYTES / slice_bytes, volume_dims[2])));
+    for (int z = 0; z < volume_dims[2]; z += slab_depth) {
+        const int depth = std::min(slab_depth, volume_dims[2] - z);
+        TextureUploader::Upload upload;
+        upload.texture = index_texture;
+        upload.format = GL_RED_INTEGER;
+        upload.type = GL_UNSIGNED_INT;
+        upload.num_bytes = size_t(depth) * slice_bytes;
+        upload.boxes.push_back({ glm::ivec3(0, 0, z), glm::ivec3(volume_dims[0], volume_dims[1], depth), 0 });
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(index_data.data()) + size_t(z) * slice_bytes;
+        const size_t num_bytes = upload.num_bytes;
+        upload.fill = [src, num_bytes](uint8_t* dst) {
+            std::memcpy(dst, src, num_bytes);
+        };
+        uploader.enqueue(std::move(upload));
+    }
 }
 
-void State::serialize(std::vector<char> &buffer) const {
-    igl::serialize(input_metadata.input_dir, std::string("image_input.input_dir"), buffer);
-    igl::serialize(input_metadata.output_dir, std::string("image_input.output_dir"), buffer);
-    igl::serialize(input_metadata.file_extension, std::string("image_input.file_extension"), buffer);
-    igl::serialize(input_metadata.prefix, std::string("image_input.prefix"), buffer);
-    igl::serialize(input_metadata.downsample_factor, std::string("image_input.downsample_factor"), buffer);
-    igl::serialize(input_metadata.start_index, std::string("image_input.start_index"), buffer);
-    igl::serialize(input_metadata.end_index, std::string("image_input.end_index"), buffer);
-    igl::serialize(input_metadata.project_name, std::string("image_input.project_name"), buffer);
+void State::LoadedVolume::load_gl_volume_texture() {
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_texture_size);
+    prepare_gl_volume_texture(max_texture_size);
+
+    TextureUploader uploader;
+    uploader.init();
+    upload_gl_volume_texture(uploader);
+    upload_gl_gradient_texture(uploader);
+    uploader.finish();
+    uploader.destroy();
+}
 
+void State::LoadedVolume::load_gl_index_texture() {
+    TextureUploader uploader;
+    uploader.init();
+    upload_gl_index_texture(uploader);
+    uploader.finish();
+    uploader.destroy();
+}
 
-    igl::serialize(dilated_tet_mesh.TV, std::string("dilated_tet_mesh.TV"), buffer);
-    igl::serialize(dilated_tet_mesh.TT, std::string("dilated_tet_mesh.TT"), buffer);
-    igl::serialize(dilated_tet_mesh.TF, std::string("dilated_tet_mesh.TF"), buffer);
-    igl::serialize(dilated_tet_mesh.connected_components, std::string("dilated_tet_mesh.connected_components"), buffer);
-    igl::serialize(dilated_tet_mesh.dilation_radius, std::string("dilated_tet_mesh.dilation_radius"), buffer);
-    igl::serialize(dilated_tet_mesh.meshing_voxel_radius, std::string("dilated_tet_mesh.meshing_voxel_radius"), buffer);
-    igl::serialize(dilated_tet_mesh.geodesic_dists, std::string("dilated_tet_mesh.geodesic_dists"), buffer);
+bool State::save_project(const std::string& filename) const {
+    ProjectFileWriter writer;
+    if (!writer.open(filename, logger)) {
+        return false;
+    }
 
+    writer.write_string("image_input.input_dir", input_metadata.input_dir);
+    writer.write_string("image_input.output_dir", input_metadata.output_dir);
+    writer.write_string("image_input.file_extension", input_metadata.file_extension);
+    writer.write_string("image_input.prefix", input_metadata.prefix);
+    writer.write_value("image_input.downsample_factor", int32_t(input_metadata.downsample_factor));
+    writer.write_value("image_input.contour_tree_factor", int32_t(input_metadata.contour_tree_factor));
+    writer.write_value("image_input.start_index", int32_t(input_metadata.start_index));
+    writer.write_value("image_input.end_index", int32_t(input_metadata.end_index));
+    writer.write_string("image_input.project_name", input_metadata.project_name);
+
+    writer.write_matrix("dilated_tet_mesh.TV", dilated_tet_mesh.TV);
+    writer.write_matrix("dilated_tet_mesh.TT", dilated_tet_mesh.TT);
+    writer.write_matrix("dilated_tet_mesh.TF", dilated_tet_mesh.TF);
+    writer.write_matrix("dilated_tet_mesh.connected_components", dilated_tet_mesh.connected_components);
+    writer.write_value("dilated_tet_mesh.dilation_radius", dilated_tet_mesh.dilation_radius);
+    writer.write_value("dilated_tet_mesh.meshing_voxel_radius", dilated_tet_mesh.meshing_voxel_radius);
+    writer.write_value("dilated_tet_mesh.opening_radius", dilated_tet_mesh.opening_radius);
+    writer.write_value("dilated_tet_mesh.closing_radius", dilated_tet_mesh.closing_radius);
+    writer.write_matrix("dilated_tet_mesh.geodesic_dists", dilated_tet_mesh.geodesic_dists);
+
+    std::vector<int32_t> endpoints;
+    endpoints.reserve(skeleton_estimation_parameters.endpoint_pairs.size() * 2);
+    for (const std::pair<int, int>& endpoint_pair : skeleton_estimation_parameters.endpoint_pairs) {
+        endpoints.push_back(endpoint_pair.first);
+        endpoints.push_back(endpoint_pair.second);
+    }
+    writer.write_value("skeleton.num_subdivisions", int32_t(skeleton_estimation_parameters.num_subdivisions));
+    writer.write_value("skeleton.num_smoothing_iters", int32_t(skeleton_estimation_parameters.num_smoothing_iters));
+    writer.write_value("skeleton.cage_bbox_radius", skeleton_estimation_parameters.cage_bbox_radius);
+    writer.write_array("skeleton.endpoint_pairs", ProjectChunkType::INT32, 2, endpoints.size() / 2, endpoints.data());
 
-    igl::serialize(skeleton_estimation_parameters.num_subdivisions, std::string("skeleton_estimation_parameters.num_subdivisions"), buffer);
-    igl::serialize(skeleton_estimation_parameters.num_smoothing_iters, std::string("skeleton_estimation_parameters.num_smoothing_iters"), buffer);
-    igl::serialize(skeleton_estimation_parameters.cage_bbox_radius, std::string("skeleton_estimation_parameters.cage_bbox_radius"), buffer);
-    igl::serialize(skeleton_estimation_parameters.endpoint_pairs, std::string("skeleton_estimation_parameters.endpoint_pairs"), buffer);
+    writer.write_vector("segmented_features.selected_features", segmented_features.selected_features);
+    writer.write_value("segmented_features.num_selected_features", int32_t(segmented_features.num_selected_features));
 
+    writer.write_value("dirty_flags.file_loading_dirty", dirty_flags.file_loading_dirty);
+    writer.write_value("dirty_flags.mesh_dirty", dirty_flags.mesh_dirty);
+    writer.write_value("dirty_flags.endpoints_dirty", dirty_flags.endpoints_dirty);
+    writer.write_value("dirty_flags.bounding_cage_dirty", dirty_flags.bounding_cage_dirty);
 
-    igl::serialize(segmented_features.selected_features, std::string("segmented_features.selected_features"), buffer);
-    igl::serialize(segmented_features.num_selected_features, std::string("segmented_features.num_selected_features"), buffer);
+    cage.write(writer, "cage");
 
-    igl::serialize(dirty_flags.file_loading_dirty, std::string("dirty_flags.file_loading_dirty"), buffer);
-    igl::serialize(dirty_flags.mesh_dirty, std::string("dirty_flags.mesh_dirty"), buffer);
-    igl::serialize(dirty_flags.endpoints_dirty, std::string("dirty_flags.endpoints_dirty"), buffer);
-    igl::serialize(dirty_flags.bounding_cage_dirty, std::string("dirty_flags.bounding_cage_dirty"), buffer);
+    write_statistics(writer, "low_res_volume.statistics", low_res_volume.statistics);
+    write_statistics(writer, "hi_res_volume.statistics", hi_res_volume.statistics);
 
-    igl::serialize(cage, std::string("cage"), buffer);
+    return writer.close();
+}
+
+bool State::load_project(const std::string& filename) {
+    if (!ProjectFile::is_project_file(filename)) {
+        logger->info("'{}' is not a binary project file, reading it as a legacy project", filename);
+        return igl::deserialize(*this, "state", filename);
+    }
+
+    ProjectFileReader reader;
+    if (!reader.open(filename, logger)) {
+        return false;
+    }
+
+    bool ok = reader.read_string("image_input.input_dir", input_metadata.input_dir);
+    ok = ok && reader.read_string("image_input.output_dir", input_metadata.output_dir);
+    ok = ok && reader.read_string("image_input.file_extension", input_metadata.file_extension);
+    ok = ok && reader.read_string("image_input.prefix", input_metadata.prefix);
+    ok = ok && reader.read_value("image_input.downsample_factor", input_metadata.downsample_factor);
+    // Projects saved before the contour tree could be computed at a lower resolution don't have a factor
+    input_metadata.contour_tree_factor = 1;
+    reader.read_value("image_input.contour_tree_factor", input_metadata.contour_tree_factor);
+    ok = ok && reader.read_value("image_input.start_index", input_metadata.start_index);
+    ok = ok && reader.read_value("image_input.end_index", input_metadata.end_index);
+    ok = ok && reader.read_string("image_input.project_name", input_metadata.project_name);
+
+    ok = ok && reader.read_matrix("dilated_tet_mesh.TV", dilated_tet_mesh.TV);
+    ok = ok && reader.read_matrix("dilated_tet_mesh.TT", dilated_tet_mesh.TT);
+    ok = ok && reader.read_matrix("dilated_tet_mesh.TF", dilated_tet_mesh.TF);
+    ok = ok && reader.read_matrix("dilated_tet_mesh.connected_components", dilated_tet_mesh.connected_components);
+    ok = ok && reader.read_value("dilated_tet_mesh.dilation_radius", dilated_tet_mesh.dilation_radius);
+    ok = ok && reader.read_value("dilated_tet_mesh.meshing_voxel_radius", dilated_tet_mesh.meshing_voxel_radius);
+    // Projects saved before the selection could be opened and closed don't have the radii
+    dilated_tet_mesh.opening_radius = 0.0;
+    dilated_tet_mesh.closing_radius = 0.0;
+    reader.read_value("dilated_tet_mesh.opening_radius", dilated_tet_mesh.opening_radius);
+    reader.read_value("dilated_tet_mesh.closing_radius", dilated_tet_mesh.closing_radius);
+    ok = ok && reader.read_matrix("dilated_tet_mesh.geodesic_dists", dilated_tet_mesh.geodesic_dists);
+
+    Eigen::MatrixXi endpoints;
+    ok = ok && reader.read_value("skeleton.num_subdivisions", skeleton_estimation_parameters.num_subdivisions);
+    ok = ok && reader.read_value("skeleton.num_smoothing_iters", skeleton_estimation_parameters.num_smoothing_iters);
+    ok = ok && reader.read_value("skeleton.cage_bbox_radius", skeleton_estimation_parameters.cage_bbox_radius);
+    ok = ok && reader.read_matrix("skeleton.endpoint_pairs", endpoints) && endpoints.rows() == 2;
+    if (ok) {
+        skeleton_estimation_parameters.endpoint_pairs.clear();
+        for (int i = 0; i < endpoints.cols(); i++) {
+            skeleton_estimation_parameters.endpoint_pairs.push_back(std::make_pair(endpoints(0, i), endpoints(1, i)));
+        }
+    }
+
+    ok = ok && reader.read_vector("segmented_features.selected_features", segmented_features.selected_features);
+    ok = ok && reader.read_value("segmented_features.num_selected_features", segmented_features.num_selected_features);
+
+    ok = ok && reader.read_value("dirty_flags.file_loading_dirty", dirty_flags.file_loading_dirty);
+    ok = ok && reader.read_value("dirty_flags.mesh_dirty", dirty_flags.mesh_dirty);
+    ok = ok && reader.read_value("dirty_flags.endpoints_dirty", dirty_flags.endpoints_dirty);
+    ok = ok && reader.read_value("dirty_flags.bounding_cage_dirty", dirty_flags.bounding_cage_dirty);
+    if (!ok) {
+        logger->error("Project file '{}' is missing required fields", filename);
+        return false;
+    }
+
+    if (!cage.read(reader, "cage")) {
+        return false;
+    }
+
+    read_statistics(reader, "low_res_volume.statistics", low_res_volume.statistics);
+    read_statistics(reader, "hi_res_volume.statistics", hi_res_volume.statistics);
+
+    // NOTE: As with deserialize, the GL textures still need to be loaded
+    return true;
 }
 
 void State::deserialize(const std::vector<char> &buffer) {
@@ -159,6 +824,7 @@ void State::deserialize(const std::vector<char> &buffer) {
     igl::deserialize(input_metadata.file_extension, std::string("image_input.file_extension"), buffer);
     igl::deserialize(input_metadata.prefix, std::string("image_input.prefix"), buffer);
     igl::deserialize(input_metadata.downsample_factor, std::string("image_input.downsample_factor"), buffer);
+    input_metadata.contour_tree_factor = 1;
     igl::deserialize(input_metadata.start_index, std::string("image_input.start_index"), buffer);
     igl::deserialize(input_metadata.end_index, std::string("image_input.end_index"), buffer);
     igl::deserialize(input_metadata.project_name, std::string("image_input.project_name"), buffer);
@@ -189,6 +855,10 @@ void State::deserialize(const std::vector<char> &buffer) {
 
     igl::deserialize(cage, std::string("cage"), buffer);
 
+    // Legacy projects don't store statistics, they are gathered again when the volumes are read
+    low_res_volume.statistics.clear();
+    hi_res_volume.statistics.clear();
+
 
     // NOTE: You still need to load the GL textures after serializing by calling
     // state.low_res_texture.load_gl_*()
@@ -5,8 +5,16 @@
 #include <utils/bounding_cage.h>
 #include <utils/utils.h>
 #include <utils/datfile.h>
-
+#include <utils/volume_data.h>
+#include <utils/blocked_volume.h>
+#include <utils/volume_statistics.h>
+#include <utils/macro_cells.h>
+#include <utils/gl/bricked_volume_texture.h>
+#include <utils/gl/texture_uploader.h>
+
+#include <algorithm>
 #include <array>
+#include <map>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <vector>
@@ -61,31 +69,125 @@ struct State {
     struct LoadedVolume {
         DatFile metadata;
         VectorXui index_data;
-        Eigen::VectorXf volume_data;
+
+        // Samples in the native type given by the Format: field of the .dat file
+        VolumeData volume_data;
+
+        // Set instead of volume_data when the samples are kept LZ4 compressed and only
+        // decompressed one slab at a time while uploading the texture
+        std::shared_ptr<BlockedVolumeFile> compressed_data;
 
         GLuint volume_texture = 0;
         GLuint index_texture = 0;
 
-        double min_value;
-        double max_value;
+        // Normalized gradients of the displayed samples, for lighting without taking central differences
+        // in the shader. Only uploaded if precompute_gradients is set and the volume isn't bricked.
+        GLuint gradient_texture = 0;
+        bool precompute_gradients = false;
+
+        // Set when the volume is too big for a single texture and only its non-empty bricks are
+        // on the GPU. volume_texture is then the atlas of the bricks.
+        std::shared_ptr<BrickedVolumeTexture> bricked_texture;
+
+        // Range, histogram and percentiles of the samples. Saved with the project so reopening
+        // it does not need a pass over the samples just to gather them.
+        VolumeStatistics statistics;
+
+        // Normalized range the samples are stretched from for display
+        double min_value = 0.0;
+        double max_value = 1.0;
+
+        // Upload 16 bit and floating point samples as an 8 bit texture, using a half or a quarter of the GPU memory
+        bool compact_texture = false;
 
         const Eigen::RowVector3i dims() const {
             return Eigen::RowVector3i(metadata.w, metadata.h, metadata.d);
         }
 
         const size_t num_voxels() const {
-            return metadata.w*metadata.h*metadata.d;
+            return size_t(metadata.w)*size_t(metadata.h)*size_t(metadata.d);
+        }
+
+        // Factor the volume is downsampled by from the full resolution scan
+        int level_factor = 1;
+
+        VoxelFormat format() const {
+            return compressed_data ? compressed_data->format() : volume_data.format();
+        }
+
+        // Format of volume_texture
+        VoxelFormat texture_format() const {
+            return compact_texture ? VoxelFormat::UINT8 : format();
         }
 
-        void preprocess_volume_texture(std::vector<uint8_t>& byte_data);
-        void load_gl_volume_texture(const std::vector<uint8_t> &byte_data);
+        // True if the samples must be stretched from [min_value, max_value] to [0, 1] for display
+        bool needs_rescale() const {
+            return min_value != 0.0 || max_value != 1.0;
+        }
+
+        // Value ranges (and index values, if there is index_data) of the macro cells of the volume,
+        // which the renderers skip empty space with. Built by prepare_gl_volume_texture.
+        MacroCellGrid macro_cells;
+
+        // What the shaders sample the volume from, bricked or not
+        VolumeTextureBinding texture_binding() const {
+            VolumeTextureBinding binding = bricked_texture ? VolumeTextureBinding(*bricked_texture)
+                                                           : VolumeTextureBinding(volume_texture);
+            binding.macro_cells = macro_cells.has_value_ranges() ? &macro_cells : nullptr;
+            binding.gradient_texture = gradient_texture;
+            return binding;
+        }
+
+        // Set by prepare_gl_volume_texture: the texture is uploaded as bricks and these of them aren't empty
+        bool use_bricks = false;
+        std::vector<uint8_t> occupied_bricks;
+
+        // CPU side work of uploading the texture, safe to run on a loading thread. Volumes bigger than
+        // max_texture_size (GL_MAX_3D_TEXTURE_SIZE) or 1 GB are uploaded as bricks and the empty ones are found here.
+        // The macro cells are rebuilt here too.
+        void prepare_gl_volume_texture(int max_texture_size);
+
+        // Create volume_texture (or index_texture) and enqueue its contents on uploader, which streams them
+        // to the GPU over the next frames. The samples are converted to texture_format() on the uploader's threads.
+        void upload_gl_volume_texture(TextureUploader& uploader);
+        void upload_gl_index_texture(TextureUploader& uploader);
+        void upload_gl_bricked_volume_texture(TextureUploader& uploader);
+
+        // Create gradient_texture if precompute_gradients is set. The gradients are computed on the uploader's threads.
+        void upload_gl_gradient_texture(TextureUploader& uploader);
+
+        // Prepare and upload the texture (and gradient texture), blocking until it is on the GPU
+        void load_gl_volume_texture();
         void load_gl_index_texture();
+
+        // Samples of slices [z_begin, z_end), decompressed into buffer if the volume is compressed
+        const uint8_t* read_slices(int z_begin, int z_end, std::vector<uint8_t>& buffer) const;
     };
 
     // Initial volume data loaded in the first screen
     LoadedVolume low_res_volume;
     LoadedVolume hi_res_volume;
 
+    // The scan downsampled by 2, 4, ... up to (not including) the downsample factor of low_res_volume.
+    // With hi_res_volume and low_res_volume they form a mip pyramid the renderers and the exporter pick
+    // a level of, so they don't have to jump straight from one end to the other.
+    // Projects created before the pyramid was written during ingest have no intermediate levels.
+    std::vector<LoadedVolume> mid_res_volumes;
+
+    // Level 0 is hi_res_volume, the last level is low_res_volume
+    int num_volume_levels() const {
+        return int(mid_res_volumes.size()) + 2;
+    }
+
+    const LoadedVolume& volume_level(int level) const;
+
+    // Factor the samples of a level are downsampled by from the full resolution scan
+    int volume_level_factor(int level) const;
+
+    // The coarsest level with at least scale samples per voxel of low_res_volume, or the
+    // full resolution one if none has that many
+    int volume_level_for_scale(double scale) const;
+
     // Topological features
     struct SegmentedFeatures {
         std::vector<uint32_t> buffer_data;
@@ -95,6 +197,13 @@ struct State {
         std::vector<uint32_t> selected_features;
         int num_selected_features = 5;
 
+        // Entries [first, second) of buffer_data changed by the last call to recompute_feature_map.
+        // All of it if its size changed.
+        std::vector<std::pair<size_t, size_t>> changed_ranges;
+
+        // Features for each count that was selected, so moving the slider back and forth doesn't query them again
+        std::map<int, std::vector<contourtree::Feature>> feature_cache;
+
         void recompute_feature_map();
 
     } segmented_features;
@@ -107,19 +216,56 @@ struct State {
         std::string project_name;
 
         int downsample_factor = 8;
+
+        // The contour tree is computed on the low resolution volume downsampled further by this factor,
+        // so lower downsample factors can be segmented without the contour tree exhausting memory
+        int contour_tree_factor = 1;
+
+        // Store the full resolution volume LZ4 compressed. Only used while creating a project.
+        bool compress_full_res = false;
         int start_index;
         int end_index;
 
+        // Digits the image indices are zero padded to. Only used while creating a project.
+        int index_width = 0;
+
         std::string full_res_prefix() {
             std::string str = prefix + std::string("-") + std::to_string(start_index) + std::string("-") + std::to_string(end_index);
             return str;
         }
 
+        // The low resolution volume always has the factor in its name, even a factor of 1, which makes
+        // it a copy of the full resolution volume. Projects find it and its contour tree by this name.
         std::string low_res_prefix() {
             std::string str = prefix + std::string("-") + std::to_string(start_index) + std::string("-") + std::to_string(end_index) + std::string("-") + std::to_string(downsample_factor);
             return str;
         }
 
+        // Prefix of the scan downsampled by factor, one of pyramid_factors(). The last level is at low_res_prefix().
+        std::string level_prefix(int factor) {
+            if (factor <= 1) {
+                return full_res_prefix();
+            }
+            std::string str = prefix + std::string("-") + std::to_string(start_index) + std::string("-") + std::to_string(end_index) + std::string("-") + std::to_string(factor);
+            return str;
+        }
+
+        std::string level_path_prefix(int factor) {
+            return output_dir + "/" + level_prefix(factor);
+        }
+
+        // Downsample factors of the levels of the volume pyramid: 1, 2, 4, ... and downsample_factor.
+        // The first level is the full resolution volume and the last one the low resolution volume,
+        // so there are always at least two.
+        std::vector<int> pyramid_factors() const {
+            std::vector<int> factors = { 1 };
+            for (int factor = 2; factor < downsample_factor; factor *= 2) {
+                factors.push_back(factor);
+            }
+            factors.push_back(std::max(downsample_factor, 1));
+            return factors;
+        }
+
         std::string low_res_path_prefx() {
             return output_dir + "/" + low_res_prefix();
         }
@@ -140,6 +286,14 @@ struct State {
         double dilation_radius = 3.0;
         double meshing_voxel_radius = 1.5;
 
+        // Radii of the opening and closing that clean up the selection before it is dilated, 0 to skip them
+        double opening_radius = 0.0;
+        double closing_radius = 0.0;
+
+        // Threads used by the dilation, 0 for one per core, and the rows each of them takes at a time
+        int dilation_num_threads = 0;
+        int dilation_grain_size = 8;
+
         // Geodesic distances stored at each tet vertex
         Eigen::VectorXd geodesic_dists;
 
@@ -167,20 +321,31 @@ struct State {
 
 
 
-    void load_volume_data(LoadedVolume& volume, std::string prefix, bool load_topology);
+    // Load <output_dir>/<prefix>.raw into volume. If progress is not null it is updated as the samples are read.
+    // Returns false if the samples or the topological features could not be loaded.
+    bool load_volume_data(LoadedVolume& volume, std::string prefix, bool load_topology,
+                          VolumeLoadProgress* progress = nullptr);
+
+    // Open the RawFile named by volume.metadata. Compressed volumes are decompressed into memory
+    // unless keep_compressed is set. volume.statistics are gathered while reading unless they were
+    // loaded with the project, and min_value and max_value are set to the range they give.
+    bool load_volume_samples(LoadedVolume& volume, bool keep_compressed, VolumeLoadProgress* progress = nullptr);
 
     BoundingCage cage;
 
-    void serialize(std::vector<char>& buffer) const;
+    // Save the project in the chunked binary format of utils/project_file.h
+    bool save_project(const std::string& filename) const;
+
+    // Load a project saved by save_project, or one written with igl::serialize by older versions
+    bool load_project(const std::string& filename);
+
+    // Reads the legacy igl::serialize format of old projects, which are no longer written
     void deserialize(const std::vector<char>& buffer);
 };
 
 namespace igl {
 namespace serialization {
 
-template <> inline void serialize(const State& obj, std::vector<char>& buffer) {
-    obj.serialize(buffer);
-}
 template <> inline void deserialize(State& obj, const std::vector<char>& buffer){
     obj.deserialize(buffer);
 }
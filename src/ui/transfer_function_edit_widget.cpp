@@ -3,6 +3,12 @@
 #include <imgui/imgui_internal.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
+#include <cmath>
+
+namespace {
+// Number of bars in the histogram drawn behind the transfer function
+constexpr size_t TF_HISTOGRAM_BINS = 256;
+}
 
 TransferFunctionEditWidget::TransferFunctionEditWidget() {
     TfNode n1 = {0.0, glm::vec4(0.0)};
@@ -11,6 +17,39 @@ TransferFunctionEditWidget::TransferFunctionEditWidget() {
     _transfer_function.push_back(n2);
 }
 
+void TransferFunctionEditWidget::set_histogram(const VolumeStatistics& statistics, double display_min, double display_max) {
+    _histogram.clear();
+    _percentiles = {{ -1.f, -1.f, -1.f }};
+    if (statistics.histogram.empty() || display_max <= display_min) {
+        return;
+    }
+
+    // Rebin the volume histogram into the bars that fit the transfer function range
+    std::vector<double> counts(TF_HISTOGRAM_BINS, 0.0);
+    const double bin_width = (statistics.histogram_max - statistics.histogram_min) / double(statistics.histogram.size());
+    const double display_scale = 1.0 / (display_max - display_min);
+    for (size_t b = 0; b < statistics.histogram.size(); b++) {
+        const double t = (statistics.histogram_min + (double(b) + 0.5) * bin_width - display_min) * display_scale;
+        if (t >= 0.0 && t <= 1.0) {
+            counts[std::min(size_t(t * TF_HISTOGRAM_BINS), TF_HISTOGRAM_BINS - 1)] += double(statistics.histogram[b]);
+        }
+    }
+
+    const double max_count = *std::max_element(counts.begin(), counts.end());
+    if (max_count <= 0.0) {
+        return;
+    }
+    _histogram.resize(TF_HISTOGRAM_BINS);
+    for (size_t i = 0; i < TF_HISTOGRAM_BINS; i++) {
+        _histogram[i] = float(std::log1p(counts[i]) / std::log1p(max_count));
+    }
+
+    const double percentiles[3] = { 0.01, 0.5, 0.99 };
+    for (int i = 0; i < 3; i++) {
+        _percentiles[i] = float((statistics.percentile(percentiles[i]) - display_min) * display_scale);
+    }
+}
+
 bool TransferFunctionEditWidget::post_draw(bool active) {
     constexpr float click_scale = 2.5f;
 
@@ -39,6 +78,31 @@ bool TransferFunctionEditWidget::post_draw(bool active) {
                 ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
         IM_COL32(255, 255, 255, 255));
 
+    // Draw the histogram and percentiles behind the transfer function
+    if (!_histogram.empty()) {
+        const float bar_width = canvas_size.x / float(_histogram.size());
+        for (size_t i = 0; i < _histogram.size(); ++i) {
+            if (_histogram[i] <= 0.f) {
+                continue;
+            }
+            const float x = canvas_pos.x + bar_width * i;
+            draw_list->AddRectFilled(ImVec2(x, canvas_pos.y + canvas_size.y * (1.f - _histogram[i])),
+                                     ImVec2(x + bar_width, canvas_pos.y + canvas_size.y),
+                                     IM_COL32(100, 100, 120, 255));
+        }
+
+        const char* percentile_labels[3] = { "1%", "50%", "99%" };
+        for (int i = 0; i < 3; ++i) {
+            if (_percentiles[i] < 0.f || _percentiles[i] > 1.f) {
+                continue;
+            }
+            const float x = canvas_pos.x + canvas_size.x * _percentiles[i];
+            draw_list->AddLine(ImVec2(x, canvas_pos.y), ImVec2(x, canvas_pos.y + canvas_size.y),
+                               IM_COL32(200, 160, 60, 255));
+            draw_list->AddText(ImVec2(x + 2.f, canvas_pos.y + 2.f), IM_COL32(200, 160, 60, 255), percentile_labels[i]);
+        }
+    }
+
     ImGui::SetCursorScreenPos(canvas_scale_pos);
     ImGui::InvisibleButton("canvas", canvas_capture_size);
     // First render the lines
@@ -1,9 +1,11 @@
 #ifndef TRANSFER_FUNCTION_EDIT_WIDGET_H
 #define TRANSFER_FUNCTION_EDIT_WIDGET_H
 
+#include <array>
 #include <vector>
 #include <glm/glm.hpp>
 #include <utils/gl/volume_renderer.h>
+#include <utils/volume_statistics.h>
 
 class TransferFunctionEditWidget
 {
@@ -23,6 +25,12 @@ class TransferFunctionEditWidget
 
     float _node_radius = 10.0f;
 
+    // Histogram of the volume drawn behind the transfer function, log scaled to [0, 1]
+    std::vector<float> _histogram;
+
+    // Positions of the 1st, 50th and 99th percentile along the transfer function
+    std::array<float, 3> _percentiles = {{ -1.f, -1.f, -1.f }};
+
 public:
     TransferFunctionEditWidget();
 
@@ -36,6 +44,10 @@ public:
     void set_padding_width(float width) { _padding_width = width; }
     void set_color_edit_as_popup(bool enabled) { _color_edit_as_popup = enabled; }
     void clear_dirty_bit() { _transfer_function_dirty = false; }
+
+    // Show the histogram and percentiles in statistics. The normalized values in [display_min, display_max]
+    // are the ones the transfer function maps from [0, 1].
+    void set_histogram(const VolumeStatistics& statistics, double display_min, double display_max);
     bool post_draw(bool active);
 };
 
@@ -0,0 +1,419 @@
+#include "blocked_volume.h"
+#include "datfile.h"
+#include "parallel_for.h"
+
+#include <lz4.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char BLOCKED_VOLUME_MAGIC[8] = { 'F', 'I', 'S', 'H', 'B', 'V', 'O', 'L' };
+
+// Target uncompressed size of a block when the slab depth is picked automatically
+constexpr size_t TARGET_BLOCK_BYTES = 1 << 24;
+
+}
+
+constexpr uint32_t BlockedVolumeFile::VERSION;
+
+
+bool BlockedVolumeFile::open(const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    _logger = logger;
+    _index.clear();
+    if (!_file.open(filename, logger)) {
+        return false;
+    }
+
+    if (_file.size() < sizeof(Header)) {
+        logger->error("Blocked volume '{}' is too small to hold a header.", filename);
+        _file.close();
+        return false;
+    }
+    std::memcpy(&_header, _file.data(), sizeof(Header));
+    if (std::memcmp(_header.magic, BLOCKED_VOLUME_MAGIC, sizeof(BLOCKED_VOLUME_MAGIC)) != 0) {
+        logger->error("'{}' is not a blocked volume file.", filename);
+        _file.close();
+        return false;
+    }
+    if (_header.version != VERSION) {
+        logger->error("Blocked volume '{}' has version {} but only version {} is supported.",
+                      filename, _header.version, VERSION);
+        _file.close();
+        return false;
+    }
+    if (voxel_format_size(format()) == 0 || _header.slab_depth == 0 ||
+            _header.num_blocks != (_header.d + _header.slab_depth - 1) / _header.slab_depth) {
+        logger->error("Blocked volume '{}' has an invalid header.", filename);
+        _file.close();
+        return false;
+    }
+
+    const size_t index_bytes = size_t(_header.num_blocks) * sizeof(BlockEntry);
+    if (_file.size() < sizeof(Header) + index_bytes) {
+        logger->error("Blocked volume '{}' is truncated.", filename);
+        _file.close();
+        return false;
+    }
+    _index.resize(_header.num_blocks);
+    std::memcpy(_index.data(), _file.data() + sizeof(Header), index_bytes);
+    for (size_t b = 0; b < _index.size(); b++) {
+        if (_index[b].offset + _index[b].compressed_size > _file.size()) {
+            logger->error("Block {} of blocked volume '{}' lies outside the file.", b, filename);
+            _index.clear();
+            _file.close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t BlockedVolumeFile::block_bytes(size_t block) const {
+    const size_t z_begin = block * _header.slab_depth;
+    const size_t z_end = std::min<size_t>(_header.d, z_begin + _header.slab_depth);
+    return (z_end - z_begin) * slice_bytes();
+}
+
+bool BlockedVolumeFile::decompress_block(size_t block, uint8_t* out) const {
+    const BlockEntry& entry = _index[block];
+    const size_t num_bytes = block_bytes(block);
+    const char* src = reinterpret_cast<const char*>(_file.data() + entry.offset);
+
+    if (entry.compressed_size == num_bytes) {
+        std::memcpy(out, src, num_bytes);
+        return true;
+    }
+
+    const int decompressed = LZ4_decompress_safe(src, reinterpret_cast<char*>(out),
+                                                 int(entry.compressed_size), int(num_bytes));
+    if (decompressed != int(num_bytes)) {
+        _logger->error("Failed to decompress block {} of blocked volume '{}'.", block, _file.filename());
+        return false;
+    }
+    return true;
+}
+
+bool BlockedVolumeFile::read_slices(int z_begin, int z_end, uint8_t* out) const {
+    z_begin = std::max(z_begin, 0);
+    z_end = std::min(z_end, int(_header.d));
+    if (z_end <= z_begin) {
+        return true;
+    }
+
+    const int slab_depth = this->slab_depth();
+    const size_t first_block = size_t(z_begin / slab_depth);
+    const size_t last_block = size_t((z_end - 1) / slab_depth);
+    const size_t slice_bytes = this->slice_bytes();
+
+    std::atomic_bool ok(true);
+    parallel_for_chunks(first_block, last_block + 1, 1, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> scratch;
+        for (size_t b = begin; b < end; b++) {
+            const int block_z_begin = int(b) * slab_depth;
+            const int block_z_end = std::min(block_z_begin + slab_depth, int(_header.d));
+            const int copy_z_begin = std::max(block_z_begin, z_begin);
+            const int copy_z_end = std::min(block_z_end, z_end);
+            uint8_t* dst = out + size_t(copy_z_begin - z_begin) * slice_bytes;
+
+            if (copy_z_begin == block_z_begin && copy_z_end == block_z_end) {
+                ok = decompress_block(b, dst) && ok;
+            } else {
+                // Only part of this block was asked for
+                scratch.resize(block_bytes(b));
+                if (decompress_block(b, scratch.data())) {
+                    std::memcpy(dst, scratch.data() + size_t(copy_z_begin - block_z_begin) * slice_bytes,
+                                size_t(copy_z_end - copy_z_begin) * slice_bytes);
+                } else {
+                    ok = false;
+                }
+            }
+        }
+    });
+
+    return ok;
+}
+
+bool BlockedVolumeFile::read(VolumeData& out, VolumeLoadProgress* progress, VolumeStatistics* statistics) const {
+    out.allocate(num_voxels(), format());
+    if (progress) {
+        progress->bytes_total = out.size_in_bytes();
+        progress->bytes_done = 0;
+    }
+
+    uint8_t* dst = out.mutable_bytes();
+    const size_t voxel_size = voxel_format_size(format());
+    const size_t block_stride = size_t(_header.slab_depth) * slice_bytes();
+    VolumeStatisticsBuilder builder(format());
+    std::atomic_bool ok(true);
+    parallel_for_chunks(0, num_blocks(), 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            uint8_t* block = dst + b * block_stride;
+            if (!decompress_block(b, block)) {
+                ok = false;
+                continue;
+            }
+            if (statistics) {
+                builder.add(block, block_bytes(b) / voxel_size);
+            }
+            if (progress) {
+                progress->bytes_done += block_bytes(b);
+            }
+        }
+    });
+
+    if (!ok) {
+        out.clear();
+        return false;
+    }
+    if (statistics) {
+        if (builder.needs_histogram_pass()) {
+            parallel_for_chunks(0, num_blocks(), 1, [&](size_t begin, size_t end) {
+                for (size_t b = begin; b < end; b++) {
+                    builder.add_to_histogram(dst + b * block_stride, block_bytes(b) / voxel_size);
+                }
+            });
+        }
+        builder.finish(*statistics);
+    }
+    return true;
+}
+
+bool BlockedVolumeFile::compute_statistics(VolumeStatistics& statistics) const {
+    const size_t voxel_size = voxel_format_size(format());
+    VolumeStatisticsBuilder builder(format());
+    std::atomic_bool ok(true);
+
+    auto for_each_block = [&](bool histogram_pass) {
+        parallel_for_chunks(0, num_blocks(), 1, [&](size_t begin, size_t end) {
+            std::vector<uint8_t> scratch;
+            for (size_t b = begin; b < end; b++) {
+                scratch.resize(block_bytes(b));
+                if (!decompress_block(b, scratch.data())) {
+                    ok = false;
+                    continue;
+                }
+                if (histogram_pass) {
+                    builder.add_to_histogram(scratch.data(), scratch.size() / voxel_size);
+                } else {
+                    builder.add(scratch.data(), scratch.size() / voxel_size);
+                }
+            }
+        });
+    };
+
+    for_each_block(false);
+    if (ok && builder.needs_histogram_pass()) {
+        for_each_block(true);
+    }
+    if (!ok) {
+        return false;
+    }
+    builder.finish(statistics);
+    return true;
+}
+
+
+bool BlockedVolumeWriter::open(const std::string& filename, const Eigen::RowVector3i& dims, VoxelFormat format,
+                               int slab_depth, std::shared_ptr<spdlog::logger> logger) {
+    _filename = filename;
+    _logger = logger;
+    _slice_bytes = size_t(dims[0]) * size_t(dims[1]) * voxel_format_size(format);
+    if (_slice_bytes == 0 || dims[2] <= 0) {
+        logger->error("Cannot write blocked volume '{}', the volume is empty.", filename);
+        return false;
+    }
+    if (slab_depth <= 0) {
+        slab_depth = int(std::max<size_t>(1, TARGET_BLOCK_BYTES / _slice_bytes));
+    }
+    if (size_t(slab_depth) * _slice_bytes > size_t(LZ4_MAX_INPUT_SIZE)) {
+        logger->error("Cannot write blocked volume '{}', its slices are too big to compress.", filename);
+        return false;
+    }
+
+    std::memcpy(_header.magic, BLOCKED_VOLUME_MAGIC, sizeof(_header.magic));
+    _header.version = BlockedVolumeFile::VERSION;
+    _header.format = static_cast<uint32_t>(format);
+    _header.w = uint32_t(dims[0]);
+    _header.h = uint32_t(dims[1]);
+    _header.d = uint32_t(dims[2]);
+    _header.slab_depth = uint32_t(slab_depth);
+    _header.num_blocks = uint32_t((dims[2] + slab_depth - 1) / slab_depth);
+    _header.reserved = 0;
+
+    _out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!_out.good()) {
+        logger->error("Could not open '{}' for writing.", filename);
+        return false;
+    }
+
+    // The index is written last, once the block offsets are known
+    _index.assign(_header.num_blocks, BlockedVolumeFile::BlockEntry());
+    _out.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    _out.write(reinterpret_cast<const char*>(_index.data()), _index.size() * sizeof(BlockedVolumeFile::BlockEntry));
+    _offset = sizeof(_header) + _index.size() * sizeof(BlockedVolumeFile::BlockEntry);
+    _next_block = 0;
+    _slices_written = 0;
+    _pending.clear();
+    _pending_slices = 0;
+    return true;
+}
+
+bool BlockedVolumeWriter::write_slices(const uint8_t* slices, int num_slices) {
+    if (_slices_written + num_slices > int(_header.d)) {
+        _logger->error("Too many slices written to blocked volume '{}'.", _filename);
+        return false;
+    }
+    _slices_written += num_slices;
+    const int slab_depth = int(_header.slab_depth);
+
+    // Complete the block started by the previous slices first
+    if (_pending_slices > 0) {
+        const int n = std::min(num_slices, slab_depth - _pending_slices);
+        _pending.insert(_pending.end(), slices, slices + size_t(n) * _slice_bytes);
+        _pending_slices += n;
+        slices += size_t(n) * _slice_bytes;
+        num_slices -= n;
+        if (_pending_slices == slab_depth) {
+            if (!write_blocks(_pending.data(), 1)) {
+                return false;
+            }
+            _pending.clear();
+            _pending_slices = 0;
+        }
+    }
+
+    const int num_blocks = num_slices / slab_depth;
+    if (num_blocks > 0 && !write_blocks(slices, size_t(num_blocks))) {
+        return false;
+    }
+    slices += size_t(num_blocks) * size_t(slab_depth) * _slice_bytes;
+    num_slices -= num_blocks * slab_depth;
+
+    _pending.insert(_pending.end(), slices, slices + size_t(num_slices) * _slice_bytes);
+    _pending_slices += num_slices;
+    return true;
+}
+
+bool BlockedVolumeWriter::write_blocks(const uint8_t* src, size_t num_blocks) {
+    const size_t slab_depth = _header.slab_depth;
+    const size_t batch_size = default_num_threads();
+    _compressed.resize(batch_size);
+
+    // Compress a batch of blocks in parallel, then append them to the file in order
+    for (size_t batch_begin = 0; batch_begin < num_blocks; batch_begin += batch_size) {
+        const size_t batch_end = std::min(num_blocks, batch_begin + batch_size);
+        parallel_for_chunks(batch_begin, batch_end, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const size_t z_begin = (_next_block + i) * slab_depth;
+                const size_t z_end = std::min<size_t>(_header.d, z_begin + slab_depth);
+                const size_t num_bytes = (z_end - z_begin) * _slice_bytes;
+                const char* block = reinterpret_cast<const char*>(src + i * slab_depth * _slice_bytes);
+
+                std::vector<char>& dst = _compressed[i - batch_begin];
+                dst.resize(size_t(LZ4_compressBound(int(num_bytes))));
+                const int compressed_bytes = LZ4_compress_default(block, dst.data(), int(num_bytes), int(dst.size()));
+                if (compressed_bytes <= 0 || size_t(compressed_bytes) >= num_bytes) {
+                    // Incompressible, store the block as is
+                    dst.assign(block, block + num_bytes);
+                } else {
+                    dst.resize(size_t(compressed_bytes));
+                }
+            }
+        });
+
+        for (size_t i = batch_begin; i < batch_end; i++) {
+            const std::vector<char>& block = _compressed[i - batch_begin];
+            BlockedVolumeFile::BlockEntry& entry = _index[_next_block + i];
+            entry.offset = _offset;
+            entry.compressed_size = block.size();
+            _out.write(block.data(), block.size());
+            _offset += block.size();
+        }
+    }
+    _next_block += num_blocks;
+
+    if (!_out) {
+        _logger->error("Error writing blocked volume '{}'.", _filename);
+        return false;
+    }
+    return true;
+}
+
+bool BlockedVolumeWriter::close() {
+    if (_slices_written != int(_header.d)) {
+        _logger->error("Blocked volume '{}' got {} of its {} slices.", _filename, _slices_written, _header.d);
+        _out.close();
+        return false;
+    }
+    if (_pending_slices > 0 && !write_blocks(_pending.data(), 1)) {
+        _out.close();
+        return false;
+    }
+    _pending.clear();
+    _pending_slices = 0;
+    _compressed.clear();
+
+    _out.seekp(sizeof(_header));
+    _out.write(reinterpret_cast<const char*>(_index.data()), _index.size() * sizeof(BlockedVolumeFile::BlockEntry));
+    _out.close();
+    if (!_out) {
+        _logger->error("Error writing blocked volume '{}'.", _filename);
+        return false;
+    }
+    return true;
+}
+
+
+bool write_blocked_volume(const std::string& filename, const VolumeData& data, const Eigen::RowVector3i& dims,
+                          int slab_depth, std::shared_ptr<spdlog::logger> logger) {
+    if (data.empty() || data.size() != size_t(dims[0]) * size_t(dims[1]) * size_t(dims[2])) {
+        logger->error("Cannot write blocked volume '{}', the volume data does not match its dimensions.", filename);
+        return false;
+    }
+
+    BlockedVolumeWriter writer;
+    if (!writer.open(filename, dims, data.format(), slab_depth, logger) ||
+            !writer.write_slices(data.bytes(), dims[2]) || !writer.close()) {
+        return false;
+    }
+    logger->debug("Wrote blocked volume '{}', {} -> {} bytes", filename, data.size_in_bytes(), writer.compressed_size());
+    return true;
+}
+
+
+bool compress_datfile_volume(const std::string& datfile_path, std::shared_ptr<spdlog::logger> logger) {
+    DatFile datfile;
+    if (!datfile.deserialize(datfile_path, logger)) {
+        return false;
+    }
+    if (datfile.m_compression == BLOCKED_VOLUME_COMPRESSION) {
+        return true;
+    }
+
+    const std::string raw_path = datfile.m_directory + "/" + datfile.m_raw_filename;
+    const Eigen::RowVector3i dims(datfile.w, datfile.h, datfile.d);
+    VolumeData data;
+    if (!data.load(raw_path, size_t(dims[0]) * size_t(dims[1]) * size_t(dims[2]),
+                   voxel_format_from_string(datfile.m_format), logger)) {
+        return false;
+    }
+    data.prefetch();
+
+    if (!write_blocked_volume(raw_path + BLOCKED_VOLUME_EXTENSION, data, dims, 0, logger)) {
+        return false;
+    }
+    data.clear();
+
+    datfile.m_raw_filename += BLOCKED_VOLUME_EXTENSION;
+    datfile.m_compression = BLOCKED_VOLUME_COMPRESSION;
+    if (!datfile.serialize(datfile_path, logger)) {
+        return false;
+    }
+    std::remove(raw_path.c_str());
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef BLOCKED_VOLUME_H
+#define BLOCKED_VOLUME_H
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "volume_data.h"
+#include "volume_statistics.h"
+
+
+// Value of the Compression: field of a .dat file whose RawFile is a blocked volume
+constexpr const char* BLOCKED_VOLUME_COMPRESSION = "LZ4";
+
+// Extension appended to the raw file name when a volume is compressed
+constexpr const char* BLOCKED_VOLUME_EXTENSION = ".lz4";
+
+
+// A volume stored as a sequence of independently LZ4 compressed slabs of z-slices, preceded by
+// an index of block offsets. Any range of slices can be decompressed without touching the rest
+// of the file, and the blocks of a range are decompressed in parallel.
+//
+// File layout (little endian):
+//   Header
+//   Block index: num_blocks x { uint64 offset, uint64 compressed_size }
+//   Block data
+// A block whose compressed size equals its uncompressed size is stored as is.
+class BlockedVolumeFile {
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t format;
+        uint32_t w, h, d;
+        uint32_t slab_depth;
+        uint32_t num_blocks;
+        uint32_t reserved;
+    };
+
+    struct BlockEntry {
+        uint64_t offset;
+        uint64_t compressed_size;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+
+    // Map a blocked volume file and validate its header and index
+    bool open(const std::string& filename, std::shared_ptr<spdlog::logger> logger);
+
+    VoxelFormat format() const { return static_cast<VoxelFormat>(_header.format); }
+    Eigen::RowVector3i dims() const { return Eigen::RowVector3i(_header.w, _header.h, _header.d); }
+    int slab_depth() const { return int(_header.slab_depth); }
+    size_t num_blocks() const { return _index.size(); }
+    size_t num_voxels() const { return size_t(_header.w) * size_t(_header.h) * size_t(_header.d); }
+    size_t slice_bytes() const { return size_t(_header.w) * size_t(_header.h) * voxel_format_size(format()); }
+    size_t compressed_size() const { return _file.size(); }
+
+    // Decompress slices [z_begin, z_end) into out, which must hold (z_end - z_begin) slices
+    bool read_slices(int z_begin, int z_end, uint8_t* out) const;
+
+    // Decompress the whole volume into owned storage in out. If statistics is not null they are
+    // gathered from each block right after it is decompressed.
+    bool read(VolumeData& out, VolumeLoadProgress* progress = nullptr, VolumeStatistics* statistics = nullptr) const;
+
+    // Gather the statistics of the samples, decompressing one block at a time per thread
+    bool compute_statistics(VolumeStatistics& statistics) const;
+
+private:
+    bool decompress_block(size_t block, uint8_t* out) const;
+    size_t block_bytes(size_t block) const;
+
+    Header _header;
+    std::vector<BlockEntry> _index;
+    MappedFile _file;
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+
+// Writes a blocked volume file from slices appended in order, so a volume can be compressed as it is
+// produced without ever being stored uncompressed. Whole blocks are compressed straight from the
+// appended slices, a batch of them in parallel. Only the slices of an unfinished block are buffered.
+class BlockedVolumeWriter {
+public:
+    // Create filename for a volume of the given dims and format. A slab_depth of 0 picks the
+    // number of slices per block so blocks are about 16 MB.
+    bool open(const std::string& filename, const Eigen::RowVector3i& dims, VoxelFormat format, int slab_depth,
+              std::shared_ptr<spdlog::logger> logger);
+
+    // Append num_slices slices, which follow the slices appended so far
+    bool write_slices(const uint8_t* slices, int num_slices);
+
+    // Compress the last block, write the block index and close the file. Fails if fewer slices than
+    // the volume has were appended.
+    bool close();
+
+    uint64_t compressed_size() const { return _offset; }
+
+private:
+    // Compress and append the next num_blocks blocks, stored one after the other at src
+    bool write_blocks(const uint8_t* src, size_t num_blocks);
+
+    BlockedVolumeFile::Header _header;
+    std::vector<BlockedVolumeFile::BlockEntry> _index;
+    std::ofstream _out;
+    std::string _filename;
+    std::shared_ptr<spdlog::logger> _logger;
+    size_t _slice_bytes = 0;
+    size_t _next_block = 0;
+    int _slices_written = 0;
+    uint64_t _offset = 0;
+
+    // Slices of the block after the last one written
+    std::vector<uint8_t> _pending;
+    int _pending_slices = 0;
+
+    // Compressed blocks of the batch being written
+    std::vector<std::vector<char>> _compressed;
+};
+
+// Write data, a volume with the given dims, as a blocked volume file.
+// A slab_depth of 0 picks the number of slices per block so blocks are about 16 MB.
+bool write_blocked_volume(const std::string& filename, const VolumeData& data, const Eigen::RowVector3i& dims,
+                          int slab_depth, std::shared_ptr<spdlog::logger> logger);
+
+// Compress the RawFile referenced by a .dat file into a blocked volume next to it, point the
+// .dat file at the compressed copy and delete the uncompressed one.
+bool compress_datfile_volume(const std::string& datfile_path, std::shared_ptr<spdlog::logger> logger);
+
+#endif // BLOCKED_VOLUME_H
@@ -1,4 +1,5 @@
 #include "bounding_cage.h"
+#include "project_file.h"
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -762,7 +763,94 @@ void BoundingCage::deserialize(const std::vector<char>& buffer) {
     igl::deserialize(SV, "skeleton_vertices", buffer);
     igl::deserialize(SV_smooth, "smooth_skeleton_vertices", buffer);
     igl::deserialize(_keyframe_bounding_box, "keyframe_bbox", buffer);
+    rebuild_from_keyframes(kfs);
+}
+
+void BoundingCage::write(ProjectFileWriter& writer, const std::string& prefix) const {
+    const int n = num_keyframes();
+    Eigen::MatrixXd orientations(n, 9), origins(n, 3), centroids(n, 2);
+    Eigen::VectorXd indices(n), angles(n);
+    Eigen::VectorXi in_cage(n), num_vertices(n);
+    int total_vertices = 0;
+    for (const BoundingCage::KeyFrame& kf : keyframes) {
+        total_vertices += int(kf._vertices_2d.rows());
+    }
+    Eigen::MatrixXd vertices(total_vertices, 2);
+
+    int i = 0, v = 0;
+    for (const BoundingCage::KeyFrame& kf : keyframes) {
+        orientations.row(i) = Eigen::Map<const Eigen::RowVectorXd>(kf._orientation.data(), 9);
+        origins.row(i) = kf._origin;
+        centroids.row(i) = kf._centroid_2d;
+        indices[i] = kf._index;
+        angles[i] = kf._angle;
+        in_cage[i] = kf._in_cage ? 1 : 0;
+        num_vertices[i] = int(kf._vertices_2d.rows());
+        vertices.block(v, 0, kf._vertices_2d.rows(), 2) = kf._vertices_2d;
+        v += int(kf._vertices_2d.rows());
+        i += 1;
+    }
+
+    writer.write_matrix(prefix + ".keyframe_orientations", orientations);
+    writer.write_matrix(prefix + ".keyframe_origins", origins);
+    writer.write_matrix(prefix + ".keyframe_centroids_2d", centroids);
+    writer.write_matrix(prefix + ".keyframe_indices", indices);
+    writer.write_matrix(prefix + ".keyframe_angles", angles);
+    writer.write_matrix(prefix + ".keyframe_in_cage", in_cage);
+    writer.write_matrix(prefix + ".keyframe_num_vertices", num_vertices);
+    writer.write_matrix(prefix + ".keyframe_vertices_2d", vertices);
+    writer.write_matrix(prefix + ".skeleton_vertices", SV);
+    writer.write_matrix(prefix + ".smooth_skeleton_vertices", SV_smooth);
+    writer.write_matrix(prefix + ".keyframe_bbox", _keyframe_bounding_box);
+}
+
+bool BoundingCage::read(const ProjectFileReader& reader, const std::string& prefix) {
+    clear();
+    Eigen::MatrixXd orientations, origins, centroids, vertices;
+    Eigen::VectorXd indices, angles;
+    Eigen::VectorXi in_cage, num_vertices;
+    bool ok = reader.read_matrix(prefix + ".keyframe_orientations", orientations);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_origins", origins);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_centroids_2d", centroids);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_indices", indices);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_angles", angles);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_in_cage", in_cage);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_num_vertices", num_vertices);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_vertices_2d", vertices);
+    ok = ok && reader.read_matrix(prefix + ".skeleton_vertices", SV);
+    ok = ok && reader.read_matrix(prefix + ".smooth_skeleton_vertices", SV_smooth);
+    ok = ok && reader.read_matrix(prefix + ".keyframe_bbox", _keyframe_bounding_box);
+    if (!ok) {
+        logger->error("BoundingCage read is missing chunks with prefix '{}'", prefix);
+        return false;
+    }
+
+    const Eigen::Index n = orientations.rows();
+    if (n < 2 || orientations.cols() != 9 || origins.rows() != n || centroids.rows() != n ||
+            indices.rows() != n || angles.rows() != n || in_cage.rows() != n || num_vertices.rows() != n ||
+            vertices.cols() != 2 || num_vertices.sum() != vertices.rows() || num_vertices.minCoeff() < 0) {
+        logger->error("BoundingCage read found inconsistent keyframe arrays with prefix '{}'", prefix);
+        return false;
+    }
+
+    std::vector<BoundingCage::KeyFrame> kfs(n);
+    Eigen::Index v = 0;
+    for (Eigen::Index i = 0; i < n; i++) {
+        BoundingCage::KeyFrame& kf = kfs[i];
+        kf._orientation = Eigen::Map<const Eigen::Matrix3d>(orientations.row(i).eval().data());
+        kf._origin = origins.row(i);
+        kf._centroid_2d = centroids.row(i);
+        kf._index = indices[i];
+        kf._angle = angles[i];
+        kf._in_cage = in_cage[i] != 0;
+        kf._vertices_2d = vertices.block(v, 0, num_vertices[i], 2);
+        v += num_vertices[i];
+    }
+    rebuild_from_keyframes(kfs);
+    return true;
+}
 
+void BoundingCage::rebuild_from_keyframes(const std::vector<KeyFrame>& kfs) {
     std::vector<std::shared_ptr<BoundingCage::KeyFrame>> kf_ptrs;
     for (int i = 0; i < kfs.size(); i++) {
         std::shared_ptr<BoundingCage::KeyFrame> kf(new BoundingCage::KeyFrame(kfs[i]));
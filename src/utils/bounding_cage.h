@@ -10,6 +10,9 @@
 
 #include <igl/serialize.h>
 
+class ProjectFileWriter;
+class ProjectFileReader;
+
 class BoundingCage {
 public:
     class KeyFrame;
@@ -28,6 +31,10 @@ private:
     ///
     std::shared_ptr<KeyFrame> split_internal(std::shared_ptr<KeyFrame> kf);
 
+    /// Rebuild the Cells of the bounding cage from keyframes loaded from a file.
+    ///
+    void rebuild_from_keyframes(const std::vector<KeyFrame>& kfs);
+
     /// Skeleton Vertices
     ///
     Eigen::MatrixXd SV;
@@ -611,6 +618,12 @@ public:
     void serialize(std::vector<char>& buffer) const;
     void deserialize(const std::vector<char>& buffer);
 
+    /// Write the bounding cage to (or read it from) project file chunks whose names start with prefix.
+    /// The keyframes are stored as one array per field rather than one record per keyframe.
+    ///
+    void write(ProjectFileWriter& writer, const std::string& prefix) const;
+    bool read(const ProjectFileReader& reader, const std::string& prefix);
+
     /// Set the skeleton vertices to whatever the user provides.
     /// There must be at least two vertices, if not the method returns false.
     /// Upon setting the vertices, The
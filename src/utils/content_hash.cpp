@@ -0,0 +1,78 @@
+#include "content_hash.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Bytes hashed per task
+constexpr size_t HASH_CHUNK_SIZE = size_t(1) << 20;
+
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read_u64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    return rotl(acc + input * PRIME_2, 31) * PRIME_1;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME_2;
+    h ^= h >> 29;
+    h *= PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Four independent accumulators keep the multiplies of consecutive words from waiting on each other
+uint64_t hash_chunk(const uint8_t* data, size_t size, uint64_t seed) {
+    uint64_t acc[4] = { seed + PRIME_1, seed + PRIME_2, seed, seed - PRIME_1 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        acc[0] = hash_round(acc[0], read_u64(data + i));
+        acc[1] = hash_round(acc[1], read_u64(data + i + 8));
+        acc[2] = hash_round(acc[2], read_u64(data + i + 16));
+        acc[3] = hash_round(acc[3], read_u64(data + i + 24));
+    }
+    uint64_t h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18) + uint64_t(size);
+    for (; i + 8 <= size; i += 8) {
+        h = hash_round(h, read_u64(data + i));
+    }
+    for (; i < size; i++) {
+        h = hash_round(h, data[i]);
+    }
+    return avalanche(h);
+}
+
+}
+
+
+uint64_t content_hash(const uint8_t* data, size_t size, uint64_t seed) {
+    const size_t num_chunks = (size + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE;
+    std::vector<uint64_t> chunk_hashes(num_chunks);
+    parallel_for_chunks(0, num_chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const size_t offset = c * HASH_CHUNK_SIZE;
+            chunk_hashes[c] = hash_chunk(data + offset, std::min(HASH_CHUNK_SIZE, size - offset), seed);
+        }
+    });
+
+    uint64_t h = seed ^ (uint64_t(size) * PRIME_3);
+    for (uint64_t chunk_hash : chunk_hashes) {
+        h = hash_round(h, chunk_hash);
+    }
+    return avalanche(h);
+}
@@ -0,0 +1,13 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// 64 bit hash of a block of memory, for telling whether data derived from it is stale.
+// Fixed size chunks are hashed in parallel and their hashes combined in order, so the result
+// doesn't depend on the number of threads. Not a cryptographic hash.
+uint64_t content_hash(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+#endif // CONTENT_HASH_H
@@ -0,0 +1,80 @@
+#include "contour_tree_cache.h"
+#include "project_file.h"
+
+#include <fstream>
+
+namespace {
+
+// Bump this when the preprocessing parameters change so older caches are recomputed
+constexpr uint32_t CONTOUR_TREE_CACHE_VERSION = 1;
+
+constexpr const char* CONTOUR_TREE_CACHE_EXTENSION = ".ct.cache";
+
+// Files written by preProcessing() and read back by TopologicalFeatures::loadData() and load_volume_data()
+constexpr const char* CONTOUR_TREE_FILES[] = { ".rg.dat", ".rg.bin", ".order.dat", ".order.bin", ".part.raw" };
+
+// Size of a file, or -1 if it can't be opened
+int64_t file_size(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return -1;
+    }
+    return int64_t(in.tellg());
+}
+
+}
+
+
+bool contour_tree_cache_valid(const std::string& path_prefix, uint64_t hash, const Eigen::Vector3i& dims,
+                              std::shared_ptr<spdlog::logger> logger) {
+    const std::string manifest = path_prefix + CONTOUR_TREE_CACHE_EXTENSION;
+    if (!ProjectFile::is_project_file(manifest)) {
+        return false;
+    }
+    ProjectFileReader reader;
+    if (!reader.open(manifest, logger)) {
+        return false;
+    }
+
+    uint32_t version = 0;
+    uint64_t cached_hash = 0;
+    Eigen::Vector3i cached_dims;
+    if (!reader.read_value("version", version) || version != CONTOUR_TREE_CACHE_VERSION ||
+            !reader.read_value("content_hash", cached_hash) || cached_hash != hash ||
+            !reader.read_matrix("dims", cached_dims) || cached_dims != dims) {
+        logger->debug("Contour tree cache '{}' is for a different volume", manifest);
+        return false;
+    }
+
+    for (const char* suffix : CONTOUR_TREE_FILES) {
+        int64_t cached_size = -1;
+        if (!reader.read_value(std::string("files") + suffix, cached_size) ||
+                file_size(path_prefix + suffix) != cached_size) {
+            logger->debug("Contour tree cache '{}' is stale, '{}' changed", manifest, path_prefix + suffix);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_contour_tree_cache(const std::string& path_prefix, uint64_t hash, const Eigen::Vector3i& dims,
+                              std::shared_ptr<spdlog::logger> logger) {
+    for (const char* suffix : CONTOUR_TREE_FILES) {
+        if (file_size(path_prefix + suffix) < 0) {
+            logger->warn("Not caching the contour tree of '{}', '{}' is missing", path_prefix, path_prefix + suffix);
+            return false;
+        }
+    }
+
+    ProjectFileWriter writer;
+    if (!writer.open(path_prefix + CONTOUR_TREE_CACHE_EXTENSION, logger)) {
+        return false;
+    }
+    writer.write_value("version", CONTOUR_TREE_CACHE_VERSION);
+    writer.write_value("content_hash", hash);
+    writer.write_matrix("dims", dims);
+    for (const char* suffix : CONTOUR_TREE_FILES) {
+        writer.write_value(std::string("files") + suffix, file_size(path_prefix + suffix));
+    }
+    return writer.close();
+}
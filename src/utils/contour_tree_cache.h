@@ -0,0 +1,31 @@
+#ifndef CONTOUR_TREE_CACHE_H
+#define CONTOUR_TREE_CACHE_H
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+
+// Computing the contour tree of a volume (preProcessing() in ContourTree) writes the tree, its
+// simplification order and the partition volume to files next to the volume. A small manifest,
+// <prefix>.ct.cache, records the hash of the samples they were computed from and the size of each
+// file so reopening a project can reuse them instead of computing them again.
+//
+// When the tree isn't computed on the volume itself (it is downsampled by contour_tree_factor or
+// quantized to 8 bits), its input is written to <volume prefix>-ct<factor>.raw, without a .dat file,
+// and the tree files are named after that prefix. All of these are cache artifacts: they stay next to
+// the project so the tree can be reused, and deleting them only means the tree is computed again.
+
+// True if the contour tree files at path_prefix were computed from a volume with these dimensions
+// whose samples hash to hash, and none of the files changed since
+bool contour_tree_cache_valid(const std::string& path_prefix, uint64_t hash, const Eigen::Vector3i& dims,
+                              std::shared_ptr<spdlog::logger> logger);
+
+// Record that the contour tree files at path_prefix were just computed from the given volume
+bool write_contour_tree_cache(const std::string& path_prefix, uint64_t hash, const Eigen::Vector3i& dims,
+                              std::shared_ptr<spdlog::logger> logger);
+
+#endif // CONTOUR_TREE_CACHE_H
@@ -98,6 +98,10 @@ bool DatFile::serialize(const std::string& filename, std::shared_ptr<spdlog::log
         of << "Format: " << m_format << endl;
         logger->debug("Wrote Format: {}", m_format);
     }
+    if (m_compression.size() > 0) {
+        of << "Compression: " << m_compression << endl;
+        logger->debug("Wrote Compression: {}", m_compression);
+    }
     if (m_mesh_filename.size() > 0) {
         of << "SurfaceMesh: " << m_mesh_filename << endl;
         logger->debug("Wrote SurfaceMesh: {}", m_mesh_filename);
@@ -144,6 +148,9 @@ bool DatFile::deserialize(const std::string& filename, std::shared_ptr<spdlog::l
         } else if (token == "Format:") {
             is >> m_format;
             logger->debug("Format: {}", m_format);
+        } else if (token == "Compression:") {
+            is >> m_compression;
+            logger->debug("Compression: {}", m_compression);
         } else if(token == "SurfaceMesh:") {
             is >> m_mesh_filename;
             logger->debug("SurfaceMesh: {}", m_mesh_filename);
@@ -22,6 +22,7 @@ public:
   std::string m_raw_filename;
   std::string m_mesh_filename;
   std::string m_format;
+  std::string m_compression;
   std::string m_filename;
   std::string m_directory;
   std::string m_basename;
@@ -43,6 +44,7 @@ template <> inline void serialize(const DatFile& obj, std::vector<char>& buffer)
     igl::serialize(obj.m_raw_filename, std::string("m_raw_filename"), buffer);
     igl::serialize(obj.m_mesh_filename, std::string("m_mesh_filename"), buffer);
     igl::serialize(obj.m_format, std::string("m_format"), buffer);
+    igl::serialize(obj.m_compression, std::string("m_compression"), buffer);
     igl::serialize(obj.m_filename, std::string("m_filename"), buffer);
     igl::serialize(obj.m_directory, std::string("m_directory"), buffer);
     igl::serialize(obj.m_basename, std::string("m_basename"), buffer);
@@ -55,6 +57,7 @@ template <> inline void deserialize(DatFile& obj, const std::vector<char>& buffe
     igl::deserialize(obj.m_raw_filename, std::string("m_raw_filename"), buffer);
     igl::deserialize(obj.m_mesh_filename, std::string("m_mesh_filename"), buffer);
     igl::deserialize(obj.m_format, std::string("m_format"), buffer);
+    igl::deserialize(obj.m_compression, std::string("m_compression"), buffer);
     igl::deserialize(obj.m_filename, std::string("m_filename"), buffer);
     igl::deserialize(obj.m_directory, std::string("m_directory"), buffer);
     igl::deserialize(obj.m_basename, std::string("m_basename"), buffer);
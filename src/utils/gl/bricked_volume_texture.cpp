@@ -0,0 +1,170 @@
+#include "bricked_volume_texture.h"
+#include "voxel_format_gl.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+namespace {
+// Page table entries are RGBA16UI: atlas slot in xyz, 1 in w if the brick is resident
+constexpr size_t PAGE_TABLE_CHANNELS = 4;
+
+constexpr const char* VOLUME_SAMPLING_GLSL = R"(
+  uniform sampler3D volume_texture;
+  uniform usampler3D volume_page_table;
+  uniform int volume_bricked;
+  uniform ivec3 volume_voxel_dims;
+  uniform vec3 volume_atlas_dims_rcp;
+
+  float sample_volume(vec3 uvw) {
+    if (volume_bricked == 0) {
+      return texture(volume_texture, uvw).r;
+    }
+    if (any(lessThan(uvw, vec3(0.0))) || any(greaterThan(uvw, vec3(1.0)))) {
+      return 0.0;
+    }
+
+    // Voxel centers are at integer positions. The brick is picked by the lower corner of the
+    // 2x2x2 voxels the sample is interpolated from, the apron holds the upper ones.
+    vec3 voxel = uvw * vec3(volume_voxel_dims) - 0.5;
+    ivec3 brick = clamp(ivec3(floor(voxel / float(VOLUME_BRICK_PAYLOAD))), ivec3(0),
+                        textureSize(volume_page_table, 0) - 1);
+    uvec4 entry = texelFetch(volume_page_table, brick, 0);
+    if (entry.w == 0u) {
+      return 0.0;
+    }
+    vec3 atlas_voxel = vec3(ivec3(entry.xyz) * VOLUME_BRICK_SIZE + VOLUME_BRICK_APRON) +
+                       (voxel - vec3(brick * VOLUME_BRICK_PAYLOAD));
+    return texture(volume_texture, (atlas_voxel + 0.5) * volume_atlas_dims_rcp).r;
+  }
+)";
+}
+
+
+bool BrickedVolumeTexture::init(const BrickGrid& grid, size_t num_resident, VoxelFormat format) {
+    destroy();
+    _grid = grid;
+    _format = format;
+    _num_resident = 0;
+    _page_table.assign(grid.num_bricks() * PAGE_TABLE_CHANNELS, 0);
+
+    // Lay the bricks out in rows, then layers, of an atlas no bigger than the largest 3D texture
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_texture_size);
+    const size_t max_bricks = size_t(max_texture_size / VOLUME_BRICK_SIZE);
+    const size_t n = std::max<size_t>(num_resident, 1);
+    const size_t ax = std::min(n, max_bricks);
+    const size_t ay = std::min((n + ax - 1) / ax, max_bricks);
+    const size_t az = (n + ax*ay - 1) / (ax*ay);
+    if (ax == 0 || az > max_bricks) {
+        return false;
+    }
+    _atlas_bricks = glm::ivec3(int(ax), int(ay), int(az));
+    const glm::ivec3 dims = atlas_dims();
+
+    glGenTextures(1, &_atlas_texture);
+    glBindTexture(GL_TEXTURE_3D, _atlas_texture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, gl_internal_format(format), dims.x, dims.y, dims.z, 0,
+                 GL_RED, gl_pixel_type(format), nullptr);
+
+    glGenTextures(1, &_page_table_texture);
+    glBindTexture(GL_TEXTURE_3D, _page_table_texture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void BrickedVolumeTexture::destroy() {
+    if (_atlas_texture != 0) {
+        glDeleteTextures(1, &_atlas_texture);
+        _atlas_texture = 0;
+    }
+    if (_page_table_texture != 0) {
+        glDeleteTextures(1, &_page_table_texture);
+        _page_table_texture = 0;
+    }
+    _page_table.clear();
+    _num_resident = 0;
+}
+
+glm::ivec3 BrickedVolumeTexture::add_brick(int bx, int by, int bz) {
+    const size_t slot = _num_resident++;
+    const int sx = int(slot % size_t(_atlas_bricks.x));
+    const int sy = int((slot / size_t(_atlas_bricks.x)) % size_t(_atlas_bricks.y));
+    const int sz = int(slot / (size_t(_atlas_bricks.x) * size_t(_atlas_bricks.y)));
+
+    uint16_t* entry = &_page_table[((size_t(bz) * _grid.ny + by) * _grid.nx + bx) * PAGE_TABLE_CHANNELS];
+    entry[0] = uint16_t(sx);
+    entry[1] = uint16_t(sy);
+    entry[2] = uint16_t(sz);
+    entry[3] = 1;
+    return glm::ivec3(sx, sy, sz) * VOLUME_BRICK_SIZE;
+}
+
+void BrickedVolumeTexture::finish() {
+    glBindTexture(GL_TEXTURE_3D, _page_table_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16UI, _grid.nx, _grid.ny, _grid.nz, 0,
+                 GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, _page_table.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+size_t BrickedVolumeTexture::atlas_size_in_bytes() const {
+    const glm::ivec3 dims = atlas_dims();
+    return size_t(dims.x) * size_t(dims.y) * size_t(dims.z) * voxel_format_size(_format);
+}
+
+
+VolumeTextureBinding::VolumeTextureBinding(const BrickedVolumeTexture& bricked) {
+    texture = bricked.atlas_texture();
+    page_table = bricked.page_table_texture();
+    volume_dims = glm::ivec3(bricked.grid().w, bricked.grid().h, bricked.grid().d);
+    atlas_dims_rcp = glm::vec3(1.f) / glm::vec3(bricked.atlas_dims());
+}
+
+void VolumeSamplingUniforms::init(GLuint program) {
+    volume_texture = glGetUniformLocation(program, "volume_texture");
+    page_table = glGetUniformLocation(program, "volume_page_table");
+    bricked = glGetUniformLocation(program, "volume_bricked");
+    volume_dims = glGetUniformLocation(program, "volume_voxel_dims");
+    atlas_dims_rcp = glGetUniformLocation(program, "volume_atlas_dims_rcp");
+}
+
+std::string add_volume_sampling_glsl(const char* shader) {
+    std::string source(shader);
+    std::string::size_type version = source.find("#version");
+    std::string::size_type line_end = version == std::string::npos ? 0 : source.find('\n', version);
+    line_end = line_end == std::string::npos ? source.size() : line_end + 1;
+
+    const std::string constants =
+        "  const int VOLUME_BRICK_SIZE = " + std::to_string(VOLUME_BRICK_SIZE) + ";\n" +
+        "  const int VOLUME_BRICK_APRON = " + std::to_string(VOLUME_BRICK_APRON) + ";\n" +
+        "  const int VOLUME_BRICK_PAYLOAD = " + std::to_string(VOLUME_BRICK_PAYLOAD) + ";\n";
+    source.insert(line_end, constants + VOLUME_SAMPLING_GLSL);
+    return source;
+}
+
+void bind_volume_texture(const VolumeSamplingUniforms& uniforms, const VolumeTextureBinding& volume, GLint unit) {
+    // The page table sampler is always pointed at its own unit, samplers of different types can't share one
+    glActiveTexture(GL_TEXTURE0 + VOLUME_PAGE_TABLE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_3D, volume.page_table);
+    glUniform1i(uniforms.page_table, VOLUME_PAGE_TABLE_TEXTURE_UNIT);
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, volume.texture);
+    glUniform1i(uniforms.volume_texture, unit);
+
+    glUniform1i(uniforms.bricked, volume.bricked() ? 1 : 0);
+    glUniform3iv(uniforms.volume_dims, 1, glm::value_ptr(volume.volume_dims));
+    glUniform3fv(uniforms.atlas_dims_rcp, 1, glm::value_ptr(volume.atlas_dims_rcp));
+}
@@ -0,0 +1,104 @@
+#ifndef BRICKED_VOLUME_TEXTURE_H
+#define BRICKED_VOLUME_TEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../macro_cells.h"
+#include "../volume_bricks.h"
+#include "../volume_data.h"
+
+
+// Texture unit the page table of a bricked volume is bound to. The shaders that sample volumes use units 0-4.
+constexpr GLint VOLUME_PAGE_TABLE_TEXTURE_UNIT = 5;
+
+
+// A volume stored on the GPU as the non-empty bricks of a BrickGrid, packed into an atlas texture.
+// A page table texture with one texel per brick holds the position of the brick in the atlas in xyz
+// and 1 in w if the brick is resident. Empty bricks aren't stored and sample as 0.
+class BrickedVolumeTexture {
+public:
+    BrickedVolumeTexture() = default;
+    BrickedVolumeTexture(const BrickedVolumeTexture&) = delete;
+    BrickedVolumeTexture& operator=(const BrickedVolumeTexture&) = delete;
+
+    // Allocate an atlas with room for num_resident bricks of the given format and an empty page table.
+    // Returns false if that many bricks don't fit in a 3D texture.
+    bool init(const BrickGrid& grid, size_t num_resident, VoxelFormat format);
+
+    void destroy();
+
+    // Give brick (bx, by, bz) the next free slot of the atlas and return the voxel the slot starts at.
+    // The caller uploads the VOLUME_BRICK_VOXELS samples of the brick there.
+    glm::ivec3 add_brick(int bx, int by, int bz);
+
+    // Upload the page table once every resident brick has been added
+    void finish();
+
+    const BrickGrid& grid() const { return _grid; }
+    VoxelFormat format() const { return _format; }
+    GLuint atlas_texture() const { return _atlas_texture; }
+    GLuint page_table_texture() const { return _page_table_texture; }
+    glm::ivec3 atlas_dims() const { return _atlas_bricks * VOLUME_BRICK_SIZE; }
+    size_t num_resident() const { return _num_resident; }
+
+    // Bytes of GPU memory used by the atlas
+    size_t atlas_size_in_bytes() const;
+
+private:
+    BrickGrid _grid;
+    VoxelFormat _format = VoxelFormat::UINT8;
+    GLuint _atlas_texture = 0;
+    GLuint _page_table_texture = 0;
+
+    // Number of bricks along each axis of the atlas
+    glm::ivec3 _atlas_bricks = glm::ivec3(0);
+    size_t _num_resident = 0;
+    std::vector<uint16_t> _page_table;
+};
+
+
+// What a shader samples a volume from: either a plain 3D texture or a bricked one.
+// Converts implicitly from both so the renderers take either.
+struct VolumeTextureBinding {
+    VolumeTextureBinding(GLuint texture = 0) : texture(texture) {}
+    VolumeTextureBinding(const BrickedVolumeTexture& bricked);
+
+    bool bricked() const { return page_table != 0; }
+
+    GLuint texture = 0;
+    GLuint page_table = 0;
+    glm::ivec3 volume_dims = glm::ivec3(0);
+    glm::vec3 atlas_dims_rcp = glm::vec3(0.f);
+
+    // Summary of the volume the renderers skip empty space with, or null to sample every step
+    const MacroCellGrid* macro_cells = nullptr;
+
+    // Precomputed gradients of the volume (see volume_gradients.h), or 0 to take central differences
+    GLuint gradient_texture = 0;
+};
+
+// Uniforms declared by add_volume_sampling_glsl
+struct VolumeSamplingUniforms {
+    GLint volume_texture = -1;
+    GLint page_table = -1;
+    GLint bricked = -1;
+    GLint volume_dims = -1;
+    GLint atlas_dims_rcp = -1;
+
+    void init(GLuint program);
+};
+
+// Insert the declaration of `float sample_volume(vec3 uvw)` right after the #version line of a
+// shader. It samples the volume bound with bind_volume_texture, bricked or not, and returns 0 outside of it.
+std::string add_volume_sampling_glsl(const char* shader);
+
+// Bind volume to texture unit `unit` (and its page table to VOLUME_PAGE_TABLE_TEXTURE_UNIT) for sample_volume.
+// The program the uniforms belong to must be in use.
+void bind_volume_texture(const VolumeSamplingUniforms& uniforms, const VolumeTextureBinding& volume, GLint unit);
+
+#endif // BRICKED_VOLUME_TEXTURE_H
@@ -0,0 +1,101 @@
+#include "macro_cell_texture.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+constexpr const char* EMPTY_SPACE_SKIPPING_GLSL = R"(
+  uniform sampler3D macro_cells;
+  uniform int macro_cells_enabled;
+  uniform vec3 macro_cell_extent;
+
+  float empty_space_skip(vec3 uvw, vec3 direction, float t_incr) {
+    if (macro_cells_enabled == 0) {
+      return 0.0;
+    }
+    vec3 cell = floor(uvw / macro_cell_extent);
+    if (any(lessThan(cell, vec3(0.0))) || any(greaterThanEqual(cell, vec3(textureSize(macro_cells, 0))))) {
+      return 0.0;
+    }
+    if (texelFetch(macro_cells, ivec3(cell), 0).r > 0.0) {
+      return 0.0;
+    }
+
+    // Distance to the face of the cell the ray leaves through, rounded up to whole steps so
+    // the samples after the skip are where they would have been without it
+    vec3 safe_direction = mix(vec3(1e-6), direction, greaterThan(abs(direction), vec3(1e-6)));
+    vec3 exit_plane = (cell + step(vec3(0.0), safe_direction)) * macro_cell_extent;
+    vec3 t_exit = (exit_plane - uvw) / safe_direction;
+    float t_skip = max(min(min(t_exit.x, t_exit.y), t_exit.z), 0.0);
+    return max(ceil(t_skip / t_incr), 1.0) * t_incr;
+  }
+)";
+}
+
+
+void MacroCellTexture::update(const MacroCellGrid& grid, const std::vector<uint8_t>& visible) {
+    const glm::ivec3 cells(grid.nx, grid.ny, grid.nz);
+    if (_texture == 0) {
+        glGenTextures(1, &_texture);
+        glBindTexture(GL_TEXTURE_3D, _texture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        _cells = glm::ivec3(0);
+    }
+
+    // The texture holds 0 or 255 so it reads back as 0 or 1
+    std::vector<uint8_t> texels(visible.size());
+    for (size_t i = 0; i < visible.size(); i++) {
+        texels[i] = visible[i] ? 255 : 0;
+    }
+
+    glBindTexture(GL_TEXTURE_3D, _texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (cells != _cells) {
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, cells.x, cells.y, cells.z, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+        _cells = cells;
+    } else {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, cells.x, cells.y, cells.z, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+    _volume_dims = glm::ivec3(grid.w, grid.h, grid.d);
+}
+
+void MacroCellTexture::destroy() {
+    if (_texture != 0) {
+        glDeleteTextures(1, &_texture);
+        _texture = 0;
+    }
+    _cells = glm::ivec3(0);
+    _volume_dims = glm::ivec3(0);
+}
+
+
+void MacroCellUniforms::init(GLuint program) {
+    macro_cells = glGetUniformLocation(program, "macro_cells");
+    enabled = glGetUniformLocation(program, "macro_cells_enabled");
+    cell_extent = glGetUniformLocation(program, "macro_cell_extent");
+}
+
+std::string add_empty_space_skipping_glsl(const std::string& shader) {
+    std::string source(shader);
+    std::string::size_type version = source.find("#version");
+    std::string::size_type line_end = version == std::string::npos ? 0 : source.find('\n', version);
+    line_end = line_end == std::string::npos ? source.size() : line_end + 1;
+    source.insert(line_end, EMPTY_SPACE_SKIPPING_GLSL);
+    return source;
+}
+
+void bind_macro_cells(const MacroCellUniforms& uniforms, const MacroCellTexture* cells) {
+    const bool enabled = cells != nullptr && cells->texture() != 0;
+    glActiveTexture(GL_TEXTURE0 + MACRO_CELL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_3D, enabled ? cells->texture() : 0);
+    glUniform1i(uniforms.macro_cells, MACRO_CELL_TEXTURE_UNIT);
+    glUniform1i(uniforms.enabled, enabled ? 1 : 0);
+    if (enabled) {
+        const glm::vec3 extent = glm::vec3(float(MACRO_CELL_SIZE)) / glm::vec3(cells->volume_dims());
+        glUniform3fv(uniforms.cell_extent, 1, glm::value_ptr(extent));
+    }
+}
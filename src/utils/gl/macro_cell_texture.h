@@ -0,0 +1,58 @@
+#ifndef MACRO_CELL_TEXTURE_H
+#define MACRO_CELL_TEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../macro_cells.h"
+
+
+// Texture unit the macro cells are bound to, after the volume shaders' units 0-4 and the page table
+constexpr GLint MACRO_CELL_TEXTURE_UNIT = 6;
+
+
+// Which macro cells of a volume a ray has to sample, as an R8 texture with one texel per cell:
+// 1 if anything in the cell is visible and 0 if rays can skip it
+class MacroCellTexture {
+public:
+    MacroCellTexture() = default;
+    MacroCellTexture(const MacroCellTexture&) = delete;
+    MacroCellTexture& operator=(const MacroCellTexture&) = delete;
+
+    // Upload visible, one entry per cell of grid, reallocating the texture if the grid changed size
+    void update(const MacroCellGrid& grid, const std::vector<uint8_t>& visible);
+
+    void destroy();
+
+    GLuint texture() const { return _texture; }
+    glm::ivec3 volume_dims() const { return _volume_dims; }
+
+private:
+    GLuint _texture = 0;
+    glm::ivec3 _cells = glm::ivec3(0);
+    glm::ivec3 _volume_dims = glm::ivec3(0);
+};
+
+// Uniforms declared by add_empty_space_skipping_glsl
+struct MacroCellUniforms {
+    GLint macro_cells = -1;
+    GLint enabled = -1;
+    GLint cell_extent = -1;
+
+    void init(GLuint program);
+};
+
+// Insert the declaration of `float empty_space_skip(vec3 uvw, vec3 direction, float t_incr)` right after the
+// #version line of a shader. It returns how far a ray at uvw can advance because the macro cell there
+// is empty, in whole steps of t_incr, or 0 if the cell has to be sampled.
+std::string add_empty_space_skipping_glsl(const std::string& shader);
+
+// Bind cells to MACRO_CELL_TEXTURE_UNIT for empty_space_skip, or turn skipping off if cells is null.
+// The program the uniforms belong to must be in use.
+void bind_macro_cells(const MacroCellUniforms& uniforms, const MacroCellTexture* cells);
+
+#endif // MACRO_CELL_TEXTURE_H
@@ -1,5 +1,6 @@
 #include "selection_renderer.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -102,7 +103,6 @@ constexpr const char* SELECTION_RENDERING_FRAG_SHADER = R"(
   uniform sampler2D entry_texture;
   uniform sampler2D exit_texture;
 
-  uniform sampler3D volume_texture;
   uniform sampler1D transfer_function;
 
   uniform usampler3D index_volume;
@@ -173,14 +173,14 @@ constexpr const char* SELECTION_RENDERING_FRAG_SHADER = R"(
 
   vec3 centralDifferenceGradient(vec3 pos) {
     vec3 f;
-    f.x = texture(volume_texture, pos + vec3(volume_dimensions_rcp.x, 0.0, 0.0)).r;
-    f.y = texture(volume_texture, pos + vec3(0.0, volume_dimensions_rcp.y, 0.0)).r;
-    f.z = texture(volume_texture, pos + vec3(0.0, 0.0, volume_dimensions_rcp.z)).r;
+    f.x = sample_volume(pos + vec3(volume_dimensions_rcp.x, 0.0, 0.0));
+    f.y = sample_volume(pos + vec3(0.0, volume_dimensions_rcp.y, 0.0));
+    f.z = sample_volume(pos + vec3(0.0, 0.0, volume_dimensions_rcp.z));
 
     vec3 b;
-    b.x = texture(volume_texture, pos - vec3(volume_dimensions_rcp.x, 0.0, 0.0)).r;
-    b.y = texture(volume_texture, pos - vec3(0.0, volume_dimensions_rcp.y, 0.0)).r;
-    b.z = texture(volume_texture, pos - vec3(0.0, 0.0, volume_dimensions_rcp.z)).r;
+    b.x = sample_volume(pos - vec3(volume_dimensions_rcp.x, 0.0, 0.0));
+    b.y = sample_volume(pos - vec3(0.0, volume_dimensions_rcp.y, 0.0));
+    b.z = sample_volume(pos - vec3(0.0, 0.0, volume_dimensions_rcp.z));
 
     return (f - b) / 2.0;
   }
@@ -259,12 +259,17 @@ constexpr const char* SELECTION_RENDERING_FRAG_SHADER = R"(
     float t = 0.0;
     while (t < t_end) {
       vec3 sample_pos = entry + t * normalized_ray_direction;
+      float t_skip = empty_space_skip(sample_pos, normalized_ray_direction, t_incr);
+      if (t_skip > 0.0) {
+        t += t_skip;
+        continue;
+      }
 
       uint segVoxel = texture(index_volume, sample_pos).r;
       uint feature = contour.values[segVoxel] + 1;
 
       if (feature != 0) {
-        float value = texture(volume_texture, sample_pos).r;
+        float value = sample_volume(sample_pos);
         vec4 color;
         if (color_by_identifier == 1) {
             const float normFeature = float(feature) / float(contour.nFeatures);
@@ -447,15 +452,16 @@ void SelectionRenderer::initialize(const glm::ivec2& viewport_size)
 
 
     // If the user specified a fragment shader, use that, otherwise, use the default one
-    igl::opengl::create_shader_program(VOLUME_PASS_VERTEX_SHADER, SELECTION_RENDERING_FRAG_SHADER, {},
+    igl::opengl::create_shader_program(VOLUME_PASS_VERTEX_SHADER,
+        add_empty_space_skipping_glsl(add_volume_sampling_glsl(SELECTION_RENDERING_FRAG_SHADER)), {},
         _gl_state.volume_pass.program_object);
 
     _gl_state.volume_pass.uniform_location.entry_texture = glGetUniformLocation(
         _gl_state.volume_pass.program_object, "entry_texture");
     _gl_state.volume_pass.uniform_location.exit_texture = glGetUniformLocation(
         _gl_state.volume_pass.program_object, "exit_texture");
-    _gl_state.volume_pass.uniform_location.volume_texture = glGetUniformLocation(
-        _gl_state.volume_pass.program_object, "volume_texture");
+    _gl_state.volume_pass.uniform_location.volume.init(_gl_state.volume_pass.program_object);
+    _gl_state.volume_pass.uniform_location.macro_cells.init(_gl_state.volume_pass.program_object);
     _gl_state.volume_pass.uniform_location.volume_dimensions = glGetUniformLocation(
         _gl_state.volume_pass.program_object, "volume_dimensions");
     _gl_state.volume_pass.uniform_location.volume_dimensions_rcp =
@@ -498,10 +504,7 @@ void SelectionRenderer::initialize(const glm::ivec2& viewport_size)
         glGetUniformLocation(
             _gl_state.picking_pass.program_object, "exit_texture"
         );
-    _gl_state.picking_pass.uniform_location.volume_texture =
-        glGetUniformLocation(
-            _gl_state.picking_pass.program_object, "volume_texture"
-        );
+    _gl_state.picking_pass.uniform_location.volume.init(_gl_state.picking_pass.program_object);
     _gl_state.picking_pass.uniform_location.volume_dimensions =
         glGetUniformLocation(
             _gl_state.picking_pass.program_object, "volume_dimensions"
@@ -553,8 +556,7 @@ void SelectionRenderer::initialize(const glm::ivec2& viewport_size)
     // Picking texture and framebuffer
     glGenTextures(1, &_gl_state.picking_pass.picking_texture);
     glBindTexture(GL_TEXTURE_2D, _gl_state.picking_pass.picking_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, viewport_size.x, viewport_size.y, 0, GL_RGB,
-        GL_FLOAT, nullptr);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 1, 1, 0, GL_RGB, GL_FLOAT, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -564,6 +566,13 @@ void SelectionRenderer::initialize(const glm::ivec2& viewport_size)
         _gl_state.picking_pass.picking_texture, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    glGenBuffers(GLState::PickingPass::NUM_READBACK_BUFFERS, _gl_state.picking_pass.readback_buffers);
+    for (GLuint buffer : _gl_state.picking_pass.readback_buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 3 * sizeof(GLfloat), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
 
     // Initialize transfer function
     // Texture
@@ -577,6 +586,7 @@ void SelectionRenderer::initialize(const glm::ivec2& viewport_size)
     // SSBO
     glGenBuffers(1, &_gl_state.volume_pass.contour_information_ssbo);
     glGenBuffers(1, &_gl_state.volume_pass.selection_list_ssbo);
+    _gl_state.volume_pass.contour_information_size = 0;
 
 }
 
@@ -600,6 +610,12 @@ void SelectionRenderer::destroy() {
     };
 
     glDeleteBuffers(buffers.size(), buffers.data());
+    glDeleteBuffers(GLState::PickingPass::NUM_READBACK_BUFFERS, _gl_state.picking_pass.readback_buffers);
+    for (GLsync fence : _gl_state.picking_pass.readback_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
     glDeleteTextures(textures.size(), textures.data());
     glDeleteFramebuffers(framebuffers.size(), framebuffers.data());
     glDeleteProgram(_gl_state.volume_pass.program_object);
@@ -607,6 +623,8 @@ void SelectionRenderer::destroy() {
     glDeleteProgram(_gl_state.geometry_pass.program);
 
     _gl_state = GLState();
+    _macro_cells.destroy();
+    _macro_cells_dirty = true;
 }
 
 void SelectionRenderer::set_transfer_function(const std::vector<TfNode> &tf) {
@@ -679,6 +697,12 @@ void SelectionRenderer::set_transfer_function(const std::vector<TfNode> &tf) {
         };
     }
 
+    _transfer_function_alpha.resize(TRANSFER_FUNCTION_WIDTH);
+    for (int i = 0; i < TRANSFER_FUNCTION_WIDTH; ++i) {
+        _transfer_function_alpha[i] = transfer_function_data[i][3];
+    }
+    _macro_cells_dirty = true;
+
     glBindTexture(GL_TEXTURE_1D, _gl_state.volume_pass.transfer_function_texture);
     glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, TRANSFER_FUNCTION_WIDTH, 0, GL_RGBA,
         GL_UNSIGNED_BYTE, transfer_function_data.data());
@@ -752,7 +776,7 @@ void SelectionRenderer::geometry_pass(glm::mat4 model_matrix, glm::mat4 view_mat
     glPopDebugGroup();
 }
 
-void SelectionRenderer::volume_pass(Parameters parameters, GLuint index_texture, GLuint volume_texture) {
+void SelectionRenderer::volume_pass(Parameters parameters, GLuint index_texture, const VolumeTextureBinding& volume) {
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Render Volume");
 
     //
@@ -797,9 +821,14 @@ void SelectionRenderer::volume_pass(Parameters parameters, GLuint index_texture,
     glUniform1i(_gl_state.volume_pass.uniform_location.entry_texture, 1);
 
     // Volume texture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_3D, volume_texture);
-    glUniform1i(_gl_state.volume_pass.uniform_location.volume_texture, 2);
+    bind_volume_texture(_gl_state.volume_pass.uniform_location.volume, volume, 2);
+
+    // Macro cells of the volume, to skip the ones with nothing visible in them
+    const bool skip_empty_space = parameters.skip_empty_space && volume.macro_cells != nullptr;
+    if (skip_empty_space) {
+        update_macro_cells(parameters, *volume.macro_cells);
+    }
+    bind_macro_cells(_gl_state.volume_pass.uniform_location.macro_cells, skip_empty_space ? &_macro_cells : nullptr);
 
     // Transfer function texture
     glActiveTexture(GL_TEXTURE3);
@@ -842,7 +871,8 @@ void SelectionRenderer::volume_pass(Parameters parameters, GLuint index_texture,
     glPopDebugGroup();
 }
 
-glm::vec3 SelectionRenderer::picking_pass(Parameters parameters, glm::ivec2 mouse_position, GLuint index_texture, GLuint volume_texture) {
+glm::vec3 SelectionRenderer::picking_pass(Parameters parameters, glm::ivec2 mouse_position, GLuint index_texture,
+                                          const VolumeTextureBinding& volume, bool wait_for_pick) {
     glUseProgram(_gl_state.picking_pass.program_object);
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_3D, index_texture);
@@ -851,6 +881,12 @@ glm::vec3 SelectionRenderer::picking_pass(Parameters parameters, glm::ivec2 mous
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Pick Volume");
     glBindFramebuffer(GL_FRAMEBUFFER, _gl_state.picking_pass.picking_framebuffer);
 
+    // Shift the viewport so the pixel under the mouse lands on the single texel of the picking framebuffer
+    GLint old_viewport[4];
+    glGetIntegerv(GL_VIEWPORT, old_viewport);
+    glViewport(old_viewport[0] - mouse_position.x, old_viewport[1] - mouse_position.y,
+               old_viewport[2], old_viewport[3]);
+
     glClear(GL_COLOR_BUFFER_BIT);
 
     glUseProgram(_gl_state.picking_pass.program_object);
@@ -866,9 +902,7 @@ glm::vec3 SelectionRenderer::picking_pass(Parameters parameters, glm::ivec2 mous
     glUniform1i(_gl_state.picking_pass.uniform_location.entry_texture, 1);
 
     // Volume texture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_3D, volume_texture);
-    glUniform1i(_gl_state.picking_pass.uniform_location.volume_texture, 2);
+    bind_volume_texture(_gl_state.picking_pass.uniform_location.volume, volume, 2);
 
     // Transfer function texture
     glActiveTexture(GL_TEXTURE3);
@@ -892,31 +926,155 @@ glm::vec3 SelectionRenderer::picking_pass(Parameters parameters, glm::ivec2 mous
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glUseProgram(0);
 
-    GLfloat colors[3];
-    glReadPixels(mouse_position.x, mouse_position.y, 1, 1, GL_RGB, GL_FLOAT, colors);
+    GLState::PickingPass& picking = _gl_state.picking_pass;
+    const int current = picking.next_readback;
+    picking.next_readback = (current + 1) % GLState::PickingPass::NUM_READBACK_BUFFERS;
+
+    // Queue the copy of this pick into a buffer object, glReadPixels returns without waiting for it
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, picking.readback_buffers[current]);
+    glReadPixels(0, 0, 1, 1, GL_RGB, GL_FLOAT, nullptr);
+    if (picking.readback_fences[current]) {
+        glDeleteSync(picking.readback_fences[current]);
+    }
+    picking.readback_fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (wait_for_pick) {
+        // A click has to select what is under the mouse now, so wait for this pass
+        const GLuint64 timeout_ns = 100000000;
+        GLenum status = glClientWaitSync(picking.readback_fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(picking.readback_fences[current], 0, timeout_ns);
+        }
+        GLfloat colors[3] = { 0.f, 0.f, 0.f };
+        if (status == GL_WAIT_FAILED) {
+            // Read the texel straight from the framebuffer, which waits for the GPU
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glReadPixels(0, 0, 1, 1, GL_RGB, GL_FLOAT, colors);
+        }
+        else {
+            glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(colors), colors);
+        }
+        picking.last_pick = glm::vec3(colors[0], colors[1], colors[2]);
+
+        // Every pick in flight is older than this one
+        for (int j = 0; j < GLState::PickingPass::NUM_READBACK_BUFFERS; j++) {
+            if (picking.readback_fences[j]) {
+                glDeleteSync(picking.readback_fences[j]);
+                picking.readback_fences[j] = 0;
+            }
+        }
+    }
+
+    // Read back the newest earlier pick the GPU has finished
+    for (int age = 1; !wait_for_pick && age < GLState::PickingPass::NUM_READBACK_BUFFERS; age++) {
+        const int i = (current - age + GLState::PickingPass::NUM_READBACK_BUFFERS) % GLState::PickingPass::NUM_READBACK_BUFFERS;
+        GLsync fence = picking.readback_fences[i];
+        if (!fence) {
+            continue;
+        }
+        const GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        GLfloat colors[3];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, picking.readback_buffers[i]);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(colors), colors);
+        picking.last_pick = glm::vec3(colors[0], colors[1], colors[2]);
+
+        // Older picks are stale now
+        for (int j = 0; j < GLState::PickingPass::NUM_READBACK_BUFFERS; j++) {
+            if (j != current && picking.readback_fences[j]) {
+                glDeleteSync(picking.readback_fences[j]);
+                picking.readback_fences[j] = 0;
+            }
+        }
+        break;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
+    glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glBindVertexArray(0);
 
     glPopDebugGroup();
 
-    return {
-        colors[0],
-        colors[1],
-        colors[2]
-    };
+    return picking.last_pick;
 }
 
-void SelectionRenderer::set_contour_data(uint32_t* contour_features, size_t num_features) {
+void SelectionRenderer::set_contour_data(const uint32_t* contour_features, size_t num_features) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, _gl_state.volume_pass.contour_information_ssbo);
     glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * num_features, contour_features, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    _gl_state.volume_pass.contour_information_size = num_features;
+
+    _contour_data.assign(contour_features, contour_features + num_features);
+    _macro_cells_dirty = true;
+}
+
+void SelectionRenderer::update_contour_data(const uint32_t* contour_features, size_t num_features,
+                                            const std::vector<std::pair<size_t, size_t>>& changed_ranges) {
+    if (num_features != _gl_state.volume_pass.contour_information_size) {
+        set_contour_data(contour_features, num_features);
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _gl_state.volume_pass.contour_information_ssbo);
+    for (const std::pair<size_t, size_t>& range : changed_ranges) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * range.first,
+                        sizeof(uint32_t) * (range.second - range.first), contour_features + range.first);
+        std::copy(contour_features + range.first, contour_features + range.second, _contour_data.begin() + range.first);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    _macro_cells_dirty = _macro_cells_dirty || !changed_ranges.empty();
 }
 
 void SelectionRenderer::set_selection_data(uint32_t* selection_list, size_t num_features) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, _gl_state.volume_pass.selection_list_ssbo);
     glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * num_features, selection_list, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The first entry is the number of selected features
+    _selected_features.assign(selection_list + std::min<size_t>(num_features, 1), selection_list + num_features);
+    std::sort(_selected_features.begin(), _selected_features.end());
+    _macro_cells_dirty = true;
+}
+
+void SelectionRenderer::update_macro_cells(const Parameters& parameters, const MacroCellGrid& grid) {
+    // Emphasis makes the features it doesn't apply to transparent if the highlight factor is 0
+    const bool emphasis_hides = !_selected_features.empty() && parameters.highlight_factor <= 0.f;
+    const bool hide_unselected = emphasis_hides && parameters.emphasize_by_selection == 1;
+    const bool hide_selected = emphasis_hides && parameters.emphasize_by_selection == 2;
+    const int mode = (parameters.color_by_id ? 1 : 0) | (hide_unselected ? 2 : 0) | (hide_selected ? 4 : 0);
+    if (!_macro_cells_dirty && mode == _macro_cells_mode && grid.generation == _macro_cells_generation) {
+        return;
+    }
+
+    // Colors by identifier don't go through the transfer function
+    std::vector<uint8_t> visible;
+    if (parameters.color_by_id) {
+        visible.assign(grid.num_cells(), 1);
+    } else {
+        find_visible_cells(grid, _transfer_function_alpha, visible);
+    }
+
+    // Arcs are drawn if they belong to a feature (entries of the feature map after the count aren't ~0)
+    // and that feature isn't made transparent by the emphasis
+    const size_t num_arcs = _contour_data.empty() ? 0 : _contour_data.size() - 1;
+    std::vector<uint8_t> arc_visible(num_arcs, 0);
+    for (size_t arc = 0; arc < num_arcs; arc++) {
+        const uint32_t feature = _contour_data[arc + 1] + 1;
+        if (feature == 0) {
+            continue;
+        }
+        const bool selected = std::binary_search(_selected_features.begin(), _selected_features.end(), feature);
+        arc_visible[arc] = (selected ? hide_selected : hide_unselected) ? 0 : 1;
+    }
+    mask_cells_by_index(grid, arc_visible, visible);
+
+    _macro_cells.update(grid, visible);
+    _macro_cells_generation = grid.generation;
+    _macro_cells_mode = mode;
+    _macro_cells_dirty = false;
 }
 
 void SelectionRenderer::resize_framebuffer(glm::ivec2 framebuffer_size) {
@@ -2,10 +2,13 @@
 #define __VOLUME_RENDERING_H__
 
 #include <glad/glad.h>
+#include <utility>
 #include <vector>
 #include <glm/glm.hpp>
 
 #include "volume_renderer.h"
+#include "bricked_volume_texture.h"
+#include "macro_cell_texture.h"
 
 struct Parameters {
     glm::ivec3 volume_dimensions = { 0, 0, 0 };
@@ -27,6 +30,9 @@ struct Parameters {
 
     // Color components based on their identifier
     bool color_by_id = true;
+
+    // Skip the macro cells of the volume with nothing visible in them
+    bool skip_empty_space = true;
 };
 
 class SelectionRenderer {
@@ -56,11 +62,13 @@ class SelectionRenderer {
 
             GLuint selection_list_ssbo;
             GLuint contour_information_ssbo;
+            // Number of entries allocated for contour_information_ssbo
+            size_t contour_information_size = 0;
 
             struct {
                 GLint entry_texture = 0;
                 GLint exit_texture = 0;
-                GLint volume_texture = 0;
+                VolumeSamplingUniforms volume;
                 GLint transfer_function = 0;
 
                 GLint volume_dimensions = 0;
@@ -77,19 +85,31 @@ class SelectionRenderer {
                 GLuint color_by_identifier = 0;
                 GLuint selection_emphasis_type = 0;
                 GLuint highlight_factor = 0;
+
+                MacroCellUniforms macro_cells;
             } uniform_location;
         } volume_pass;
 
         struct PickingPass {
+            static constexpr int NUM_READBACK_BUFFERS = 3;
+
             GLuint program_object = 0;
 
+            // A single texel, the pass is only rendered for the pixel under the mouse
             GLuint picking_framebuffer = 0;
             GLuint picking_texture = 0;
 
+            // The picked texel is copied into the next of these buffers each pass and read back a few
+            // frames later, once its fence has signaled, so picking never waits for the GPU
+            GLuint readback_buffers[NUM_READBACK_BUFFERS] = {};
+            GLsync readback_fences[NUM_READBACK_BUFFERS] = {};
+            int next_readback = 0;
+            glm::vec3 last_pick = glm::vec3(0.f);
+
             struct {
                 GLint entry_texture = 0;
                 GLint exit_texture = 0;
-                GLint volume_texture = 0;
+                VolumeSamplingUniforms volume;
                 GLint transfer_function = 0;
 
                 GLint volume_dimensions = 0;
@@ -100,13 +120,31 @@ class SelectionRenderer {
         } picking_pass;
     } _gl_state;
 
+    // Cells of the volume a ray has to sample given the transfer function, the feature map and the selection.
+    // The feature map and selection are mirrored here so the cells can be recomputed in volume_pass()
+    // whenever any of them, or the volume's macro cells, changed since the last time.
+    MacroCellTexture _macro_cells;
+    uint64_t _macro_cells_generation = 0;
+    int _macro_cells_mode = -1;
+    bool _macro_cells_dirty = true;
+    std::vector<uint8_t> _transfer_function_alpha;
+    std::vector<uint32_t> _contour_data;
+    std::vector<uint32_t> _selected_features;
+
+    void update_macro_cells(const Parameters& parameters, const MacroCellGrid& grid);
+
 public:
     const GLState& gl_state() const { return _gl_state; }
 
     // Buffer contents:
     // [0]: number of features
     // [...]: A linearized map from voxel identifier -> feature number
-    void set_contour_data(uint32_t* contour_features, size_t num_features);
+    void set_contour_data(const uint32_t* contour_features, size_t num_features);
+
+    // Upload entries [first, second) of contour_features for each range. Falls back to
+    // set_contour_data if the buffer on the GPU has a different size.
+    void update_contour_data(const uint32_t* contour_features, size_t num_features,
+                             const std::vector<std::pair<size_t, size_t>>& changed_ranges);
     void set_selection_data(uint32_t* selection_list, size_t num_features);
     void resize_framebuffer(glm::ivec2 framebuffer_size);
     void set_transfer_function(const std::vector<TfNode>& tf);
@@ -115,8 +153,13 @@ public:
     void destroy();
 
     void geometry_pass(glm::mat4 model_matrix, glm::mat4 view_matrix, glm::mat4 proj_matrix);
-    void volume_pass(Parameters parameters, GLuint index_texture, GLuint volume_texture);
-    glm::vec3 picking_pass(Parameters parameters, glm::ivec2 mouse_position, GLuint index_texture, GLuint volume_texture);
+    void volume_pass(Parameters parameters, GLuint index_texture, const VolumeTextureBinding& volume);
+
+    // Pick the feature under mouse_position (in the coordinates of the current viewport's framebuffer).
+    // Returns the latest pick the GPU has finished, which lags the mouse by a frame or two and is good
+    // enough for highlighting. With wait_for_pick it waits for this pass instead, use it for clicks.
+    glm::vec3 picking_pass(Parameters parameters, glm::ivec2 mouse_position, GLuint index_texture,
+                           const VolumeTextureBinding& volume, bool wait_for_pick = false);
 
 };
 
@@ -0,0 +1,148 @@
+#include "texture_uploader.h"
+
+#include <chrono>
+#include <utility>
+
+namespace {
+// How long finish() waits on a fence before checking the other buffers, in nanoseconds
+constexpr GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+}
+
+
+void TextureUploader::init(size_t num_buffers) {
+    destroy();
+    _buffers.resize(num_buffers);
+    for (Buffer& buffer : _buffers) {
+        glGenBuffers(1, &buffer.pbo);
+    }
+}
+
+void TextureUploader::destroy() {
+    // Workers may still be writing to mapped buffers
+    for (Buffer& buffer : _buffers) {
+        if (buffer.state == BufferState::FILLING) {
+            buffer.filled.wait();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+        }
+        glDeleteBuffers(1, &buffer.pbo);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    _buffers.clear();
+    _pending.clear();
+    _bytes_total = 0;
+    _bytes_done = 0;
+}
+
+void TextureUploader::enqueue(Upload upload) {
+    _bytes_total += upload.num_bytes;
+    _pending.push_back(std::move(upload));
+}
+
+bool TextureUploader::step(double time_budget_ms) {
+    return advance(false /* wait */, time_budget_ms);
+}
+
+void TextureUploader::finish() {
+    while (!advance(true /* wait */, 0.0)) {}
+}
+
+bool TextureUploader::done() const {
+    if (!_pending.empty()) {
+        return false;
+    }
+    for (const Buffer& buffer : _buffers) {
+        if (buffer.state != BufferState::FREE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float TextureUploader::fraction() const {
+    return _bytes_total == 0 ? 1.0f : float(double(_bytes_done) / double(_bytes_total));
+}
+
+bool TextureUploader::advance(bool wait, double time_budget_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    auto out_of_time = [&]() {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return !wait && elapsed.count() > time_budget_ms;
+    };
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (Buffer& buffer : _buffers) {
+        // Recycle the buffer once the GPU has copied it to the texture
+        if (buffer.state == BufferState::IN_FLIGHT) {
+            const GLenum status = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                   wait ? FENCE_WAIT_TIMEOUT : 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+                glDeleteSync(buffer.fence);
+                buffer.fence = nullptr;
+                buffer.state = BufferState::FREE;
+                _bytes_done += buffer.upload.num_bytes;
+                buffer.upload = Upload();
+            }
+        }
+
+        // Hand the filled buffer to the GPU, the copy happens asynchronously
+        if (buffer.state == BufferState::FILLING && !out_of_time()) {
+            const bool ready = wait ||
+                buffer.filled.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            if (ready) {
+                buffer.filled.get();
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindTexture(GL_TEXTURE_3D, buffer.upload.texture);
+                for (const Box& box : buffer.upload.boxes) {
+                    glTexSubImage3D(GL_TEXTURE_3D, 0, box.offset.x, box.offset.y, box.offset.z,
+                                    box.size.x, box.size.y, box.size.z, buffer.upload.format, buffer.upload.type,
+                                    reinterpret_cast<const void*>(box.buffer_offset));
+                }
+                buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                buffer.state = BufferState::IN_FLIGHT;
+                buffer.upload.fill = nullptr;
+            }
+        }
+
+        // Map the buffer for the next upload and fill it on a worker thread
+        if (buffer.state == BufferState::FREE && !_pending.empty() && !out_of_time()) {
+            buffer.upload = std::move(_pending.front());
+            _pending.pop_front();
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+            if (buffer.capacity < buffer.upload.num_bytes) {
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer.upload.num_bytes, nullptr, GL_STREAM_DRAW);
+                buffer.capacity = buffer.upload.num_bytes;
+            }
+            uint8_t* dst = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer.upload.num_bytes,
+                                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            if (dst == nullptr) {
+                // The driver couldn't map the buffer, upload this one synchronously from client memory
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                std::vector<uint8_t> data(buffer.upload.num_bytes);
+                buffer.upload.fill(data.data());
+                glBindTexture(GL_TEXTURE_3D, buffer.upload.texture);
+                for (const Box& box : buffer.upload.boxes) {
+                    glTexSubImage3D(GL_TEXTURE_3D, 0, box.offset.x, box.offset.y, box.offset.z,
+                                    box.size.x, box.size.y, box.size.z, buffer.upload.format, buffer.upload.type,
+                                    data.data() + box.buffer_offset);
+                }
+                _bytes_done += buffer.upload.num_bytes;
+                buffer.upload = Upload();
+                continue;
+            }
+
+            FillFunction fill = buffer.upload.fill;
+            buffer.filled = std::async(std::launch::async, [fill, dst]() { fill(dst); });
+            buffer.state = BufferState::FILLING;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    return done();
+}
@@ -0,0 +1,86 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <vector>
+
+
+// Streams data into 3D textures through a ring of pixel buffer objects, a few buffers per frame.
+// Each buffer is mapped on the GL thread and filled on a worker thread, then copied to its
+// texture by the GPU. A fence tells when the copy is done and the buffer can be reused.
+// Every GL call is made from step() and finish(), which must be called on the thread owning the context.
+class TextureUploader {
+public:
+    // Writes the bytes of an upload to dst. Called on a worker thread, so it must not make GL calls.
+    typedef std::function<void(uint8_t* dst)> FillFunction;
+
+    // A box of a texture, sourced from the upload's buffer starting at buffer_offset
+    struct Box {
+        glm::ivec3 offset;
+        glm::ivec3 size;
+        size_t buffer_offset;
+    };
+
+    struct Upload {
+        GLuint texture = 0;
+        GLenum format = GL_RED;
+        GLenum type = GL_UNSIGNED_BYTE;
+        size_t num_bytes = 0;
+        std::vector<Box> boxes;
+        FillFunction fill;
+    };
+
+    TextureUploader() = default;
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    void init(size_t num_buffers = 4);
+    void destroy();
+
+    void enqueue(Upload upload);
+
+    // Move every upload along without blocking, spending at most about time_budget_ms submitting copies.
+    // Returns true once everything enqueued is on the GPU.
+    bool step(double time_budget_ms = 4.0);
+
+    // Block until everything enqueued is on the GPU
+    void finish();
+
+    bool done() const;
+
+    // Fraction of the enqueued bytes that are on the GPU
+    float fraction() const;
+
+private:
+    enum class BufferState {
+        FREE,
+        FILLING,
+        IN_FLIGHT
+    };
+
+    struct Buffer {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        BufferState state = BufferState::FREE;
+        Upload upload;
+        std::future<void> filled;
+        GLsync fence = nullptr;
+    };
+
+    // Advance every buffer one state if it can. With wait set this blocks until each of them can.
+    bool advance(bool wait, double time_budget_ms);
+
+    std::vector<Buffer> _buffers;
+    std::deque<Upload> _pending;
+    size_t _bytes_total = 0;
+    size_t _bytes_done = 0;
+};
+
+#endif // TEXTURE_UPLOADER_H
@@ -8,6 +8,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <igl/opengl/create_shader_program.h>
 
+#include "voxel_format_gl.h"
+
 constexpr const char* SLICE_VERTEX_SHADER = R"(
 #version 150
 // Create two triangles that are filling the entire screen [-1, 1]
@@ -58,31 +60,33 @@ in vec3 uv;
 
 out vec4 out_color;
 
-uniform sampler3D tex;
 uniform sampler1D tf;
 
 void main() {
-    out_color = vec4(texture(tex, uv).rrr, 1.0);
+    out_color = vec4(vec3(sample_volume(uv)), 1.0);
 }
 )";
 
 void VolumeExporter::write_texture_data_to_file(std::string filename) {
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Export");
-    const size_t num_voxels = size_t(w)*size_t(h)*size_t(d);
-    std::vector<std::uint8_t> out_data;
-    out_data.resize(num_voxels*4);
-
-    glBindTexture(GL_TEXTURE_3D, render_texture);
-    glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)out_data.data());
-    glBindTexture(GL_TEXTURE_3D, 0);
-    glFinish();
+    const size_t slice_bytes = size_t(w)*size_t(h)*voxel_format_size(format);
+    std::vector<std::uint8_t> slice_data(slice_bytes);
 
-    std::vector<uint8_t> real_data;
-    real_data.resize(num_voxels);
-    for (size_t i = 0; i < num_voxels; i++) { real_data[i] = out_data[4*i]; }
     std::ofstream fout;
     fout.open(filename, std::ios::binary);
-    fout.write(reinterpret_cast<char*>(real_data.data()), num_voxels*sizeof(uint8_t));
+
+    // Read back one slice at a time in the native sample format so nothing bigger
+    // than a single slice is ever held in memory
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (GLsizei z = 0; z < d; z++) {
+        glFramebufferTexture3D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_3D, render_texture, 0, z);
+        glReadPixels(0, 0, w, h, GL_RED, gl_pixel_type(format), (void*)slice_data.data());
+        fout.write(reinterpret_cast<char*>(slice_data.data()), slice_bytes);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
     fout.close();
     glPopDebugGroup();
 }
@@ -92,10 +96,18 @@ void VolumeExporter::set_export_dims(GLsizei w, GLsizei h, GLsizei d) {
     this->h = h;
     this->d = d;
     glBindTexture(GL_TEXTURE_3D, render_texture);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RED, w, h, d, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+    glTexImage3D(GL_TEXTURE_3D, 0, gl_internal_format(format), w, h, d, 0, GL_RED, gl_pixel_type(format), 0);
     glBindTexture(GL_TEXTURE_3D, 0);
 }
 
+void VolumeExporter::set_export_format(VoxelFormat format) {
+    if (this->format == format) {
+        return;
+    }
+    this->format = format;
+    set_export_dims(w, h, d);
+}
+
 void VolumeExporter::destroy() {
     glDeleteProgram(slice.program);
     glDeleteFramebuffers(1, &framebuffer);
@@ -107,12 +119,12 @@ void VolumeExporter::destroy() {
 void VolumeExporter::init(GLsizei w, GLsizei h, GLsizei d) {
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Init Slice");
     igl::opengl::create_shader_program(SLICE_VERTEX_SHADER,
-                                       SLICE_FRAGMENT_SHADER, {}, slice.program);
+                                       add_volume_sampling_glsl(SLICE_FRAGMENT_SHADER), {}, slice.program);
     slice.ll_location = glGetUniformLocation(slice.program, "ll");
     slice.lr_location = glGetUniformLocation(slice.program, "lr");
     slice.ul_location = glGetUniformLocation(slice.program, "ul");
     slice.ur_location = glGetUniformLocation(slice.program, "ur");
-    slice.texture_location = glGetUniformLocation(slice.program, "tex");
+    slice.volume.init(slice.program);
     slice.tf_location = glGetUniformLocation(slice.program, "tf");
 
     glGenVertexArrays(1, &empty_vao);
@@ -136,7 +148,7 @@ void VolumeExporter::init(GLsizei w, GLsizei h, GLsizei d) {
 
 }
 
-void VolumeExporter::update(BoundingCage& cage, GLuint volume_texture, glm::ivec3 volume_dims) {
+void VolumeExporter::update(BoundingCage& cage, const VolumeTextureBinding& volume, glm::ivec3 volume_dims) {
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
     GLint old_viewport[4];
@@ -146,9 +158,7 @@ void VolumeExporter::update(BoundingCage& cage, GLuint volume_texture, glm::ivec
     glUseProgram(slice.program);
     glBindVertexArray(empty_vao);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_3D, volume_texture);
-    glUniform1i(slice.texture_location, 0);
+    bind_volume_texture(slice.volume, volume, 0);
 
     std::vector<double> kf_depths;
     cage.keyframe_depths(kf_depths);
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 
 #include "../bounding_cage.h"
+#include "../volume_data.h"
+#include "bricked_volume_texture.h"
 #include "glm_conversion.h"
 
 
@@ -19,11 +21,12 @@ class VolumeExporter {
         GLint lr_location;
         GLint ul_location;
         GLint ur_location;
-        GLint texture_location;
+        VolumeSamplingUniforms volume;
         GLint tf_location;
     } slice;
 
     GLsizei w = 0, h = 0, d = 0;
+    VoxelFormat format = VoxelFormat::UINT8;
 
 public:
 
@@ -35,13 +38,21 @@ public:
         return render_texture;
     }
 
+    VoxelFormat export_format() const {
+        return format;
+    }
+
+    // Writes the exported volume slice by slice as raw samples of export_format()
     void write_texture_data_to_file(std::string filename);
 
     void set_export_dims(GLsizei w, GLsizei h, GLsizei d);
 
+    // Sample format of the exported volume, this reallocates the export texture
+    void set_export_format(VoxelFormat format);
+
     void init(GLsizei w, GLsizei h, GLsizei d);
 
     void destroy();
 
-    void update(BoundingCage& cage, GLuint volume_texture, glm::ivec3 volume_dims);
+    void update(BoundingCage& cage, const VolumeTextureBinding& volume, glm::ivec3 volume_dims);
 };
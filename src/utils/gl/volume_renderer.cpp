@@ -12,6 +12,9 @@
 
 namespace {
 
+// Texture unit of the precomputed gradients, after the ones the other volume pass textures use
+constexpr GLint GRADIENT_TEXTURE_UNIT = MACRO_CELL_TEXTURE_UNIT + 1;
+
 // Vertex shader that is used to trigger the volume rendering by rendering a static
 // screen-space filling quad.
 constexpr const char* VOLUME_PASS_VERTEX_SHADER = R"(
@@ -67,9 +70,12 @@ constexpr const char* VOLUME_PASS_FRAGMENT_SHADER = R"(
   uniform sampler2D exit_texture;
   uniform sampler2D value_init_texture;
 
-  uniform sampler3D volume_texture;
   uniform sampler1D transfer_function;
 
+  uniform int lighting;
+  uniform sampler3D gradient_texture;
+  uniform int use_gradient_texture;
+
   uniform ivec3 volume_dimensions;
   uniform vec3 volume_dimensions_rcp;
   uniform float sampling_rate;
@@ -90,14 +96,14 @@ constexpr const char* VOLUME_PASS_FRAGMENT_SHADER = R"(
 
   vec3 centralDifferenceGradient(vec3 pos) {
     vec3 f;
-    f.x = texture(volume_texture, pos + vec3(volume_dimensions_rcp.x, 0.0, 0.0)).r;
-    f.y = texture(volume_texture, pos + vec3(0.0, volume_dimensions_rcp.y, 0.0)).r;
-    f.z = texture(volume_texture, pos + vec3(0.0, 0.0, volume_dimensions_rcp.z)).r;
+    f.x = sample_volume(pos + vec3(volume_dimensions_rcp.x, 0.0, 0.0));
+    f.y = sample_volume(pos + vec3(0.0, volume_dimensions_rcp.y, 0.0));
+    f.z = sample_volume(pos + vec3(0.0, 0.0, volume_dimensions_rcp.z));
 
     vec3 b;
-    b.x = texture(volume_texture, pos - vec3(volume_dimensions_rcp.x, 0.0, 0.0)).r;
-    b.y = texture(volume_texture, pos - vec3(0.0, volume_dimensions_rcp.y, 0.0)).r;
-    b.z = texture(volume_texture, pos - vec3(0.0, 0.0, volume_dimensions_rcp.z)).r;
+    b.x = sample_volume(pos - vec3(volume_dimensions_rcp.x, 0.0, 0.0));
+    b.y = sample_volume(pos - vec3(0.0, volume_dimensions_rcp.y, 0.0));
+    b.z = sample_volume(pos - vec3(0.0, 0.0, volume_dimensions_rcp.z));
 
     return (f - b) / 2.0;
   }
@@ -149,16 +155,29 @@ constexpr const char* VOLUME_PASS_FRAGMENT_SHADER = R"(
     float t = 0.0;
     while (t < t_end) {
       vec3 sample_pos = entry + t * normalized_ray_direction;
-      float value = texture(volume_texture, sample_pos).r;
+      float t_skip = empty_space_skip(sample_pos, normalized_ray_direction, t_incr);
+      if (t_skip > 0.0) {
+        t += t_skip;
+        continue;
+      }
+
+      float value = sample_volume(sample_pos);
       vec4 color = texture(transfer_function, value);
       if (color.a > 0) {
-        // Gradient
-        vec3 gradient = centralDifferenceGradient(sample_pos);
-        gradient = gradient / max(length(gradient), 0.0001);
-
-        // Lighting
-        //color.rgb = blinn_phong(light_parameters, color.rgb, color.rgb, vec3(value),
-        //                        sample_pos, gradient, -normalized_ray_direction);
+        if (lighting != 0) {
+          // Gradient, precomputed if there is a texture of them
+          vec3 gradient;
+          if (use_gradient_texture != 0) {
+            gradient = texture(gradient_texture, sample_pos).xyz;
+          } else {
+            gradient = centralDifferenceGradient(sample_pos);
+          }
+          gradient = gradient / max(length(gradient), 0.0001);
+
+          // Lighting
+          color.rgb = blinn_phong(light_parameters, color.rgb, color.rgb, vec3(value),
+                                  sample_pos, gradient, -normalized_ray_direction);
+        }
 
         // Front-to-back Compositing
         color.a = 1.0 - pow(1.0 - color.a, t_incr * REF_SAMPLING_INTERVAL);
@@ -242,6 +261,9 @@ void VolumeRenderer::destroy() {
     glDeleteVertexArrays(vertex_arrays.size(), vertex_arrays.data());
     glDeleteProgram(_gl_state.ray_endpoints_pass.program);
     glDeleteProgram(_gl_state.volume_pass.program);
+
+    _macro_cells.destroy();
+    _macro_cells_dirty = true;
 }
 
 void VolumeRenderer::set_transfer_function(const std::vector<TfNode> &transfer_function) {
@@ -298,6 +320,13 @@ void VolumeRenderer::set_transfer_function(const std::vector<TfNode> &transfer_f
             static_cast<uint8_t>(rgba[3] * 255.f)
         };
     }
+
+    _transfer_function_alpha.resize(TRANSFER_FUNCTION_WIDTH);
+    for (int i = 0; i < TRANSFER_FUNCTION_WIDTH; ++i) {
+        _transfer_function_alpha[i] = transfer_function_data[i][3];
+    }
+    _macro_cells_dirty = true;
+
     glBindTexture(GL_TEXTURE_1D, _gl_state.volume_pass.transfer_function_texture);
     glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, TRANSFER_FUNCTION_WIDTH, 0, GL_RGBA,
                  GL_UNSIGNED_BYTE, transfer_function_data.data());
@@ -410,14 +439,20 @@ void VolumeRenderer::init(const glm::ivec2 &viewport_size, const char *fragment_
 
     // Shader to render the actual volume
     igl::opengl::create_shader_program(VOLUME_PASS_VERTEX_SHADER,
-                                       VOLUME_PASS_FRAGMENT_SHADER, {},
+                                       add_empty_space_skipping_glsl(add_volume_sampling_glsl(VOLUME_PASS_FRAGMENT_SHADER)), {},
                                        _gl_state.volume_pass.program);
     _gl_state.volume_pass.uniform_location.entry_texture = glGetUniformLocation(
         _gl_state.volume_pass.program, "entry_texture");
     _gl_state.volume_pass.uniform_location.exit_texture = glGetUniformLocation(
         _gl_state.volume_pass.program, "exit_texture");
-    _gl_state.volume_pass.uniform_location.volume_texture = glGetUniformLocation(
-        _gl_state.volume_pass.program, "volume_texture");
+    _gl_state.volume_pass.uniform_location.volume.init(_gl_state.volume_pass.program);
+    _gl_state.volume_pass.uniform_location.macro_cells.init(_gl_state.volume_pass.program);
+    _gl_state.volume_pass.uniform_location.lighting = glGetUniformLocation(
+        _gl_state.volume_pass.program, "lighting");
+    _gl_state.volume_pass.uniform_location.gradient_texture = glGetUniformLocation(
+        _gl_state.volume_pass.program, "gradient_texture");
+    _gl_state.volume_pass.uniform_location.use_gradient_texture = glGetUniformLocation(
+        _gl_state.volume_pass.program, "use_gradient_texture");
     _gl_state.volume_pass.uniform_location.volume_dimensions = glGetUniformLocation(
         _gl_state.volume_pass.program, "volume_dimensions");
     _gl_state.volume_pass.uniform_location.volume_dimensions_rcp = glGetUniformLocation(
@@ -581,7 +616,7 @@ void VolumeRenderer::ray_endpoint_pass(const glm::mat4& model_matrix, const glm:
     glPopDebugGroup();
 }
 
-void VolumeRenderer::volume_pass(const glm::vec3& light_position, const glm::ivec3& volume_dims, GLuint volume_tex, GLuint multipass_tex) {
+void VolumeRenderer::volume_pass(const glm::vec3& light_position, const glm::ivec3& volume_dims, const VolumeTextureBinding& volume, GLuint multipass_tex) {
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Render Volume TEST");
 
     //
@@ -607,9 +642,11 @@ void VolumeRenderer::volume_pass(const glm::vec3& light_position, const glm::ive
     glUniform1i(_gl_state.volume_pass.uniform_location.entry_texture, 1);
 
     // Bind the volume texture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_3D, volume_tex);
-    glUniform1i(_gl_state.volume_pass.uniform_location.volume_texture, 2);
+    bind_volume_texture(_gl_state.volume_pass.uniform_location.volume, volume, 2);
+
+    // Macro cells are only built for the volume levels, not for textures like the straightened volume
+    const bool skip_empty_space = _skip_empty_space && volume.macro_cells != nullptr;
+    bind_macro_cells(_gl_state.volume_pass.uniform_location.macro_cells, skip_empty_space ? &_macro_cells : nullptr);
 
     // Bind the transfer function texture
     glActiveTexture(GL_TEXTURE3);
@@ -621,6 +658,14 @@ void VolumeRenderer::volume_pass(const glm::vec3& light_position, const glm::ive
     glBindTexture(GL_TEXTURE_2D, multipass_tex);
     glUniform1i(_gl_state.volume_pass.uniform_location.value_init_texture, 4);
 
+    // Precomputed gradients, if lighting is on and the volume has them
+    const bool use_gradient_texture = _lighting && volume.gradient_texture != 0;
+    glActiveTexture(GL_TEXTURE0 + GRADIENT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_3D, use_gradient_texture ? volume.gradient_texture : 0);
+    glUniform1i(_gl_state.volume_pass.uniform_location.gradient_texture, GRADIENT_TEXTURE_UNIT);
+    glUniform1i(_gl_state.volume_pass.uniform_location.use_gradient_texture, use_gradient_texture ? 1 : 0);
+    glUniform1i(_gl_state.volume_pass.uniform_location.lighting, _lighting ? 1 : 0);
+
     // Bind rendering parameters
     glm::vec3 volume_dims_rcp = glm::vec3(1.0) / glm::vec3(volume_dims);
 
@@ -643,14 +688,14 @@ void VolumeRenderer::volume_pass(const glm::vec3& light_position, const glm::ive
     glPopDebugGroup();
 }
 
-void VolumeRenderer::begin(const glm::ivec3& volume_dims, GLuint tex) {
+void VolumeRenderer::begin(const glm::ivec3& volume_dims, const VolumeTextureBinding& volume) {
     if (_gl_state.multipass.framebuffer[0] == 0) {
         assert("VolumeRenderer not initialized with multipass enabled" && false);
         exit(EXIT_FAILURE);
         return;
     }
 
-    if (_current_multipass_buf >= 0 || _current_volume_tex != 0) {
+    if (_current_multipass_buf >= 0 || _current_volume.texture != 0) {
         assert("VolumeRenderer begin_multipass_called without calling render_multipass with final flag" && false);
         exit(EXIT_FAILURE);
         return;
@@ -664,8 +709,17 @@ void VolumeRenderer::begin(const glm::ivec3& volume_dims, GLuint tex) {
     }
 
     _current_multipass_buf = 0;
-    _current_volume_tex = tex;
+    _current_volume = volume;
     _current_volume_dims = volume_dims;
+
+    const MacroCellGrid* grid = volume.macro_cells;
+    if (_skip_empty_space && grid != nullptr && (_macro_cells_dirty || grid->generation != _macro_cells_generation)) {
+        std::vector<uint8_t> visible;
+        find_visible_cells(*grid, _transfer_function_alpha, visible);
+        _macro_cells.update(*grid, visible);
+        _macro_cells_generation = grid->generation;
+        _macro_cells_dirty = false;
+    }
 }
 
 void VolumeRenderer::render_pass(
@@ -673,7 +727,7 @@ void VolumeRenderer::render_pass(
         const glm::mat4 &proj_matrix, const glm::vec3 &light_position,
         bool final) {
 
-    if (_current_multipass_buf < 0 || _current_volume_tex == 0) {
+    if (_current_multipass_buf < 0 || _current_volume.texture == 0) {
         assert("VolumeRenderer render_multipass called  without calling begin_multipass" && false);
         exit(EXIT_FAILURE);
         return;
@@ -695,18 +749,18 @@ void VolumeRenderer::render_pass(
 
     ray_endpoint_pass(model_matrix, view_matrix, proj_matrix);
 
-    GLuint volume_tex = _current_volume_tex;
+    const VolumeTextureBinding volume = _current_volume;
     if (final) {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         _current_multipass_buf = -1;
-        _current_volume_tex = 0;
+        _current_volume = VolumeTextureBinding();
     } else {
         glBindFramebuffer(GL_FRAMEBUFFER, _gl_state.multipass.framebuffer[current_buf]);
         glViewport(0, 0, fb_tex_w, fb_tex_h);
         _current_multipass_buf = last_buf;
     }
 
-    volume_pass(light_position, _current_volume_dims, volume_tex, _gl_state.multipass.texture[last_buf]);
+    volume_pass(light_position, _current_volume_dims, volume, _gl_state.multipass.texture[last_buf]);
 
     glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
     glPopDebugGroup();
@@ -7,6 +7,9 @@
 #include <vector>
 #include <fstream>
 
+#include "bricked_volume_texture.h"
+#include "macro_cell_texture.h"
+
 
 struct TfNode {
     float t;
@@ -19,10 +22,19 @@ class VolumeRenderer {
     GLuint _num_bounding_indices = 0;
 
     int _current_multipass_buf = -1;
-    GLuint _current_volume_tex = 0;
+    VolumeTextureBinding _current_volume;
     glm::ivec3 _current_volume_dims;
 
     GLfloat _step_size = 0.0;
+    bool _lighting = false;
+
+    // Cells of the current volume a ray has to sample given the transfer function. They are recomputed
+    // in begin() when the transfer function or the volume's macro cells changed since the last time.
+    bool _skip_empty_space = true;
+    MacroCellTexture _macro_cells;
+    uint64_t _macro_cells_generation = 0;
+    bool _macro_cells_dirty = true;
+    std::vector<uint8_t> _transfer_function_alpha;
 
     struct GLState {
         struct RayEndpointsPass {
@@ -53,7 +65,7 @@ class VolumeRenderer {
             struct {
                 GLint entry_texture = 0;
                 GLint exit_texture = 0;
-                GLint volume_texture = 0;
+                VolumeSamplingUniforms volume;
                 GLint transfer_function = 0;
                 GLint value_init_texture = 0;
                 GLint final = 0;
@@ -67,6 +79,12 @@ class VolumeRenderer {
                 GLint light_color_diffuse = 0;
                 GLint light_color_specular = 0;
                 GLint light_exponent_specular = 0;
+
+                MacroCellUniforms macro_cells;
+
+                GLint lighting = 0;
+                GLint gradient_texture = 0;
+                GLint use_gradient_texture = 0;
             } uniform_location;
         } volume_pass;
 
@@ -77,7 +95,7 @@ class VolumeRenderer {
     } _gl_state;
 
     void ray_endpoint_pass(const glm::mat4 &model_matrix, const glm::mat4 &view_matrix, const glm::mat4 &proj_matrix);
-    void volume_pass(const glm::vec3& light_position, const glm::ivec3 &volume_dims, GLuint volume_tex, GLuint multipass_tex);
+    void volume_pass(const glm::vec3& light_position, const glm::ivec3 &volume_dims, const VolumeTextureBinding& volume, GLuint multipass_tex);
 
 public:
     const GLState& gl_state() const { return _gl_state; }
@@ -86,6 +104,17 @@ public:
         _step_size = step_size;
     }
 
+    // Shade samples with Blinn-Phong (off by default). Volumes with a gradient texture are lit from it,
+    // others take central differences of the volume for every visible sample.
+    void set_lighting(bool enabled) {
+        _lighting = enabled;
+    }
+
+    // Skip the macro cells of volumes that are invisible with the current transfer function (on by default)
+    void set_empty_space_skipping(bool enabled) {
+        _skip_empty_space = enabled;
+    }
+
     void resize_framebuffer(const glm::ivec2& viewport_size);
 
     void init(const glm::ivec2& viewport_size,
@@ -103,7 +132,7 @@ public:
     //                               const std::vector<GLint*>& indices,
     //                               const std::vector<GLsizei>& num_indices);
 
-    void begin(const glm::ivec3 &volume_dims, GLuint tex);
+    void begin(const glm::ivec3 &volume_dims, const VolumeTextureBinding& volume);
     void render_pass(const glm::mat4 &model_matrix,
                      const glm::mat4 &view_matrix,
                      const glm::mat4 &proj_matrix,
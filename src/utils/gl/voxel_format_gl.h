@@ -0,0 +1,28 @@
+#ifndef VOXEL_FORMAT_GL_H
+#define VOXEL_FORMAT_GL_H
+
+#include <glad/glad.h>
+
+#include "../volume_data.h"
+
+
+// Sized internal format used to store a single channel volume of the given format on the GPU.
+// Integer formats are normalized by GL so every format samples to [0, 1] in the shaders.
+inline GLenum gl_internal_format(VoxelFormat format) {
+    switch (format) {
+    case VoxelFormat::UINT16: return GL_R16;
+    case VoxelFormat::FLOAT32: return GL_R32F;
+    default: return GL_R8;
+    }
+}
+
+// Pixel transfer type matching the samples of the given format
+inline GLenum gl_pixel_type(VoxelFormat format) {
+    switch (format) {
+    case VoxelFormat::UINT16: return GL_UNSIGNED_SHORT;
+    case VoxelFormat::FLOAT32: return GL_FLOAT;
+    default: return GL_UNSIGNED_BYTE;
+    }
+}
+
+#endif // VOXEL_FORMAT_GL_H
@@ -0,0 +1,219 @@
+#include "image_stack.h"
+#include "blocked_volume.h"
+#include "datfile.h"
+#include "parallel_for.h"
+#include "timer.h"
+#include "volume_data.h"
+
+#include <QImage>
+#include <QString>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// Upper bound on the decoded slices held in memory at once
+constexpr size_t INGEST_BATCH_BYTES = size_t(512) << 20;
+
+int gcd(int a, int b) {
+    while (b != 0) {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool is_16_bit(const QImage& image) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    return image.format() == QImage::Format_Grayscale16;
+#else
+    (void) image;
+    return false;
+#endif
+}
+
+QImage::Format qimage_format(VoxelFormat format) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    if (format == VoxelFormat::UINT16) {
+        return QImage::Format_Grayscale16;
+    }
+#endif
+    (void) format;
+    return QImage::Format_Grayscale8;
+}
+
+// Decode a slice into w*h samples of format at out. QImage rows are padded, so they're copied one at a time.
+bool read_slice(const std::string& path, int w, int h, VoxelFormat format, uint8_t* out,
+                std::shared_ptr<spdlog::logger> logger) {
+    QImage image(QString::fromStdString(path));
+    if (image.isNull()) {
+        logger->error("Could not read the image '{}'.", path);
+        return false;
+    }
+    if (image.width() != w || image.height() != h) {
+        logger->error("Image '{}' is {}x{} but the first image of the stack is {}x{}.",
+                      path, image.width(), image.height(), w, h);
+        return false;
+    }
+    const QImage::Format target = qimage_format(format);
+    if (image.format() != target) {
+        image = image.convertToFormat(target);
+    }
+    const size_t row_bytes = size_t(w) * voxel_format_size(format);
+    for (int y = 0; y < h; y++) {
+        std::memcpy(out + size_t(y) * row_bytes, image.constScanLine(y), row_bytes);
+    }
+    return true;
+}
+
+bool write_datfile(const std::string& path_prefix, const Eigen::RowVector3i& dims, VoxelFormat format, bool compressed,
+                   std::shared_ptr<spdlog::logger> logger) {
+    DatFile datfile;
+    const std::string::size_type slash = path_prefix.find_last_of("/\\");
+    datfile.m_raw_filename = (slash == std::string::npos ? path_prefix : path_prefix.substr(slash + 1)) + ".raw";
+    if (compressed) {
+        datfile.m_raw_filename += BLOCKED_VOLUME_EXTENSION;
+        datfile.m_compression = BLOCKED_VOLUME_COMPRESSION;
+    }
+    datfile.w = dims[0];
+    datfile.h = dims[1];
+    datfile.d = dims[2];
+    datfile.m_format = voxel_format_to_string(format);
+    return datfile.serialize(path_prefix + ".dat", logger);
+}
+
+}
+
+
+std::string ImageStack::slice_path(int i) const {
+    std::string index = std::to_string(start_index + i);
+    if (int(index.size()) < index_width) {
+        index.insert(0, size_t(index_width) - index.size(), '0');
+    }
+    return directory + "/" + prefix + index + "." + extension;
+}
+
+
+bool ingest_image_stack(const ImageStack& stack, const std::vector<IngestOutput>& outputs,
+                        std::shared_ptr<spdlog::logger> logger, IngestProgress* progress, unsigned num_threads) {
+    const int num_slices = stack.num_slices();
+    if (num_slices <= 0) {
+        logger->error("The image stack '{}' has no slices.", stack.slice_path(0));
+        return false;
+    }
+
+    // The first slice fixes the size and sample format of the volume
+    QImage first(QString::fromStdString(stack.slice_path(0)));
+    if (first.isNull()) {
+        logger->error("Could not read the image '{}'.", stack.slice_path(0));
+        return false;
+    }
+    const VoxelFormat format = is_16_bit(first) ? VoxelFormat::UINT16 : VoxelFormat::UINT8;
+    const Eigen::RowVector3i dims(first.width(), first.height(), num_slices);
+    const size_t slice_voxels = size_t(dims[0]) * size_t(dims[1]);
+    const size_t slice_bytes = slice_voxels * voxel_format_size(format);
+    first = QImage();
+
+    // Batches are a multiple of every downsampling factor so each batch downsamples on its own
+    int block = 1;
+    std::vector<std::ofstream> files(outputs.size());
+    std::vector<BlockedVolumeWriter> compressed_files(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const int factor = std::max(outputs[i].factor, 1);
+        block = block / gcd(block, factor) * factor;
+        if (outputs[i].compress) {
+            const std::string filename = outputs[i].path_prefix + ".raw" + BLOCKED_VOLUME_EXTENSION;
+            if (!compressed_files[i].open(filename, downsampled_dims(dims, factor), format, 0, logger)) {
+                return false;
+            }
+            continue;
+        }
+        files[i].open(outputs[i].path_prefix + ".raw", std::ios::binary | std::ios::trunc);
+        if (!files[i].good()) {
+            logger->error("Could not open '{}.raw' for writing.", outputs[i].path_prefix);
+            return false;
+        }
+    }
+    if (num_threads == 0) {
+        num_threads = default_num_threads();
+    }
+    const size_t blocks_per_batch = std::max<size_t>(1, std::min<size_t>(
+        (num_threads + block - 1) / block, INGEST_BATCH_BYTES / (size_t(block) * slice_bytes)));
+    const int batch_slices = int(blocks_per_batch) * block;
+
+    if (progress) {
+        progress->slices_done = 0;
+        progress->slices_total = size_t(num_slices);
+    }
+    logger->info("Ingesting {} slices of {}x{} {} samples, {} at a time", num_slices, dims[0], dims[1],
+                 voxel_format_to_string(format), batch_slices);
+
+    Timer timer;
+    VolumeData batch;
+    VolumeData downsampled;
+    batch.allocate(size_t(batch_slices) * slice_voxels, format);
+    for (int z = 0; z < num_slices; z += batch_slices) {
+        const int num_batch_slices = std::min(batch_slices, num_slices - z);
+        uint8_t* batch_bytes = batch.mutable_bytes();
+
+        std::atomic<bool> ok(true);
+        parallel_for_chunks(0, size_t(num_batch_slices), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end && ok; i++) {
+                if (!read_slice(stack.slice_path(z + int(i)), dims[0], dims[1], format,
+                                batch_bytes + i * slice_bytes, logger)) {
+                    ok = false;
+                }
+            }
+        }, num_threads);
+        if (!ok) {
+            return false;
+        }
+
+        const Eigen::RowVector3i batch_dims(dims[0], dims[1], num_batch_slices);
+        for (size_t i = 0; i < outputs.size(); i++) {
+            const uint8_t* samples = batch_bytes;
+            int num_samples_slices = num_batch_slices;
+            size_t num_bytes = size_t(num_batch_slices) * slice_bytes;
+            if (outputs[i].factor > 1) {
+                downsample_volume(batch, batch_dims, outputs[i].factor, downsampled);
+                samples = downsampled.bytes();
+                num_samples_slices = downsampled_dims(batch_dims, outputs[i].factor)[2];
+                num_bytes = downsampled.size_in_bytes();
+            }
+            if (!outputs[i].compress) {
+                files[i].write(reinterpret_cast<const char*>(samples), std::streamsize(num_bytes));
+            } else if (!compressed_files[i].write_slices(samples, num_samples_slices)) {
+                return false;
+            }
+        }
+
+        if (progress) {
+            progress->slices_done += size_t(num_batch_slices);
+            progress->slices_per_second = float(double(z + num_batch_slices) / std::max(timer.elapsed(), 1e-6));
+        }
+    }
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (outputs[i].compress) {
+            if (!compressed_files[i].close()) {
+                return false;
+            }
+        } else {
+            files[i].close();
+            if (!files[i]) {
+                logger->error("Error writing '{}.raw'.", outputs[i].path_prefix);
+                return false;
+            }
+        }
+        const Eigen::RowVector3i out_dims = downsampled_dims(dims, std::max(outputs[i].factor, 1));
+        if (!write_datfile(outputs[i].path_prefix, out_dims, format, outputs[i].compress, logger)) {
+            return false;
+        }
+    }
+    logger->info("Ingested {} slices in {:.2f}s ({:.1f} slices/s)", num_slices, timer.elapsed(),
+                 double(num_slices) / std::max(timer.elapsed(), 1e-6));
+    return true;
+}
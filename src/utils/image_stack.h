@@ -0,0 +1,69 @@
+#ifndef IMAGE_STACK_H
+#define IMAGE_STACK_H
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// A scan stored as one image per slice: <directory>/<prefix><index>.<extension> for every index
+// in [start_index, end_index]
+struct ImageStack {
+    std::string directory;
+    std::string prefix;
+    std::string extension;
+    int start_index = 0;
+    int end_index = -1;
+
+    // Indices are zero padded to this many digits
+    int index_width = 0;
+
+    int num_slices() const { return end_index - start_index + 1; }
+
+    // Path of the image of slice i, counting from start_index
+    std::string slice_path(int i) const;
+};
+
+
+// A volume written by ingest_image_stack as <path_prefix>.raw and <path_prefix>.dat,
+// downsampled by factor (1 for the full resolution volume). If compress is set the samples
+// are LZ4 compressed as they are written, to a blocked volume <path_prefix>.raw.lz4 instead.
+struct IngestOutput {
+    std::string path_prefix;
+    int factor = 1;
+    bool compress = false;
+};
+
+
+// Progress of an image stack being ingested, safe to poll from the UI thread while the loader thread updates it
+struct IngestProgress {
+    std::atomic<size_t> slices_done{0};
+    std::atomic<size_t> slices_total{0};
+    std::atomic<float> slices_per_second{0.0f};
+
+    void reset() {
+        slices_done = 0;
+        slices_total = 0;
+        slices_per_second = 0.0f;
+    }
+
+    float fraction() const {
+        const size_t total = slices_total;
+        return total == 0 ? 0.0f : float(double(slices_done) / double(total));
+    }
+};
+
+
+// Decode the images of stack and write every output in a single pass over the slices. Slices are
+// decoded concurrently in batches of whole downsampling blocks, then appended to the full resolution
+// outputs and box-averaged into the downsampled ones. 16 bit grayscale images are kept as UINT16,
+// everything else is converted to 8 bit grayscale. Returns false and logs an error if a slice can't
+// be read or doesn't have the size of the first one.
+bool ingest_image_stack(const ImageStack& stack, const std::vector<IngestOutput>& outputs,
+                        std::shared_ptr<spdlog::logger> logger, IngestProgress* progress = nullptr,
+                        unsigned num_threads = 0);
+
+#endif // IMAGE_STACK_H
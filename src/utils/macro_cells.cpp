@@ -0,0 +1,174 @@
+#include "macro_cells.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+// Number of cells handled per task
+constexpr size_t CELL_CHUNK_SIZE = 16;
+
+// Voxels trilinear filtering reads on either side of a cell
+constexpr int CELL_APRON = 1;
+
+// Display values are widened by this much before looking them up in the transfer function, so
+// samples quantized to 8 bits for a compact texture can't land outside of a cell's range
+constexpr float VALUE_RANGE_MARGIN = 1.0f / 255.0f;
+
+std::atomic<uint64_t> next_generation(1);
+
+// Voxels [begin, end) of cell c along an axis of n voxels, apron included if it is
+inline void cell_span(int c, int n, int apron, int& begin, int& end) {
+    begin = std::max(c * MACRO_CELL_SIZE - apron, 0);
+    end = std::min((c + 1) * MACRO_CELL_SIZE + apron, n);
+}
+
+template <typename T>
+void cell_value_range(const MacroCellGrid& grid, const T* slab, int slab_z_begin, int cx, int cy, int cz,
+                      float min_value, float scale, float* range) {
+    int x0, x1, y0, y1, z0, z1;
+    cell_span(cx, grid.w, CELL_APRON, x0, x1);
+    cell_span(cy, grid.h, CELL_APRON, y0, y1);
+    cell_span(cz, grid.d, CELL_APRON, z0, z1);
+
+    const size_t slice_voxels = size_t(grid.w) * size_t(grid.h);
+    float lo = VoxelTraits<T>::normalize(slab[size_t(z0 - slab_z_begin) * slice_voxels + size_t(y0) * grid.w + x0]);
+    float hi = lo;
+    for (int z = z0; z < z1; z++) {
+        for (int y = y0; y < y1; y++) {
+            const T* row = slab + size_t(z - slab_z_begin) * slice_voxels + size_t(y) * grid.w;
+            for (int x = x0; x < x1; x++) {
+                const float v = VoxelTraits<T>::normalize(row[x]);
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+        }
+    }
+
+    // Past the edge of the volume the texture border, or an empty brick, is sampled as 0
+    const bool clipped = cx * MACRO_CELL_SIZE - CELL_APRON < 0 || cy * MACRO_CELL_SIZE - CELL_APRON < 0 ||
+                         cz * MACRO_CELL_SIZE - CELL_APRON < 0 || (cx + 1) * MACRO_CELL_SIZE + CELL_APRON > grid.w ||
+                         (cy + 1) * MACRO_CELL_SIZE + CELL_APRON > grid.h || (cz + 1) * MACRO_CELL_SIZE + CELL_APRON > grid.d;
+    range[0] = clipped ? 0.0f : std::min(std::max((lo - min_value) * scale, 0.0f), 1.0f);
+    range[1] = std::min(std::max((hi - min_value) * scale, 0.0f), 1.0f);
+}
+}
+
+
+MacroCellGrid::MacroCellGrid(int w, int h, int d) : w(w), h(h), d(d) {
+    nx = (w + MACRO_CELL_SIZE - 1) / MACRO_CELL_SIZE;
+    ny = (h + MACRO_CELL_SIZE - 1) / MACRO_CELL_SIZE;
+    nz = (d + MACRO_CELL_SIZE - 1) / MACRO_CELL_SIZE;
+    generation = next_generation++;
+}
+
+void MacroCellGrid::layer_slices(int cz, int& z_begin, int& z_end) const {
+    cell_span(cz, d, CELL_APRON, z_begin, z_end);
+}
+
+
+void find_cell_value_ranges(MacroCellGrid& grid, const VolumeSlab& slab, int cz, double min_value, double max_value) {
+    if (grid.value_ranges.size() != 2 * grid.num_cells()) {
+        grid.value_ranges.assign(2 * grid.num_cells(), 0.0f);
+    }
+    const float lo = static_cast<float>(min_value);
+    const float scale = max_value > min_value ? static_cast<float>(1.0 / (max_value - min_value)) : 1.0f;
+    float* layer = grid.value_ranges.data() + 2 * size_t(cz) * grid.layer_size();
+    visit_samples(slab.format, slab.samples, [&](auto* samples) {
+        parallel_for_chunks(0, grid.layer_size(), CELL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const int cx = int(i % size_t(grid.nx));
+                const int cy = int(i / size_t(grid.nx));
+                cell_value_range(grid, samples, slab.z_begin, cx, cy, cz, lo, scale, layer + 2 * i);
+            }
+        });
+    });
+    grid.generation = next_generation++;
+}
+
+void find_cell_index_values(MacroCellGrid& grid, const uint32_t* index_data) {
+    std::vector<std::vector<uint32_t>> cell_values(grid.num_cells());
+    const size_t slice_voxels = size_t(grid.w) * size_t(grid.h);
+    parallel_for_chunks(0, grid.num_cells(), CELL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const int cx = int(i % size_t(grid.nx));
+            const int cy = int((i / size_t(grid.nx)) % size_t(grid.ny));
+            const int cz = int(i / grid.layer_size());
+            int x0, x1, y0, y1, z0, z1;
+            cell_span(cx, grid.w, 0, x0, x1);
+            cell_span(cy, grid.h, 0, y0, y1);
+            cell_span(cz, grid.d, 0, z0, z1);
+
+            // Neighbouring voxels mostly share an index, so runs are collapsed before sorting
+            std::vector<uint32_t>& values = cell_values[i];
+            for (int z = z0; z < z1; z++) {
+                for (int y = y0; y < y1; y++) {
+                    const uint32_t* row = index_data + size_t(z) * slice_voxels + size_t(y) * grid.w;
+                    for (int x = x0; x < x1; x++) {
+                        if (values.empty() || values.back() != row[x]) {
+                            values.push_back(row[x]);
+                        }
+                    }
+                }
+            }
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+    });
+
+    grid.index_offsets.resize(grid.num_cells() + 1);
+    grid.index_offsets[0] = 0;
+    for (size_t i = 0; i < grid.num_cells(); i++) {
+        grid.index_offsets[i + 1] = grid.index_offsets[i] + uint32_t(cell_values[i].size());
+    }
+    grid.index_values.resize(grid.index_offsets.back());
+    for (size_t i = 0; i < grid.num_cells(); i++) {
+        std::copy(cell_values[i].begin(), cell_values[i].end(), grid.index_values.begin() + grid.index_offsets[i]);
+    }
+    grid.generation = next_generation++;
+}
+
+void find_visible_cells(const MacroCellGrid& grid, const std::vector<uint8_t>& alpha, std::vector<uint8_t>& visible) {
+    visible.assign(grid.num_cells(), 1);
+    if (!grid.has_value_ranges() || alpha.empty()) {
+        return;
+    }
+
+    // Number of texels with a non-zero alpha before each texel, so any range is checked in constant time
+    const int n = int(alpha.size());
+    std::vector<int> opaque_before(alpha.size() + 1, 0);
+    for (int i = 0; i < n; i++) {
+        opaque_before[i + 1] = opaque_before[i] + (alpha[i] != 0 ? 1 : 0);
+    }
+
+    for (size_t i = 0; i < grid.num_cells(); i++) {
+        // A value v is interpolated from the texels on either side of v*n - 0.5
+        const float lo = grid.value_ranges[2 * i] - VALUE_RANGE_MARGIN;
+        const float hi = grid.value_ranges[2 * i + 1] + VALUE_RANGE_MARGIN;
+        const int first = std::min(std::max(int(std::floor(lo * n - 0.5f)), 0), n - 1);
+        const int last = std::min(std::max(int(std::floor(hi * n - 0.5f)) + 1, 0), n - 1);
+        visible[i] = opaque_before[last + 1] - opaque_before[first] > 0 ? 1 : 0;
+    }
+}
+
+void mask_cells_by_index(const MacroCellGrid& grid, const std::vector<uint8_t>& index_visible,
+                         std::vector<uint8_t>& visible) {
+    if (!grid.has_index_values()) {
+        return;
+    }
+    visible.resize(grid.num_cells(), 1);
+    parallel_for_chunks(0, grid.num_cells(), CELL_CHUNK_SIZE * 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!visible[i]) {
+                continue;
+            }
+            bool any = false;
+            for (uint32_t j = grid.index_offsets[i]; j < grid.index_offsets[i + 1] && !any; j++) {
+                const uint32_t v = grid.index_values[j];
+                any = v < index_visible.size() && index_visible[v] != 0;
+            }
+            visible[i] = any ? 1 : 0;
+        }
+    });
+}
@@ -0,0 +1,67 @@
+#ifndef MACRO_CELLS_H
+#define MACRO_CELLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "volume_bricks.h"
+
+
+// The ray-marchers skip empty space one macro cell of MACRO_CELL_SIZE^3 voxels at a time
+constexpr int MACRO_CELL_SIZE = 16;
+
+
+// Coarse summary of a volume split into nx*ny*nz macro cells. It holds what decides whether a ray can
+// skip a cell without knowing the transfer function or the selection: the range of the displayed values
+// in each cell and the index values (contour tree arcs) of its voxels. Which cells are visible is derived
+// from it with find_visible_cells and mask_cells_by_index whenever either of those change.
+struct MacroCellGrid {
+    int w = 0, h = 0, d = 0;
+    int nx = 0, ny = 0, nz = 0;
+
+    // min and max of the samples of each cell, stretched from [min_value, max_value] to [0, 1] as they
+    // are for display. The voxels around the cell that trilinear filtering reads are included.
+    std::vector<float> value_ranges;
+
+    // Index values of the voxels of cell i, sorted and unique, are index_values[index_offsets[i], index_offsets[i+1])
+    std::vector<uint32_t> index_offsets;
+    std::vector<uint32_t> index_values;
+
+    // Changes every time the contents of the grid do, so renderers can tell their visible cells are stale
+    uint64_t generation = 0;
+
+    MacroCellGrid() = default;
+    MacroCellGrid(int w, int h, int d);
+
+    size_t num_cells() const { return layer_size() * size_t(nz); }
+
+    // Number of cells with the same z index
+    size_t layer_size() const { return size_t(nx) * size_t(ny); }
+
+    bool has_value_ranges() const { return num_cells() > 0 && value_ranges.size() == 2 * num_cells(); }
+    bool has_index_values() const { return num_cells() > 0 && index_offsets.size() == num_cells() + 1; }
+
+    // Slices [z_begin, z_end) of the volume the cells in layer cz read, the filtering apron included
+    void layer_slices(int cz, int& z_begin, int& z_end) const;
+};
+
+// Fill in the value ranges of the cells in layer cz. slab must hold grid.layer_slices(cz).
+// Cells on the boundary of the volume include 0, the value of the texture border.
+void find_cell_value_ranges(MacroCellGrid& grid, const VolumeSlab& slab, int cz, double min_value, double max_value);
+
+// Fill in the index values of every cell from an index volume of grid.w*grid.h*grid.d voxels. The index
+// texture is sampled with nearest filtering, so only the voxels of the cell itself are included.
+void find_cell_index_values(MacroCellGrid& grid, const uint32_t* index_data);
+
+// Set visible[i] to 1 for every cell with a value that the transfer function gives a non-zero alpha and to 0
+// otherwise. alpha holds the alpha of each texel of the transfer function texture, which is sampled with
+// linear filtering.
+void find_visible_cells(const MacroCellGrid& grid, const std::vector<uint8_t>& alpha, std::vector<uint8_t>& visible);
+
+// Clear visible[i] for every cell with no index value v for which index_visible[v] is set. Index values past
+// the end of index_visible count as not visible.
+void mask_cells_by_index(const MacroCellGrid& grid, const std::vector<uint8_t>& index_visible,
+                         std::vector<uint8_t>& visible);
+
+#endif // MACRO_CELLS_H
@@ -0,0 +1,185 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+
+namespace {
+// Stride used to touch pages, at most the smallest page size of the platforms we run on
+constexpr size_t TOUCH_STRIDE = 4096;
+}
+
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+    if (this != &other) {
+        close();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_filename, other._filename);
+#ifdef _WIN32
+        std::swap(_file_handle, other._file_handle);
+        std::swap(_mapping_handle, other._mapping_handle);
+#else
+        std::swap(_fd, other._fd);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::touch(size_t offset, size_t length) const {
+    if (_data == nullptr || offset >= _size) {
+        return;
+    }
+    const size_t end = offset + (std::min)(length, _size - offset);
+    volatile uint8_t sink = 0;
+    for (size_t i = offset; i < end; i += TOUCH_STRIDE) {
+        sink += _data[i];
+    }
+    sink += _data[end - 1];
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    close();
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        logger->error("Could not open file '{}' for mapping.", filename);
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        logger->error("File '{}' is empty or its size could not be queried.", filename);
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        logger->error("CreateFileMapping failed for file '{}'.", filename);
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        logger->error("MapViewOfFile failed for file '{}'.", filename);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _file_handle = file;
+    _mapping_handle = mapping;
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(file_size.QuadPart);
+    _filename = filename;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping_handle != nullptr) {
+        CloseHandle(_mapping_handle);
+    }
+    if (_file_handle != nullptr) {
+        CloseHandle(_file_handle);
+    }
+    _data = nullptr;
+    _size = 0;
+    _mapping_handle = nullptr;
+    _file_handle = nullptr;
+}
+
+void MappedFile::will_need(size_t offset, size_t length) const {
+    if (_data == nullptr || offset >= _size) {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(_data) + offset;
+    range.NumberOfBytes = (std::min)(length, _size - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        logger->error("Could not open file '{}' for mapping: {}", filename, strerror(errno));
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        logger->error("File '{}' is empty or its size could not be queried.", filename);
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        logger->error("mmap failed for file '{}': {}", filename, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _data = static_cast<const uint8_t*>(data);
+    _size = size;
+    _filename = filename;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data != nullptr) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+    _data = nullptr;
+    _size = 0;
+    _fd = -1;
+}
+
+void MappedFile::will_need(size_t offset, size_t length) const {
+    if (_data == nullptr || offset >= _size) {
+        return;
+    }
+
+    // madvise needs a page aligned address
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t aligned_offset = offset - (offset % page_size);
+    const size_t aligned_length = std::min(length, _size - offset) + (offset - aligned_offset);
+    madvise(const_cast<uint8_t*>(_data) + aligned_offset, aligned_length, MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <string>
+#include <memory>
+
+
+// A read-only memory mapping of a file on disk. The pages are shared with the OS page cache
+// so mapping a volume does not allocate anything and only the parts that are touched get read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    // Map the whole file. Returns false and logs an error if the file cannot be mapped.
+    bool open(const std::string& filename, std::shared_ptr<spdlog::logger> logger);
+
+    // Unmap the file. Any pointers returned by data() are invalid after this is called.
+    void close();
+
+    bool is_open() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+    const std::string& filename() const { return _filename; }
+
+    // Hint to the OS that the range [offset, offset+length) will be read soon and sequentially
+    void will_need(size_t offset, size_t length) const;
+
+    // Read every page of [offset, offset+length) into memory now. Calling this from several threads
+    // on disjoint ranges keeps multiple reads in flight instead of faulting one page at a time.
+    void touch(size_t offset, size_t length) const;
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    std::string _filename;
+
+#ifdef _WIN32
+    void* _file_handle = nullptr;
+    void* _mapping_handle = nullptr;
+#else
+    int _fd = -1;
+#endif
+};
+
+#endif // MAPPED_FILE_H
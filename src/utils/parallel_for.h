@@ -0,0 +1,51 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// Number of worker threads to use when the caller doesn't specify one
+inline unsigned default_num_threads() {
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+// Split [begin, end) into chunks of chunk_size elements and call fn(chunk_begin, chunk_end) on each.
+// Chunks are handed out dynamically to up to num_threads workers (0 means one per core).
+// The calling thread takes part in the work and the function returns when every chunk is done.
+template <typename Fn>
+void parallel_for_chunks(size_t begin, size_t end, size_t chunk_size, const Fn& fn, unsigned num_threads = 0) {
+    if (end <= begin) {
+        return;
+    }
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    const size_t num_chunks = (end - begin + chunk_size - 1) / chunk_size;
+    if (num_threads == 0) {
+        num_threads = default_num_threads();
+    }
+    num_threads = static_cast<unsigned>(std::min<size_t>(num_threads, num_chunks));
+
+    std::atomic<size_t> next_chunk(0);
+    auto worker = [&]() {
+        for (size_t c = next_chunk++; c < num_chunks; c = next_chunk++) {
+            const size_t chunk_begin = begin + c * chunk_size;
+            const size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+            fn(chunk_begin, chunk_end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+#endif // PARALLEL_FOR_H
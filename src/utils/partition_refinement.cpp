@@ -0,0 +1,101 @@
+#include "partition_refinement.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Slices per task
+constexpr size_t SLICES_PER_CHUNK = 1;
+
+struct ArcRange {
+    float min_value = std::numeric_limits<float>::max();
+    float max_value = std::numeric_limits<float>::lowest();
+};
+
+template <typename T>
+void refine(const T* coarse, const uint32_t* coarse_index, const Eigen::RowVector3i& coarse_dims,
+            const T* fine, const Eigen::RowVector3i& fine_dims, int factor, uint32_t* fine_index) {
+    const size_t cw = size_t(coarse_dims[0]), ch = size_t(coarse_dims[1]);
+    const size_t num_coarse = cw * ch * size_t(coarse_dims[2]);
+
+    // Range of the values of the coarse voxels in each arc
+    uint32_t num_arcs = 0;
+    for (size_t i = 0; i < num_coarse; i++) {
+        num_arcs = std::max(num_arcs, coarse_index[i] + 1);
+    }
+    std::vector<ArcRange> ranges(num_arcs);
+    for (size_t i = 0; i < num_coarse; i++) {
+        ArcRange& range = ranges[coarse_index[i]];
+        const float v = VoxelTraits<T>::normalize(coarse[i]);
+        range.min_value = std::min(range.min_value, v);
+        range.max_value = std::max(range.max_value, v);
+    }
+
+    // Position of the center of fine voxel i in coarse voxel coordinates, split into the lower
+    // coarse voxel and the weight of the upper one
+    auto coarse_coordinate = [factor](int i, int n, int& lo, int& hi, float& t) {
+        const float c = (float(i) + 0.5f) / float(factor) - 0.5f;
+        const float f = std::floor(c);
+        t = c - f;
+        lo = std::min(std::max(int(f), 0), n - 1);
+        hi = std::min(std::max(int(f) + 1, 0), n - 1);
+    };
+
+    const size_t fw = size_t(fine_dims[0]), fh = size_t(fine_dims[1]);
+    parallel_for_chunks(0, size_t(fine_dims[2]), SLICES_PER_CHUNK, [&](size_t z_begin, size_t z_end) {
+        for (size_t z = z_begin; z < z_end; z++) {
+            int z0, z1;
+            float tz;
+            coarse_coordinate(int(z), coarse_dims[2], z0, z1, tz);
+            for (size_t y = 0; y < fh; y++) {
+                int y0, y1;
+                float ty;
+                coarse_coordinate(int(y), coarse_dims[1], y0, y1, ty);
+                for (size_t x = 0; x < fw; x++) {
+                    int x0, x1;
+                    float tx;
+                    coarse_coordinate(int(x), coarse_dims[0], x0, x1, tx);
+
+                    const size_t i = (z * fh + y) * fw + x;
+                    const float v = VoxelTraits<T>::normalize(fine[i]);
+                    uint32_t best_arc = 0;
+                    float best_distance = std::numeric_limits<float>::max();
+                    float best_weight = -1.0f;
+                    for (int corner = 0; corner < 8; corner++) {
+                        const int cx = (corner & 1) ? x1 : x0;
+                        const int cy = (corner & 2) ? y1 : y0;
+                        const int cz = (corner & 4) ? z1 : z0;
+                        const float weight = ((corner & 1) ? tx : 1.0f - tx) *
+                                             ((corner & 2) ? ty : 1.0f - ty) *
+                                             ((corner & 4) ? tz : 1.0f - tz);
+                        const uint32_t arc = coarse_index[(size_t(cz) * ch + size_t(cy)) * cw + size_t(cx)];
+                        const ArcRange& range = ranges[arc];
+                        const float distance = std::max(std::max(range.min_value - v, v - range.max_value), 0.0f);
+                        if (distance < best_distance || (distance == best_distance && weight > best_weight)) {
+                            best_arc = arc;
+                            best_distance = distance;
+                            best_weight = weight;
+                        }
+                    }
+                    fine_index[i] = best_arc;
+                }
+            }
+        }
+    });
+}
+
+}
+
+
+void refine_partition(const VolumeData& coarse, const uint32_t* coarse_index, const Eigen::RowVector3i& coarse_dims,
+                      const VolumeData& fine, const Eigen::RowVector3i& fine_dims, int factor, uint32_t* fine_index) {
+    assert(coarse.format() == fine.format());
+    fine.visit([&](auto* fine_samples) {
+        typedef VoxelTypeOf<decltype(fine_samples)> T;
+        refine(coarse.data<T>(), coarse_index, coarse_dims, fine_samples, fine_dims, factor, fine_index);
+    });
+}
@@ -0,0 +1,23 @@
+#ifndef PARTITION_REFINEMENT_H
+#define PARTITION_REFINEMENT_H
+
+#include <Eigen/Core>
+
+#include <cstdint>
+
+#include "volume_data.h"
+
+
+// The contour tree of a volume can be computed on a coarser copy of it and its partition (the
+// arc of every voxel) carried back to full resolution, one slab of slices at a time. That keeps
+// the memory and time spent on the contour tree proportional to the coarse volume.
+
+// Label each voxel of fine, a volume of fine_dims, with an arc of the partition of coarse, the
+// same volume downsampled by factor. Each fine voxel picks among the arcs of the 8 coarse voxels
+// around it the one whose range of values (over the coarse voxels with that arc) contains its value,
+// preferring the closest coarse voxel. If no range contains it the arc with the nearest range wins.
+// coarse and fine must have the same format.
+void refine_partition(const VolumeData& coarse, const uint32_t* coarse_index, const Eigen::RowVector3i& coarse_dims,
+                      const VolumeData& fine, const Eigen::RowVector3i& fine_dims, int factor, uint32_t* fine_index);
+
+#endif // PARTITION_REFINEMENT_H
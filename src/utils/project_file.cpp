@@ -0,0 +1,186 @@
+#include "project_file.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+constexpr char PROJECT_FILE_MAGIC[8] = { 'F', 'I', 'S', 'H', 'P', 'R', 'O', 'J' };
+
+// Chunk data is padded so every array in a mapped file starts 8 byte aligned
+constexpr size_t CHUNK_ALIGNMENT = 8;
+
+inline size_t padded_size(size_t size) {
+    return (size + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+}
+
+size_t chunk_type_size(ProjectChunkType type) {
+    switch (type) {
+    case ProjectChunkType::UINT8: return 1;
+    case ProjectChunkType::INT32: return 4;
+    case ProjectChunkType::UINT32: return 4;
+    case ProjectChunkType::INT64: return 8;
+    case ProjectChunkType::UINT64: return 8;
+    case ProjectChunkType::FLOAT32: return 4;
+    case ProjectChunkType::FLOAT64: return 8;
+    }
+    return 0;
+}
+
+}
+
+constexpr uint32_t ProjectFile::VERSION;
+
+
+bool ProjectFile::is_project_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[sizeof(PROJECT_FILE_MAGIC)];
+    if (!in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, PROJECT_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+
+bool ProjectFileWriter::open(const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    _logger = logger;
+    _filename = filename;
+    _num_chunks = 0;
+    _out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!_out.good()) {
+        logger->error("Could not open '{}' for writing.", filename);
+        return false;
+    }
+
+    // The chunk count is filled in by close()
+    ProjectFile::Header header;
+    std::memcpy(header.magic, PROJECT_FILE_MAGIC, sizeof(header.magic));
+    header.version = ProjectFile::VERSION;
+    header.num_chunks = 0;
+    _out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return _out.good();
+}
+
+bool ProjectFileWriter::close() {
+    _out.seekp(offsetof(ProjectFile::Header, num_chunks));
+    _out.write(reinterpret_cast<const char*>(&_num_chunks), sizeof(_num_chunks));
+    _out.close();
+    if (!_out) {
+        _logger->error("Error writing project file '{}'.", _filename);
+        return false;
+    }
+    return true;
+}
+
+void ProjectFileWriter::write_array(const std::string& name, ProjectChunkType type,
+                                    size_t rows, size_t cols, const void* data) {
+    ProjectFile::ChunkHeader chunk;
+    if (name.size() >= sizeof(chunk.name)) {
+        _logger->error("Project file chunk name '{}' is too long.", name);
+        _out.setstate(std::ios::failbit);
+        return;
+    }
+    std::memset(chunk.name, 0, sizeof(chunk.name));
+    std::memcpy(chunk.name, name.data(), name.size());
+    chunk.type = static_cast<uint32_t>(type);
+    chunk.reserved = 0;
+    chunk.rows = rows;
+    chunk.cols = cols;
+    _out.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+
+    const size_t num_bytes = rows * cols * chunk_type_size(type);
+    if (num_bytes > 0) {
+        _out.write(static_cast<const char*>(data), std::streamsize(num_bytes));
+    }
+    const char padding[CHUNK_ALIGNMENT] = {};
+    _out.write(padding, std::streamsize(padded_size(num_bytes) - num_bytes));
+    _num_chunks += 1;
+}
+
+
+bool ProjectFileReader::open(const std::string& filename, std::shared_ptr<spdlog::logger> logger) {
+    _logger = logger;
+    _chunks.clear();
+    if (!_file.open(filename, logger)) {
+        return false;
+    }
+
+    ProjectFile::Header header;
+    if (_file.size() < sizeof(header)) {
+        logger->error("Project file '{}' is too small to hold a header.", filename);
+        close();
+        return false;
+    }
+    std::memcpy(&header, _file.data(), sizeof(header));
+    if (std::memcmp(header.magic, PROJECT_FILE_MAGIC, sizeof(PROJECT_FILE_MAGIC)) != 0) {
+        logger->error("'{}' is not a project file.", filename);
+        close();
+        return false;
+    }
+    if (header.version > ProjectFile::VERSION) {
+        logger->error("Project file '{}' has version {} but only versions up to {} are supported.",
+                      filename, header.version, ProjectFile::VERSION);
+        close();
+        return false;
+    }
+    _version = header.version;
+
+    // Only the chunk headers are touched here, the data is left on disk until it is read
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.num_chunks; i++) {
+        ProjectFile::ChunkHeader chunk;
+        if (_file.size() - offset < sizeof(chunk)) {
+            logger->error("Project file '{}' is truncated.", filename);
+            close();
+            return false;
+        }
+        std::memcpy(&chunk, _file.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+
+        const ProjectChunkType type = static_cast<ProjectChunkType>(chunk.type);
+        const size_t type_size = chunk_type_size(type);
+        const size_t num_elements = size_t(chunk.rows) * size_t(chunk.cols);
+        const bool overflows = chunk.cols != 0 && num_elements / size_t(chunk.cols) != size_t(chunk.rows);
+        if (type_size == 0 || overflows || num_elements > (_file.size() - offset) / type_size) {
+            logger->error("Project file '{}' has an invalid chunk header at offset {}.", filename, offset - sizeof(chunk));
+            close();
+            return false;
+        }
+
+        const std::string name(chunk.name, strnlen(chunk.name, sizeof(chunk.name)));
+        _chunks[name] = ChunkEntry { type, size_t(chunk.rows), size_t(chunk.cols), offset };
+        offset = std::min(offset + padded_size(num_elements * type_size), _file.size());
+    }
+
+    return true;
+}
+
+void ProjectFileReader::close() {
+    _file.close();
+    _chunks.clear();
+    _version = 0;
+}
+
+const uint8_t* ProjectFileReader::chunk(const std::string& name, ProjectChunkType type,
+                                        size_t& rows, size_t& cols) const {
+    auto it = _chunks.find(name);
+    if (it == _chunks.end()) {
+        return nullptr;
+    }
+    if (it->second.type != type) {
+        _logger->error("Project file chunk '{}' has type {} but type {} was expected.",
+                       name, static_cast<uint32_t>(it->second.type), static_cast<uint32_t>(type));
+        return nullptr;
+    }
+    rows = it->second.rows;
+    cols = it->second.cols;
+    return _file.data() + it->second.offset;
+}
+
+bool ProjectFileReader::check_shape(const std::string& name, bool ok) const {
+    if (!ok) {
+        _logger->error("Project file chunk '{}' has the wrong shape.", name);
+    }
+    return ok;
+}
@@ -0,0 +1,208 @@
+#ifndef PROJECT_FILE_H
+#define PROJECT_FILE_H
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+
+// Element type of a project file chunk
+enum class ProjectChunkType : uint32_t {
+    UINT8 = 0,
+    INT32,
+    UINT32,
+    INT64,
+    UINT64,
+    FLOAT32,
+    FLOAT64,
+};
+
+template <typename T> struct ProjectChunkTypeOf;
+template <> struct ProjectChunkTypeOf<uint8_t>  { static constexpr ProjectChunkType value = ProjectChunkType::UINT8; };
+template <> struct ProjectChunkTypeOf<int32_t>  { static constexpr ProjectChunkType value = ProjectChunkType::INT32; };
+template <> struct ProjectChunkTypeOf<uint32_t> { static constexpr ProjectChunkType value = ProjectChunkType::UINT32; };
+template <> struct ProjectChunkTypeOf<int64_t>  { static constexpr ProjectChunkType value = ProjectChunkType::INT64; };
+template <> struct ProjectChunkTypeOf<uint64_t> { static constexpr ProjectChunkType value = ProjectChunkType::UINT64; };
+template <> struct ProjectChunkTypeOf<float>    { static constexpr ProjectChunkType value = ProjectChunkType::FLOAT32; };
+template <> struct ProjectChunkTypeOf<double>   { static constexpr ProjectChunkType value = ProjectChunkType::FLOAT64; };
+
+
+// A project saved as a sequence of named chunks, each one a rows x cols array of a single element type
+// written straight from (and read straight into) the memory of the Eigen matrix or std::vector holding it.
+// Chunks are looked up by name, so readers skip chunks they don't know and older files missing a chunk
+// can still be read by giving the field a default.
+//
+// File layout (little endian):
+//   Header
+//   num_chunks x { ChunkHeader, data padded to a multiple of 8 bytes }
+// Matrices are stored column major, as Eigen stores them by default.
+struct ProjectFile {
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t num_chunks;
+    };
+
+    struct ChunkHeader {
+        char name[48];
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t rows;
+        uint64_t cols;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+
+    // True if the file starts with the magic of a project file. Projects saved before this format
+    // existed were written with igl::serialize and don't.
+    static bool is_project_file(const std::string& filename);
+};
+
+
+class ProjectFileWriter {
+public:
+    // Create the file, replacing any existing one. Returns false and logs an error on failure.
+    bool open(const std::string& filename, std::shared_ptr<spdlog::logger> logger);
+
+    // Write the chunk count and close the file. Returns false if any write failed.
+    bool close();
+
+    void write_array(const std::string& name, ProjectChunkType type, size_t rows, size_t cols, const void* data);
+
+    template <typename T>
+    void write_value(const std::string& name, const T& value) {
+        write_array(name, ProjectChunkTypeOf<T>::value, 1, 1, &value);
+    }
+
+    void write_value(const std::string& name, bool value) {
+        write_value(name, uint8_t(value ? 1 : 0));
+    }
+
+    void write_string(const std::string& name, const std::string& value) {
+        write_array(name, ProjectChunkType::UINT8, value.size(), 1, value.data());
+    }
+
+    template <typename T>
+    void write_vector(const std::string& name, const std::vector<T>& values) {
+        write_array(name, ProjectChunkTypeOf<T>::value, values.size(), 1, values.data());
+    }
+
+    template <typename Derived>
+    void write_matrix(const std::string& name, const Eigen::PlainObjectBase<Derived>& m) {
+        static_assert(!Derived::IsRowMajor || Derived::IsVectorAtCompileTime, "Project files store matrices column major");
+        typedef typename Derived::Scalar Scalar;
+        write_array(name, ProjectChunkTypeOf<Scalar>::value, size_t(m.rows()), size_t(m.cols()), m.data());
+    }
+
+private:
+    std::ofstream _out;
+    std::string _filename;
+    uint32_t _num_chunks = 0;
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+
+// Reads a project file by mapping it, so each array is copied once, from the page cache to its destination.
+// The read_* methods return false and leave their output untouched if the chunk is missing,
+// and also log an error if it has the wrong type or shape.
+class ProjectFileReader {
+public:
+    // Map the file and index its chunks. Returns false and logs an error if it isn't a valid project file.
+    bool open(const std::string& filename, std::shared_ptr<spdlog::logger> logger);
+
+    void close();
+
+    uint32_t version() const { return _version; }
+    bool has_chunk(const std::string& name) const { return _chunks.count(name) != 0; }
+
+    // Pointer to the data of a chunk of the given type, or nullptr if there is no such chunk
+    const uint8_t* chunk(const std::string& name, ProjectChunkType type, size_t& rows, size_t& cols) const;
+
+    template <typename T>
+    bool read_value(const std::string& name, T& value) const {
+        size_t rows, cols;
+        const uint8_t* data = chunk(name, ProjectChunkTypeOf<T>::value, rows, cols);
+        if (data == nullptr || !check_shape(name, rows * cols == 1)) {
+            return false;
+        }
+        std::memcpy(&value, data, sizeof(T));
+        return true;
+    }
+
+    bool read_value(const std::string& name, bool& value) const {
+        uint8_t v;
+        if (!read_value(name, v)) {
+            return false;
+        }
+        value = v != 0;
+        return true;
+    }
+
+    bool read_string(const std::string& name, std::string& value) const {
+        size_t rows, cols;
+        const uint8_t* data = chunk(name, ProjectChunkType::UINT8, rows, cols);
+        if (data == nullptr || !check_shape(name, cols == 1)) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(data), rows);
+        return true;
+    }
+
+    template <typename T>
+    bool read_vector(const std::string& name, std::vector<T>& values) const {
+        size_t rows, cols;
+        const uint8_t* data = chunk(name, ProjectChunkTypeOf<T>::value, rows, cols);
+        if (data == nullptr || !check_shape(name, cols == 1)) {
+            return false;
+        }
+        values.resize(rows);
+        std::memcpy(values.data(), data, rows * sizeof(T));
+        return true;
+    }
+
+    template <typename Derived>
+    bool read_matrix(const std::string& name, Eigen::PlainObjectBase<Derived>& m) const {
+        static_assert(!Derived::IsRowMajor || Derived::IsVectorAtCompileTime, "Project files store matrices column major");
+        typedef typename Derived::Scalar Scalar;
+        size_t rows, cols;
+        const uint8_t* data = chunk(name, ProjectChunkTypeOf<Scalar>::value, rows, cols);
+        if (data == nullptr) {
+            return false;
+        }
+        const bool fits = (Derived::RowsAtCompileTime == Eigen::Dynamic || size_t(Derived::RowsAtCompileTime) == rows) &&
+                          (Derived::ColsAtCompileTime == Eigen::Dynamic || size_t(Derived::ColsAtCompileTime) == cols);
+        if (!check_shape(name, fits)) {
+            return false;
+        }
+        m.resize(Eigen::Index(rows), Eigen::Index(cols));
+        std::memcpy(m.data(), data, rows * cols * sizeof(Scalar));
+        return true;
+    }
+
+private:
+    struct ChunkEntry {
+        ProjectChunkType type;
+        size_t rows;
+        size_t cols;
+        size_t offset;
+    };
+
+    // Logs an error naming the chunk if ok is false
+    bool check_shape(const std::string& name, bool ok) const;
+
+    MappedFile _file;
+    uint32_t _version = 0;
+    std::unordered_map<std::string, ChunkEntry> _chunks;
+    std::shared_ptr<spdlog::logger> _logger;
+};
+
+#endif // PROJECT_FILE_H
@@ -0,0 +1,216 @@
+#include "quantize.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define QUANTIZE_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The AVX2 kernel is compiled with a target attribute and only picked if the CPU supports it at runtime
+#if defined(QUANTIZE_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define QUANTIZE_HAVE_AVX2 1
+#include <immintrin.h>
+#define QUANTIZE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+// Number of samples quantized per task
+constexpr size_t QUANTIZE_CHUNK_SIZE = 1 << 20;
+
+// out = clamp(v * scale + offset, 0, 255) rounded to the nearest integer, where v is the raw sample
+struct QuantizeParams {
+    float scale;
+    float offset;
+};
+
+// The comparisons are ordered like the SIMD max/min so NaN maps to 0 in every kernel
+template <typename T>
+inline uint8_t quantize_one(T v, const QuantizeParams& p) {
+    float t = static_cast<float>(v) * p.scale + p.offset;
+    t = t > 0.0f ? t : 0.0f;
+    t = t < 255.0f ? t : 255.0f;
+    return static_cast<uint8_t>(t + 0.5f);
+}
+
+template <typename T>
+void quantize_scalar(const T* in, size_t count, const QuantizeParams& p, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = quantize_one(in[i], p);
+    }
+}
+
+
+#ifdef QUANTIZE_HAVE_SSE2
+inline __m128 load4_sse2(const float* in) {
+    return _mm_loadu_ps(in);
+}
+
+inline __m128 load4_sse2(const uint16_t* in) {
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+inline __m128 load4_sse2(const uint8_t* in) {
+    int32_t packed;
+    std::memcpy(&packed, in, sizeof(packed));
+    const __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), _mm_setzero_si128());
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+template <typename T>
+inline __m128i quantize4_sse2(const T* in, __m128 scale, __m128 offset, __m128 upper, __m128 half) {
+    __m128 t = _mm_add_ps(_mm_mul_ps(load4_sse2(in), scale), offset);
+    t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), upper);
+    return _mm_cvttps_epi32(_mm_add_ps(t, half));
+}
+
+template <typename T>
+void quantize_sse2(const T* in, size_t count, const QuantizeParams& p, uint8_t* out) {
+    const __m128 scale = _mm_set1_ps(p.scale);
+    const __m128 offset = _mm_set1_ps(p.offset);
+    const __m128 upper = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = quantize4_sse2(in + i, scale, offset, upper, half);
+        const __m128i b = quantize4_sse2(in + i + 4, scale, offset, upper, half);
+        const __m128i c = quantize4_sse2(in + i + 8, scale, offset, upper, half);
+        const __m128i d = quantize4_sse2(in + i + 12, scale, offset, upper, half);
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    quantize_scalar(in + i, count - i, p, out + i);
+}
+#endif
+
+
+#ifdef QUANTIZE_HAVE_AVX2
+QUANTIZE_TARGET_AVX2 inline __m256 load8_avx2(const float* in) {
+    return _mm256_loadu_ps(in);
+}
+
+QUANTIZE_TARGET_AVX2 inline __m256 load8_avx2(const uint16_t* in) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))));
+}
+
+QUANTIZE_TARGET_AVX2 inline __m256 load8_avx2(const uint8_t* in) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in))));
+}
+
+template <typename T>
+QUANTIZE_TARGET_AVX2 inline __m256i quantize8_avx2(const T* in, __m256 scale, __m256 offset, __m256 upper, __m256 half) {
+    __m256 t = _mm256_add_ps(_mm256_mul_ps(load8_avx2(in), scale), offset);
+    t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), upper);
+    return _mm256_cvttps_epi32(_mm256_add_ps(t, half));
+}
+
+template <typename T>
+QUANTIZE_TARGET_AVX2 void quantize_avx2(const T* in, size_t count, const QuantizeParams& p, uint8_t* out) {
+    const __m256 scale = _mm256_set1_ps(p.scale);
+    const __m256 offset = _mm256_set1_ps(p.offset);
+    const __m256 upper = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    // The packs work within 128 bit lanes, so the 4 byte groups come out as a0 b0 c0 d0 a1 b1 c1 d1
+    const __m256i unshuffle = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i a = quantize8_avx2(in + i, scale, offset, upper, half);
+        const __m256i b = quantize8_avx2(in + i + 8, scale, offset, upper, half);
+        const __m256i c = quantize8_avx2(in + i + 16, scale, offset, upper, half);
+        const __m256i d = quantize8_avx2(in + i + 24, scale, offset, upper, half);
+        const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permutevar8x32_epi32(bytes, unshuffle));
+    }
+    quantize_scalar(in + i, count - i, p, out + i);
+}
+#endif
+
+
+bool kernel_supported(QuantizeKernel kernel) {
+    switch (kernel) {
+    case QuantizeKernel::SCALAR:
+        return true;
+#ifdef QUANTIZE_HAVE_SSE2
+    case QuantizeKernel::SSE2:
+        return true;
+#endif
+#ifdef QUANTIZE_HAVE_AVX2
+    case QuantizeKernel::AVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    default:
+        return false;
+    }
+}
+
+template <typename T>
+void quantize_with(QuantizeKernel kernel, const T* in, size_t count, const QuantizeParams& p, uint8_t* out) {
+    switch (kernel) {
+#ifdef QUANTIZE_HAVE_AVX2
+    case QuantizeKernel::AVX2: quantize_avx2(in, count, p, out); break;
+#endif
+#ifdef QUANTIZE_HAVE_SSE2
+    case QuantizeKernel::SSE2: quantize_sse2(in, count, p, out); break;
+#endif
+    default: quantize_scalar(in, count, p, out); break;
+    }
+}
+}
+
+
+QuantizeKernel best_quantize_kernel() {
+    static const QuantizeKernel best = []() {
+        for (QuantizeKernel kernel : { QuantizeKernel::AVX2, QuantizeKernel::SSE2 }) {
+            if (kernel_supported(kernel)) {
+                return kernel;
+            }
+        }
+        return QuantizeKernel::SCALAR;
+    }();
+    return best;
+}
+
+const char* quantize_kernel_name(QuantizeKernel kernel) {
+    switch (kernel) {
+    case QuantizeKernel::AUTO: return quantize_kernel_name(best_quantize_kernel());
+    case QuantizeKernel::SCALAR: return "scalar";
+    case QuantizeKernel::SSE2: return "SSE2";
+    case QuantizeKernel::AVX2: return "AVX2";
+    default: return "unknown";
+    }
+}
+
+void quantize_to_uint8(VoxelFormat format, const uint8_t* in, size_t count,
+                       double min_value, double max_value, uint8_t* out,
+                       unsigned num_threads, QuantizeKernel kernel) {
+    if (kernel == QuantizeKernel::AUTO || !kernel_supported(kernel)) {
+        kernel = best_quantize_kernel();
+    }
+
+    // Fold the normalization of the raw sample into the stretch so the kernels work on raw values
+    double to_normalized = 1.0;
+    switch (format) {
+    case VoxelFormat::UINT8: to_normalized = 1.0 / 255.0; break;
+    case VoxelFormat::UINT16: to_normalized = 1.0 / 65535.0; break;
+    case VoxelFormat::FLOAT32: to_normalized = 1.0; break;
+    default: return;
+    }
+    const double value_range = max_value - min_value;
+    const double stretch = value_range > 0.0 ? 255.0 / value_range : 0.0;
+    const QuantizeParams params = {
+        static_cast<float>(to_normalized * stretch),
+        static_cast<float>(-min_value * stretch)
+    };
+
+    visit_samples(format, in, [&](auto* samples) {
+        parallel_for_chunks(0, count, QUANTIZE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            quantize_with(kernel, samples + begin, end - begin, params, out + begin);
+        }, num_threads);
+    });
+}
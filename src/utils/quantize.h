@@ -0,0 +1,30 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "volume_data.h"
+
+
+// Instruction set used to quantize samples. AUTO picks the best one the CPU supports.
+enum class QuantizeKernel {
+    AUTO = 0,
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Best kernel this build supports on the CPU it is running on
+QuantizeKernel best_quantize_kernel();
+const char* quantize_kernel_name(QuantizeKernel kernel);
+
+// Stretch count samples of the given format from the normalized range [min_value, max_value] to
+// [0, 255] and write them to out, one byte per sample. Values outside the range are clamped.
+// Runs on num_threads threads (0 means one per core). If in is 8 bit, in and out may be the same buffer.
+// Asking for a kernel the CPU doesn't support uses the best one that it does.
+void quantize_to_uint8(VoxelFormat format, const uint8_t* in, size_t count,
+                       double min_value, double max_value, uint8_t* out,
+                       unsigned num_threads = 0, QuantizeKernel kernel = QuantizeKernel::AUTO);
+
+#endif // QUANTIZE_H
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "parallel_for.h"
 
 #include <igl/edges.h>
 #include <igl/barycentric_coordinates.h>
@@ -12,6 +13,11 @@
 #include <igl/adjacency_list.h>
 #include <igl/components.h>
 
+namespace {
+// Number of voxels converted per task when loading raw files
+constexpr size_t RAWFILE_CHUNK_SIZE = 1 << 22;
+}
+
 
 void split_mesh_components(const Eigen::MatrixXi& TT, const Eigen::VectorXi& components, std::vector<Eigen::MatrixXi>& out) {
   const int num_components = components.maxCoeff() + 1;
@@ -128,63 +134,58 @@ void load_tet_file(const std::string& tet, Eigen::MatrixXd& TV, Eigen::MatrixXi&
   tet_mesh_faces(TT, TF, true /*flip*/);
 }
 
-bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, Eigen::VectorXf& out, std::shared_ptr<spdlog::logger> logger, bool normalize) {
+bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, MappedFile& out, std::shared_ptr<spdlog::logger> logger) {
     const size_t num_bytes = (size_t)(dims[0]) * (size_t)(dims[1]) * (size_t)(dims[2]);
 
-    char* data = new char[num_bytes];
-    std::ifstream rawfile(rawfilename, std::ifstream::binary);
-
-    if (!rawfile.good()) {
-        logger->error("RawFile '{}' does not exist.", rawfilename);
+    if (!out.open(rawfilename, logger)) {
+        logger->error("RawFile '{}' could not be opened.", rawfilename);
+        return false;
+    }
+    if (out.size() < num_bytes) {
+        logger->error("RawFile '{}' only contains {} bytes, but expected {} bytes.", rawfilename, out.size(), num_bytes);
+        out.close();
         return false;
     }
+    out.will_need(0, num_bytes);
 
-    rawfile.read(data, num_bytes);
-    if (!rawfile) {
-        logger->error("Only read {} bytes from RawFile '{}', but expected to read {} bytes.", rawfile.gcount(), rawfilename, num_bytes);
+    return true;
+}
+
+bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, Eigen::VectorXf& out, std::shared_ptr<spdlog::logger> logger, bool normalize) {
+    MappedFile rawfile;
+    if (!load_rawfile(rawfilename, dims, rawfile, logger)) {
         return false;
     }
-    rawfile.close();
 
+    const size_t num_bytes = (size_t)(dims[0]) * (size_t)(dims[1]) * (size_t)(dims[2]);
+    const float scale = normalize ? 1.0f / 255.0f : 1.0f;
+    const uint8_t* data = rawfile.data();
     out.resize(num_bytes);
-    for (int i = 0; i < num_bytes; i++) {
-        out[i] = static_cast<double>(reinterpret_cast<std::uint8_t*>(data)[i]);
-        if (normalize) {
-            static_assert(sizeof(char) == sizeof(std::uint8_t), "Your system is fucked"); // This is dumb but why not
-            out[i] /= 255.0;
+    float* out_data = out.data();
+
+    // Convert straight out of the page cache, one chunk per thread
+    parallel_for_chunks(0, num_bytes, RAWFILE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            out_data[i] = static_cast<float>(data[i]) * scale;
         }
-    }
+    });
 
     return true;
 }
 
 bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, std::vector<uint8_t> &out, std::shared_ptr<spdlog::logger> logger) {
-    const size_t num_bytes = (size_t)(dims[0]) * (size_t)(dims[1]) * (size_t)(dims[2]);
-
-    logger->trace("allocating {} bytes", num_bytes);
-    char* data = new char[num_bytes];
-    logger->trace("Allocated {} bytes", num_bytes);
-
-    std::ifstream rawfile(rawfilename, std::ifstream::binary);
-    if (!rawfile.good()) {
-        logger->error("RawFile '{}' does not exist.", rawfilename);
+    MappedFile rawfile;
+    if (!load_rawfile(rawfilename, dims, rawfile, logger)) {
         return false;
     }
 
-    logger->trace("About to read {} bytes", num_bytes);
-    rawfile.read(data, num_bytes);
-    if (!rawfile) {
-        logger->error("Only read {} bytes from RawFile '{}', but expected to read {} bytes.", rawfile.gcount(), rawfilename, num_bytes);
-        return false;
-    }
-    rawfile.close();
-    logger->trace("read {} bytes", num_bytes);
-
-    logger->trace("Resizing output");
+    const size_t num_bytes = (size_t)(dims[0]) * (size_t)(dims[1]) * (size_t)(dims[2]);
+    logger->trace("Copying {} bytes", num_bytes);
     out.resize(num_bytes);
-    for (size_t i = 0; i < num_bytes; i++) {
-        out[i] = data[i];
-    }
+    const uint8_t* data = rawfile.data();
+    parallel_for_chunks(0, num_bytes, RAWFILE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        std::copy(data + begin, data + end, out.begin() + begin);
+    });
     logger->trace("Copied output");
     return true;
 }
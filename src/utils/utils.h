@@ -7,6 +7,7 @@
 #include <array>
 #include <memory>
 
+#include "mapped_file.h"
 
 #ifdef _MSC_VER
     static constexpr int PATH_BUFFER_SIZE = 4*4096;
@@ -38,6 +39,9 @@ void tet_mesh_faces(const Eigen::MatrixXi& TT, Eigen::MatrixXi& TF, bool flip=fa
 
 void load_tet_file(const std::string& tet, Eigen::MatrixXd& TV, Eigen::MatrixXi& TF, Eigen::MatrixXi& TT);
 
+// Map a raw volume into memory without copying it. Fails if the file holds fewer than dims voxels.
+bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, MappedFile& out, std::shared_ptr<spdlog::logger> logger);
+
 bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, Eigen::VectorXf &out, std::shared_ptr<spdlog::logger> logger, bool normalize = true);
 
 bool load_rawfile(const std::string& rawfilename, const Eigen::RowVector3i& dims, std::vector<uint8_t> &out, std::shared_ptr<spdlog::logger> logger);
@@ -0,0 +1,106 @@
+#include "volume_bricks.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+// Number of bricks checked per task
+constexpr size_t BRICK_CHUNK_SIZE = 8;
+
+// Voxels [begin, end) of the volume covered by the brick with index b along an axis of n voxels
+inline void brick_span(int b, int n, int& begin, int& end) {
+    begin = std::max(b * VOLUME_BRICK_PAYLOAD - VOLUME_BRICK_APRON, 0);
+    end = std::min(b * VOLUME_BRICK_PAYLOAD - VOLUME_BRICK_APRON + VOLUME_BRICK_SIZE, n);
+}
+
+template <typename T>
+bool brick_occupied(const BrickGrid& grid, const T* slab, int slab_z_begin, int bx, int by, int bz, float threshold) {
+    int x0, x1, y0, y1, z0, z1;
+    brick_span(bx, grid.w, x0, x1);
+    brick_span(by, grid.h, y0, y1);
+    brick_span(bz, grid.d, z0, z1);
+
+    const size_t slice_voxels = size_t(grid.w) * size_t(grid.h);
+    for (int z = z0; z < z1; z++) {
+        for (int y = y0; y < y1; y++) {
+            const T* row = slab + size_t(z - slab_z_begin) * slice_voxels + size_t(y) * grid.w;
+            // A branch free max over the row vectorizes, the early out only happens once per row
+            float row_max = VoxelTraits<T>::normalize(row[x0]);
+            for (int x = x0 + 1; x < x1; x++) {
+                const float v = VoxelTraits<T>::normalize(row[x]);
+                row_max = v > row_max ? v : row_max;
+            }
+            if (row_max > threshold) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Raw sample that is 0 once stretched from min_value. Integer samples are never below their minimum.
+template <typename T>
+T empty_sample(double min_value) {
+    return std::is_floating_point<T>::value ? static_cast<T>(min_value) : T(0);
+}
+}
+
+
+BrickGrid::BrickGrid(int w, int h, int d) : w(w), h(h), d(d) {
+    nx = (w + VOLUME_BRICK_PAYLOAD - 1) / VOLUME_BRICK_PAYLOAD;
+    ny = (h + VOLUME_BRICK_PAYLOAD - 1) / VOLUME_BRICK_PAYLOAD;
+    nz = (d + VOLUME_BRICK_PAYLOAD - 1) / VOLUME_BRICK_PAYLOAD;
+}
+
+void BrickGrid::layer_slices(int bz, int& z_begin, int& z_end) const {
+    brick_span(bz, d, z_begin, z_end);
+}
+
+
+void find_occupied_bricks(const BrickGrid& grid, const VolumeSlab& slab, int bz, double min_value,
+                          std::vector<uint8_t>& occupied) {
+    occupied.assign(grid.layer_size(), 0);
+    const float threshold = static_cast<float>(min_value);
+    visit_samples(slab.format, slab.samples, [&](auto* samples) {
+        parallel_for_chunks(0, grid.layer_size(), BRICK_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const int bx = int(i % size_t(grid.nx));
+                const int by = int(i / size_t(grid.nx));
+                occupied[i] = brick_occupied(grid, samples, slab.z_begin, bx, by, bz, threshold) ? 1 : 0;
+            }
+        });
+    });
+}
+
+void gather_brick(const BrickGrid& grid, const VolumeSlab& slab, int bx, int by, int bz, double min_value,
+                  uint8_t* out) {
+    visit_samples(slab.format, slab.samples, [&](auto* samples) {
+        typedef VoxelTypeOf<decltype(samples)> T;
+        T* brick = reinterpret_cast<T*>(out);
+
+        // Origin of the brick in the volume, this is negative for the apron of the first brick
+        const int ox = bx * VOLUME_BRICK_PAYLOAD - VOLUME_BRICK_APRON;
+        const int oy = by * VOLUME_BRICK_PAYLOAD - VOLUME_BRICK_APRON;
+        const int oz = bz * VOLUME_BRICK_PAYLOAD - VOLUME_BRICK_APRON;
+        int x0, x1, y0, y1, z0, z1;
+        brick_span(bx, grid.w, x0, x1);
+        brick_span(by, grid.h, y0, y1);
+        brick_span(bz, grid.d, z0, z1);
+
+        const bool clipped = x1 - x0 < VOLUME_BRICK_SIZE || y1 - y0 < VOLUME_BRICK_SIZE || z1 - z0 < VOLUME_BRICK_SIZE;
+        if (clipped) {
+            std::fill(brick, brick + VOLUME_BRICK_VOXELS, empty_sample<T>(min_value));
+        }
+
+        const size_t slice_voxels = size_t(grid.w) * size_t(grid.h);
+        for (int z = z0; z < z1; z++) {
+            for (int y = y0; y < y1; y++) {
+                const T* row = samples + size_t(z - slab.z_begin) * slice_voxels + size_t(y) * grid.w;
+                T* brick_row = brick + (size_t(z - oz) * VOLUME_BRICK_SIZE + size_t(y - oy)) * VOLUME_BRICK_SIZE;
+                std::memcpy(brick_row + (x0 - ox), row + x0, size_t(x1 - x0) * sizeof(T));
+            }
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#ifndef VOLUME_BRICKS_H
+#define VOLUME_BRICKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "volume_data.h"
+
+
+// Volumes too big for a single texture are uploaded as fixed size bricks. Each brick holds
+// VOLUME_BRICK_PAYLOAD voxels of the volume along each axis plus an apron copied from its
+// neighbours, so trilinear filtering inside a brick never has to read another brick.
+constexpr int VOLUME_BRICK_SIZE = 32;
+constexpr int VOLUME_BRICK_APRON = 1;
+constexpr int VOLUME_BRICK_PAYLOAD = VOLUME_BRICK_SIZE - 2*VOLUME_BRICK_APRON;
+constexpr size_t VOLUME_BRICK_VOXELS = size_t(VOLUME_BRICK_SIZE) * VOLUME_BRICK_SIZE * VOLUME_BRICK_SIZE;
+
+
+// How a volume of w*h*d voxels is split into nx*ny*nz bricks
+struct BrickGrid {
+    int w = 0, h = 0, d = 0;
+    int nx = 0, ny = 0, nz = 0;
+
+    BrickGrid() = default;
+    BrickGrid(int w, int h, int d);
+
+    size_t num_bricks() const { return layer_size() * size_t(nz); }
+
+    // Number of bricks with the same z index
+    size_t layer_size() const { return size_t(nx) * size_t(ny); }
+
+    // Slices [z_begin, z_end) of the volume covered by the bricks in layer bz, apron included
+    void layer_slices(int bz, int& z_begin, int& z_end) const;
+};
+
+// Whole slices [z_begin, z_end) of a volume in its native format
+struct VolumeSlab {
+    VoxelFormat format = VoxelFormat::UINT8;
+    const uint8_t* samples = nullptr;
+    int z_begin = 0;
+    int z_end = 0;
+};
+
+// Set occupied[by*nx + bx] to 1 for every brick in layer bz with a sample (apron included) above
+// min_value and to 0 otherwise. The other bricks are all 0 once stretched from [min_value, max_value]
+// for display, so they don't need to be uploaded. slab must hold grid.layer_slices(bz).
+void find_occupied_bricks(const BrickGrid& grid, const VolumeSlab& slab, int bz, double min_value,
+                          std::vector<uint8_t>& occupied);
+
+// Copy brick (bx, by, bz) to out as VOLUME_BRICK_VOXELS samples in the slab's format, x fastest.
+// Apron voxels outside of the volume get a value that is 0 after stretching from min_value,
+// which matches the transparent border of an unbricked volume texture.
+void gather_brick(const BrickGrid& grid, const VolumeSlab& slab, int bx, int by, int bz, double min_value,
+                  uint8_t* out);
+
+#endif // VOLUME_BRICKS_H
@@ -0,0 +1,228 @@
+#include "volume_data.h"
+#include "volume_statistics.h"
+#include "quantize.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace {
+// Number of voxels processed per task
+constexpr size_t VOLUME_CHUNK_SIZE = 1 << 22;
+
+// Number of bytes of the file read per prefetch task
+constexpr size_t PREFETCH_CHUNK_BYTES = 1 << 24;
+
+// Number of prefetch tasks run at once. This is about keeping enough reads in flight
+// to saturate the disk rather than about the number of cores.
+constexpr unsigned PREFETCH_NUM_THREADS = 8;
+
+// Output slices per downsampling task
+constexpr size_t DOWNSAMPLE_SLICES_PER_CHUNK = 1;
+
+template <typename T>
+void downsample(const T* in, const Eigen::RowVector3i& dims, int factor, T* out, const Eigen::RowVector3i& out_dims) {
+    const size_t w = size_t(dims[0]), h = size_t(dims[1]);
+    const size_t ow = size_t(out_dims[0]), oh = size_t(out_dims[1]);
+    parallel_for_chunks(0, size_t(out_dims[2]), DOWNSAMPLE_SLICES_PER_CHUNK, [&](size_t z_begin, size_t z_end) {
+        std::vector<float> row_sums(ow);
+        std::vector<uint32_t> row_counts(ow);
+        for (size_t oz = z_begin; oz < z_end; oz++) {
+            for (size_t oy = 0; oy < oh; oy++) {
+                std::fill(row_sums.begin(), row_sums.end(), 0.0f);
+                std::fill(row_counts.begin(), row_counts.end(), 0u);
+                const size_t z1 = std::min(size_t(dims[2]), (oz + 1) * factor);
+                const size_t y1 = std::min(h, (oy + 1) * factor);
+                for (size_t z = oz * factor; z < z1; z++) {
+                    for (size_t y = oy * factor; y < y1; y++) {
+                        const T* row = in + (z * h + y) * w;
+                        for (size_t x = 0; x < w; x++) {
+                            row_sums[x / factor] += VoxelTraits<T>::normalize(row[x]);
+                            row_counts[x / factor] += 1;
+                        }
+                    }
+                }
+                T* out_row = out + (oz * oh + oy) * ow;
+                for (size_t ox = 0; ox < ow; ox++) {
+                    out_row[ox] = VoxelTraits<T>::from_normalized(row_sums[ox] / float(row_counts[ox]));
+                }
+            }
+        }
+    });
+}
+
+}
+
+
+VoxelFormat voxel_format_from_string(const std::string& format) {
+    if (format.empty() || format == "UINT8") {
+        return VoxelFormat::UINT8;
+    } else if (format == "UINT16") {
+        return VoxelFormat::UINT16;
+    } else if (format == "FLOAT32" || format == "FLOAT") {
+        return VoxelFormat::FLOAT32;
+    }
+    return VoxelFormat::INVALID;
+}
+
+const char* voxel_format_to_string(VoxelFormat format) {
+    switch (format) {
+    case VoxelFormat::UINT8: return "UINT8";
+    case VoxelFormat::UINT16: return "UINT16";
+    case VoxelFormat::FLOAT32: return "FLOAT32";
+    default: return "INVALID";
+    }
+}
+
+size_t voxel_format_size(VoxelFormat format) {
+    switch (format) {
+    case VoxelFormat::UINT8: return sizeof(uint8_t);
+    case VoxelFormat::UINT16: return sizeof(uint16_t);
+    case VoxelFormat::FLOAT32: return sizeof(float);
+    default: return 0;
+    }
+}
+
+
+void rescale_samples(VoxelFormat format, const uint8_t* in, size_t count,
+                     double min_value, double max_value, uint8_t* out) {
+    // Stretching 8 bit samples is exactly what the vectorized quantization kernels do
+    if (format == VoxelFormat::UINT8) {
+        quantize_to_uint8(format, in, count, min_value, max_value, out);
+        return;
+    }
+
+    const float range_min = static_cast<float>(min_value);
+    const float value_range = static_cast<float>(max_value - min_value);
+    const float scale = value_range > 0.0f ? 1.0f / value_range : 0.0f;
+    visit_samples(format, in, [&](auto* in_samples) {
+        typedef VoxelTypeOf<decltype(in_samples)> T;
+        T* out_samples = reinterpret_cast<T*>(out);
+        parallel_for_chunks(0, count, VOLUME_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const float v = (VoxelTraits<T>::normalize(in_samples[i]) - range_min) * scale;
+                out_samples[i] = VoxelTraits<T>::from_normalized(std::min(std::max(v, 0.0f), 1.0f));
+            }
+        });
+    });
+}
+
+
+bool VolumeData::load(const std::string& rawfilename, size_t num_voxels, VoxelFormat format, std::shared_ptr<spdlog::logger> logger) {
+    clear();
+    if (format == VoxelFormat::INVALID) {
+        logger->error("RawFile '{}' has an unsupported voxel format.", rawfilename);
+        return false;
+    }
+
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(rawfilename, logger)) {
+        logger->error("RawFile '{}' could not be opened.", rawfilename);
+        return false;
+    }
+
+    const size_t num_bytes = num_voxels * voxel_format_size(format);
+    if (mapping->size() < num_bytes) {
+        logger->error("RawFile '{}' only contains {} bytes, but expected {} bytes.", rawfilename, mapping->size(), num_bytes);
+        return false;
+    }
+    mapping->will_need(0, num_bytes);
+
+    _mapping = mapping;
+    _format = format;
+    _num_voxels = num_voxels;
+    return true;
+}
+
+void VolumeData::prefetch(VolumeLoadProgress* progress, VolumeStatistics* statistics) const {
+    const size_t num_bytes = size_in_bytes();
+    const size_t voxel_size = voxel_format_size(_format);
+    if (progress) {
+        progress->bytes_total = num_bytes;
+        progress->bytes_done = 0;
+    }
+    if (num_bytes == 0 || (!_mapping && !statistics)) {
+        if (progress) {
+            progress->bytes_done = num_bytes;
+        }
+        return;
+    }
+
+    // Binning a slab reads all of its pages, so it takes the place of touching them
+    VolumeStatisticsBuilder builder(_format);
+    parallel_for_chunks(0, num_bytes, PREFETCH_CHUNK_BYTES, [&](size_t begin, size_t end) {
+        if (_mapping) {
+            _mapping->will_need(begin, end - begin);
+        }
+        if (statistics) {
+            builder.add(bytes() + begin, (end - begin) / voxel_size);
+        } else {
+            _mapping->touch(begin, end - begin);
+        }
+        if (progress) {
+            progress->bytes_done += end - begin;
+        }
+    }, PREFETCH_NUM_THREADS);
+
+    if (statistics) {
+        if (builder.needs_histogram_pass()) {
+            parallel_for_chunks(0, num_bytes, PREFETCH_CHUNK_BYTES, [&](size_t begin, size_t end) {
+                builder.add_to_histogram(bytes() + begin, (end - begin) / voxel_size);
+            });
+        }
+        builder.finish(*statistics);
+    }
+}
+
+void VolumeData::allocate(size_t num_voxels, VoxelFormat format) {
+    clear();
+    _format = format;
+    _num_voxels = num_voxels;
+    _owned.resize(size_in_bytes(), 0);
+}
+
+void VolumeData::clear() {
+    _mapping.reset();
+    _owned.clear();
+    _owned.shrink_to_fit();
+    _num_voxels = 0;
+}
+
+float VolumeData::normalized(size_t i) const {
+    switch (_format) {
+    case VoxelFormat::UINT8: return VoxelTraits<uint8_t>::normalize(data<uint8_t>()[i]);
+    case VoxelFormat::UINT16: return VoxelTraits<uint16_t>::normalize(data<uint16_t>()[i]);
+    case VoxelFormat::FLOAT32: return data<float>()[i];
+    default: return 0.0f;
+    }
+}
+
+void VolumeData::normalized_copy(Eigen::VectorXf& out) const {
+    out.resize(_num_voxels);
+    float* out_data = out.data();
+    visit([&](auto* samples) {
+        typedef VoxelTypeOf<decltype(samples)> T;
+        parallel_for_chunks(0, _num_voxels, VOLUME_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                out_data[i] = VoxelTraits<T>::normalize(samples[i]);
+            }
+        });
+    });
+}
+
+
+Eigen::RowVector3i downsampled_dims(const Eigen::RowVector3i& dims, int factor) {
+    return Eigen::RowVector3i((dims[0] + factor - 1) / factor,
+                              (dims[1] + factor - 1) / factor,
+                              (dims[2] + factor - 1) / factor);
+}
+
+void downsample_volume(const VolumeData& in, const Eigen::RowVector3i& dims, int factor, VolumeData& out) {
+    const Eigen::RowVector3i out_dims = downsampled_dims(dims, factor);
+    out.allocate(size_t(out_dims[0]) * size_t(out_dims[1]) * size_t(out_dims[2]), in.format());
+    uint8_t* out_bytes = out.mutable_bytes();
+    in.visit([&](auto* samples) {
+        typedef VoxelTypeOf<decltype(samples)> T;
+        downsample(samples, dims, factor, reinterpret_cast<T*>(out_bytes), out_dims);
+    });
+}
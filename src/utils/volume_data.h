@@ -0,0 +1,174 @@
+#ifndef VOLUME_DATA_H
+#define VOLUME_DATA_H
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+
+
+// Sample types a raw volume can be stored as. The names match the Format: field of a .dat file.
+enum class VoxelFormat {
+    UINT8 = 0,
+    UINT16,
+    FLOAT32,
+    INVALID
+};
+
+// Parse the Format: field of a .dat file. An empty string means UINT8 for backwards compatibility.
+VoxelFormat voxel_format_from_string(const std::string& format);
+const char* voxel_format_to_string(VoxelFormat format);
+size_t voxel_format_size(VoxelFormat format);
+
+
+template <typename T> struct VoxelTraits;
+
+template <> struct VoxelTraits<uint8_t> {
+    static constexpr VoxelFormat format = VoxelFormat::UINT8;
+    static float normalize(uint8_t v) { return static_cast<float>(v) * (1.0f / 255.0f); }
+    static uint8_t from_normalized(float v) { return static_cast<uint8_t>(v * 255.0f + 0.5f); }
+};
+
+template <> struct VoxelTraits<uint16_t> {
+    static constexpr VoxelFormat format = VoxelFormat::UINT16;
+    static float normalize(uint16_t v) { return static_cast<float>(v) * (1.0f / 65535.0f); }
+    static uint16_t from_normalized(float v) { return static_cast<uint16_t>(v * 65535.0f + 0.5f); }
+};
+
+// Floating point volumes are stored as is, their range is whatever the scanner produced
+template <> struct VoxelTraits<float> {
+    static constexpr VoxelFormat format = VoxelFormat::FLOAT32;
+    static float normalize(float v) { return v; }
+    static float from_normalized(float v) { return v; }
+};
+
+// The sample type behind the pointer handed to a VolumeData::visit callback
+template <typename Ptr>
+using VoxelTypeOf = typename std::remove_const<typename std::remove_pointer<Ptr>::type>::type;
+
+
+// Call fn with samples reinterpreted as a pointer to the C++ type of format
+template <typename Fn>
+void visit_samples(VoxelFormat format, const uint8_t* samples, Fn&& fn) {
+    switch (format) {
+    case VoxelFormat::UINT8: fn(reinterpret_cast<const uint8_t*>(samples)); break;
+    case VoxelFormat::UINT16: fn(reinterpret_cast<const uint16_t*>(samples)); break;
+    case VoxelFormat::FLOAT32: fn(reinterpret_cast<const float*>(samples)); break;
+    default: break;
+    }
+}
+
+// Stretch count samples from the normalized range [min_value, max_value] to [0, 1] and write them
+// to out in the same format, in parallel. in and out may point to the same buffer.
+void rescale_samples(VoxelFormat format, const uint8_t* in, size_t count,
+                     double min_value, double max_value, uint8_t* out);
+
+
+// Progress of a volume being read, safe to poll from the UI thread while a loader thread updates it
+struct VolumeLoadProgress {
+    std::atomic<size_t> bytes_done{0};
+    std::atomic<size_t> bytes_total{0};
+
+    void reset() {
+        bytes_done = 0;
+        bytes_total = 0;
+    }
+
+    float fraction() const {
+        const size_t total = bytes_total;
+        return total == 0 ? 0.0f : float(double(bytes_done) / double(total));
+    }
+};
+
+
+struct VolumeStatistics;
+
+
+// Voxel samples in their native type, either memory mapped from a raw file or owned.
+// Copies share the mapping, so copying a mapped volume is cheap.
+class VolumeData {
+public:
+    // Map rawfilename holding num_voxels samples of the given format
+    bool load(const std::string& rawfilename, size_t num_voxels, VoxelFormat format, std::shared_ptr<spdlog::logger> logger);
+
+    // Read the mapped samples into memory using several threads, one slab of the file per task,
+    // so loading is bounded by disk bandwidth instead of by page faults on a single core.
+    // If statistics is not null they are gathered from each slab as it is read.
+    void prefetch(VolumeLoadProgress* progress = nullptr, VolumeStatistics* statistics = nullptr) const;
+
+    // Allocate owned (zero initialized) storage for num_voxels samples
+    void allocate(size_t num_voxels, VoxelFormat format);
+
+    void clear();
+
+    VoxelFormat format() const { return _format; }
+    size_t size() const { return _num_voxels; }
+    bool empty() const { return _num_voxels == 0; }
+    size_t size_in_bytes() const { return _num_voxels * voxel_format_size(_format); }
+
+    const uint8_t* bytes() const {
+        return _mapping ? _mapping->data() : _owned.data();
+    }
+
+    // Only owned storage is writable
+    uint8_t* mutable_bytes() {
+        assert(!_mapping);
+        return _owned.data();
+    }
+
+    template <typename T>
+    const T* data() const {
+        assert(VoxelTraits<T>::format == _format);
+        return reinterpret_cast<const T*>(bytes());
+    }
+
+    template <typename T>
+    T* mutable_data() {
+        assert(VoxelTraits<T>::format == _format);
+        return reinterpret_cast<T*>(mutable_bytes());
+    }
+
+    // Sample i scaled to [0, 1] for integer formats
+    float normalized(size_t i) const;
+
+    // Call fn with a typed pointer to the samples
+    template <typename Fn>
+    void visit(Fn&& fn) const {
+        visit_samples(_format, bytes(), std::forward<Fn>(fn));
+    }
+
+    // Expand the whole volume to normalized floats. Only use this where a float copy is really needed.
+    void normalized_copy(Eigen::VectorXf& out) const;
+
+    // Stretch samples [first, first+count) from the normalized range [min_value, max_value] to [0, 1]
+    // and write them to out in the same format, so count*voxel_format_size(format()) bytes are written
+    void rescale(size_t first, size_t count, double min_value, double max_value, uint8_t* out) const {
+        rescale_samples(_format, bytes() + first*voxel_format_size(_format), count, min_value, max_value, out);
+    }
+
+private:
+    VoxelFormat _format = VoxelFormat::UINT8;
+    size_t _num_voxels = 0;
+    std::shared_ptr<MappedFile> _mapping;
+    std::vector<uint8_t> _owned;
+};
+
+
+// Dimensions of a volume of dims downsampled by factor, rounding up
+Eigen::RowVector3i downsampled_dims(const Eigen::RowVector3i& dims, int factor);
+
+// Average each factor^3 block of samples of in, a volume of size dims, into one sample of out.
+// Blocks cut off by the end of the volume average the samples they cover. out has the format of in.
+void downsample_volume(const VolumeData& in, const Eigen::RowVector3i& dims, int factor, VolumeData& out);
+
+#endif // VOLUME_DATA_H
@@ -0,0 +1,98 @@
+#include "volume_gradients.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+inline int8_t to_snorm8(float v) {
+    return static_cast<int8_t>(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f));
+}
+
+// Most slices each task computes the gradients of. Every task stretches the rows of the slices on
+// either side of its own too, so bigger tasks convert fewer rows twice.
+constexpr size_t GRADIENT_CHUNK_SLICES = 8;
+
+// Stretched samples of row y of slice z into row, w + 2 values with a 0 on either end for the voxels
+// past the edge of the volume. Rows outside of the volume are all 0.
+template <typename T>
+void stretched_row(const T* slab, int slab_z_begin, int w, int h, int d, int y, int z, float lo, float scale,
+                   float* row) {
+    std::fill(row, row + size_t(w) + 2, 0.0f);
+    if (y < 0 || y >= h || z < 0 || z >= d) {
+        return;
+    }
+    const T* samples = slab + (size_t(z - slab_z_begin) * size_t(h) + size_t(y)) * size_t(w);
+    for (int x = 0; x < w; x++) {
+        const float v = (VoxelTraits<T>::normalize(samples[x]) - lo) * scale;
+        row[size_t(x) + 1] = std::min(std::max(v, 0.0f), 1.0f);
+    }
+}
+
+// Gradients of slices [z_begin, z_end), written slice after slice to out. The stretched rows y - 1, y and
+// y + 1 of slices z_begin - 1 to z_end are kept in a ring, so advancing y stretches only the rows y + 2 and
+// every row of the volume is stretched once per task.
+template <typename T>
+void gradient_slices(const T* slab, int slab_z_begin, int w, int h, int d, int z_begin, int z_end,
+                     float lo, float scale, int8_t* out) {
+    const size_t row_size = size_t(w) + 2;
+    const size_t plane_size = size_t(z_end - z_begin + 2) * row_size;
+    std::vector<float> rows(3 * plane_size);
+    auto row = [&](int y, int z) {
+        return rows.data() + size_t((y + 3) % 3) * plane_size + size_t(z - z_begin + 1) * row_size;
+    };
+
+    for (int z = z_begin - 1; z <= z_end; z++) {
+        stretched_row(slab, slab_z_begin, w, h, d, -1, z, lo, scale, row(-1, z));
+        stretched_row(slab, slab_z_begin, w, h, d, 0, z, lo, scale, row(0, z));
+    }
+    for (int y = 0; y < h; y++) {
+        // Row y + 1 replaces row y - 2, which no slice needs anymore
+        for (int z = z_begin - 1; z <= z_end; z++) {
+            stretched_row(slab, slab_z_begin, w, h, d, y + 1, z, lo, scale, row(y + 1, z));
+        }
+
+        for (int z = z_begin; z < z_end; z++) {
+            const float* center = row(y, z);
+            const float* below = row(y - 1, z);
+            const float* above = row(y + 1, z);
+            const float* back = row(y, z - 1);
+            const float* front = row(y, z + 1);
+
+            int8_t* out_row = out + (size_t(z - z_begin) * size_t(h) + size_t(y)) * size_t(w) * GRADIENT_VOXEL_BYTES;
+            for (int x = 0; x < w; x++) {
+                const size_t i = size_t(x) + 1;
+                const float gx = 0.5f * (center[i + 1] - center[i - 1]);
+                const float gy = 0.5f * (above[i] - below[i]);
+                const float gz = 0.5f * (front[i] - back[i]);
+                const float length = std::sqrt(gx*gx + gy*gy + gz*gz);
+                const float rcp = length > 0.0f ? 1.0f / length : 0.0f;
+                int8_t* voxel = out_row + size_t(x) * GRADIENT_VOXEL_BYTES;
+                voxel[0] = to_snorm8(gx * rcp);
+                voxel[1] = to_snorm8(gy * rcp);
+                voxel[2] = to_snorm8(gz * rcp);
+                voxel[3] = to_snorm8(length);
+            }
+        }
+    }
+}
+}
+
+
+void compute_gradients(const VolumeSlab& slab, int w, int h, int d, int z_begin, int z_end,
+                       double min_value, double max_value, int8_t* out) {
+    const float lo = static_cast<float>(min_value);
+    const float scale = max_value > min_value ? static_cast<float>(1.0 / (max_value - min_value)) : 1.0f;
+    const size_t slice_bytes = size_t(w) * size_t(h) * GRADIENT_VOXEL_BYTES;
+
+    // Smaller tasks if there are too few slices to keep every thread busy
+    const size_t num_slices = size_t(std::max(z_end - z_begin, 0));
+    const size_t chunk_slices = std::max<size_t>(1, std::min(GRADIENT_CHUNK_SLICES, num_slices / default_num_threads()));
+    visit_samples(slab.format, slab.samples, [&](auto* samples) {
+        parallel_for_chunks(size_t(z_begin), size_t(z_end), chunk_slices, [&](size_t begin, size_t end) {
+            gradient_slices(samples, slab.z_begin, w, h, d, int(begin), int(end), lo, scale,
+                            out + (begin - size_t(z_begin)) * slice_bytes);
+        });
+    });
+}
@@ -0,0 +1,21 @@
+#ifndef VOLUME_GRADIENTS_H
+#define VOLUME_GRADIENTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "volume_bricks.h"
+
+
+// Precomputed gradients are stored as 4 signed bytes per voxel, the values scaled to [-127, 127]:
+// the normalized gradient in xyz and the gradient magnitude, clamped to 1, in w
+constexpr size_t GRADIENT_VOXEL_BYTES = 4;
+
+// Compute the gradients of slices [z_begin, z_end) of a volume of w*h*d voxels into out, x fastest.
+// The samples are stretched from [min_value, max_value] to [0, 1] as they are displayed and differentiated
+// with central differences, reading 0 outside of the volume like the shaders do through the texture border.
+// slab must hold the slices before z_begin and after z_end - 1 that are in the volume.
+void compute_gradients(const VolumeSlab& slab, int w, int h, int d, int z_begin, int z_end,
+                       double min_value, double max_value, int8_t* out);
+
+#endif // VOLUME_GRADIENTS_H
@@ -0,0 +1,182 @@
+#include "volume_statistics.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// Largest number of samples binned into one set of 32 bit counts before they are merged
+constexpr size_t MAX_SAMPLES_PER_MERGE = 1 << 30;
+
+// Samples are counted into this many interleaved copies of the histogram and summed afterwards,
+// so consecutive samples falling into the same bin don't wait on each other's increments
+constexpr size_t NUM_SUB_HISTOGRAMS = 4;
+
+// Written as a plain select so the compiler vectorizes it into packed min/max instructions
+template <typename T>
+void samples_min_max(const T* samples, size_t count, T& out_min, T& out_max) {
+    T lo = samples[0], hi = samples[0];
+    for (size_t i = 1; i < count; i++) {
+        lo = samples[i] < lo ? samples[i] : lo;
+        hi = samples[i] > hi ? samples[i] : hi;
+    }
+    out_min = lo;
+    out_max = hi;
+}
+
+template <typename T, typename BinFn>
+void samples_histogram(const T* samples, size_t count, size_t num_bins, const BinFn& bin, std::vector<uint32_t>& out) {
+    out.assign(NUM_SUB_HISTOGRAMS * num_bins, 0);
+    uint32_t* h0 = out.data();
+    uint32_t* h1 = h0 + num_bins;
+    uint32_t* h2 = h1 + num_bins;
+    uint32_t* h3 = h2 + num_bins;
+
+    size_t i = 0;
+    for (; i + NUM_SUB_HISTOGRAMS <= count; i += NUM_SUB_HISTOGRAMS) {
+        h0[bin(samples[i])]++;
+        h1[bin(samples[i + 1])]++;
+        h2[bin(samples[i + 2])]++;
+        h3[bin(samples[i + 3])]++;
+    }
+    for (; i < count; i++) {
+        h0[bin(samples[i])]++;
+    }
+
+    for (size_t b = 0; b < num_bins; b++) {
+        h0[b] += h1[b] + h2[b] + h3[b];
+    }
+    out.resize(num_bins);
+}
+
+// Bin of a floating point sample in a histogram of num_bins spanning [range_min, range_min + 1/scale]
+struct FloatBin {
+    float range_min;
+    float scale;
+    size_t last_bin;
+
+    size_t operator()(float v) const {
+        const float t = (v - range_min) * scale;
+        return t > 0.0f ? std::min(static_cast<size_t>(t), last_bin) : 0;
+    }
+};
+}
+
+
+double VolumeStatistics::percentile(double p) const {
+    if (histogram.empty() || num_voxels == 0) {
+        return min_value;
+    }
+
+    const double target = std::min(std::max(p, 0.0), 1.0) * double(num_voxels);
+    const double bin_width = (histogram_max - histogram_min) / double(histogram.size());
+    uint64_t below = 0;
+    for (size_t b = 0; b < histogram.size(); b++) {
+        if (histogram[b] > 0 && double(below + histogram[b]) >= target) {
+            // Interpolate within the bin
+            const double t = (target - double(below)) / double(histogram[b]);
+            const double value = histogram_min + (double(b) + t) * bin_width;
+            return std::min(std::max(value, min_value), max_value);
+        }
+        below += histogram[b];
+    }
+    return max_value;
+}
+
+
+VolumeStatisticsBuilder::VolumeStatisticsBuilder(VoxelFormat format) :
+    _format(format),
+    _num_bins(format == VoxelFormat::UINT8 ? 256 : VOLUME_HISTOGRAM_BINS),
+    _min_value(std::numeric_limits<float>::max()),
+    _max_value(std::numeric_limits<float>::lowest()),
+    _histogram(_num_bins, 0) {}
+
+void VolumeStatisticsBuilder::add(const uint8_t* samples, size_t count) {
+    const size_t voxel_size = voxel_format_size(_format);
+    std::vector<uint32_t> chunk_histogram;
+    for (size_t first = 0; first < count; first += MAX_SAMPLES_PER_MERGE) {
+        const size_t chunk_count = std::min(count - first, MAX_SAMPLES_PER_MERGE);
+        const uint8_t* chunk = samples + first * voxel_size;
+        float chunk_min = 0.0f, chunk_max = 0.0f;
+
+        switch (_format) {
+        case VoxelFormat::UINT8: {
+            const uint8_t* in = chunk;
+            uint8_t lo, hi;
+            samples_min_max(in, chunk_count, lo, hi);
+            samples_histogram(in, chunk_count, _num_bins, [](uint8_t v) { return size_t(v); }, chunk_histogram);
+            chunk_min = VoxelTraits<uint8_t>::normalize(lo);
+            chunk_max = VoxelTraits<uint8_t>::normalize(hi);
+            break;
+        }
+        case VoxelFormat::UINT16: {
+            const uint16_t* in = reinterpret_cast<const uint16_t*>(chunk);
+            uint16_t lo, hi;
+            samples_min_max(in, chunk_count, lo, hi);
+            // 65536 values into 4096 bins
+            samples_histogram(in, chunk_count, _num_bins, [](uint16_t v) { return size_t(v >> 4); }, chunk_histogram);
+            chunk_min = VoxelTraits<uint16_t>::normalize(lo);
+            chunk_max = VoxelTraits<uint16_t>::normalize(hi);
+            break;
+        }
+        case VoxelFormat::FLOAT32: {
+            const float* in = reinterpret_cast<const float*>(chunk);
+            samples_min_max(in, chunk_count, chunk_min, chunk_max);
+            chunk_histogram.clear();
+            break;
+        }
+        default:
+            return;
+        }
+
+        merge(chunk_min, chunk_max, chunk_count, chunk_histogram);
+    }
+}
+
+void VolumeStatisticsBuilder::add_to_histogram(const uint8_t* samples, size_t count) {
+    if (_format != VoxelFormat::FLOAT32) {
+        return;
+    }
+
+    const float* in = reinterpret_cast<const float*>(samples);
+    const float range = _max_value - _min_value;
+    const FloatBin bin = { _min_value, range > 0.0f ? float(_num_bins) / range : 0.0f, _num_bins - 1 };
+    std::vector<uint32_t> chunk_histogram;
+    for (size_t first = 0; first < count; first += MAX_SAMPLES_PER_MERGE) {
+        const size_t chunk_count = std::min(count - first, MAX_SAMPLES_PER_MERGE);
+        samples_histogram(in + first, chunk_count, _num_bins, bin, chunk_histogram);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t b = 0; b < _num_bins; b++) {
+            _histogram[b] += chunk_histogram[b];
+        }
+    }
+}
+
+void VolumeStatisticsBuilder::merge(float chunk_min, float chunk_max, size_t count,
+                                    const std::vector<uint32_t>& chunk_histogram) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _min_value = std::min(_min_value, chunk_min);
+    _max_value = std::max(_max_value, chunk_max);
+    _num_voxels += count;
+    for (size_t b = 0; b < chunk_histogram.size(); b++) {
+        _histogram[b] += chunk_histogram[b];
+    }
+}
+
+void VolumeStatisticsBuilder::finish(VolumeStatistics& out) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    out.format = _format;
+    out.num_voxels = _num_voxels;
+    out.min_value = _num_voxels > 0 ? _min_value : 0.0;
+    out.max_value = _num_voxels > 0 ? _max_value : 0.0;
+    if (_format == VoxelFormat::FLOAT32) {
+        out.histogram_min = out.min_value;
+        out.histogram_max = out.max_value;
+    } else {
+        // Bin b holds the integer values [b*k, (b+1)*k), the upper end is one value past the maximum
+        const double max_integer = _format == VoxelFormat::UINT8 ? 255.0 : 65535.0;
+        out.histogram_min = 0.0;
+        out.histogram_max = (max_integer + 1.0) / max_integer;
+    }
+    out.histogram = _histogram;
+}
@@ -0,0 +1,67 @@
+#ifndef VOLUME_STATISTICS_H
+#define VOLUME_STATISTICS_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "volume_data.h"
+
+
+// Number of histogram bins for 16 bit and floating point volumes. 8 bit volumes get one bin per value.
+constexpr size_t VOLUME_HISTOGRAM_BINS = 4096;
+
+
+// Value statistics of a volume. Values are normalized as by VoxelTraits<T>::normalize.
+struct VolumeStatistics {
+    VoxelFormat format = VoxelFormat::INVALID;
+    uint64_t num_voxels = 0;
+    double min_value = 0.0;
+    double max_value = 0.0;
+
+    // Histogram with uniform bins spanning [histogram_min, histogram_max]
+    double histogram_min = 0.0;
+    double histogram_max = 1.0;
+    std::vector<uint64_t> histogram;
+
+    void clear() { *this = VolumeStatistics(); }
+
+    // True if these statistics were gathered from a volume with the given format and size
+    bool valid_for(VoxelFormat format, size_t num_voxels) const {
+        return !histogram.empty() && this->format == format && this->num_voxels == num_voxels;
+    }
+
+    // Normalized value below which a fraction p of the samples lie, to the resolution of one bin
+    double percentile(double p) const;
+};
+
+
+// Gathers VolumeStatistics from chunks of samples, which may be added concurrently from several threads.
+// Integer samples are binned over their whole range in the same pass that finds the minimum and maximum.
+// Floating point samples have no fixed range, so once every chunk was added, if needs_histogram_pass()
+// is true every chunk must be passed to add_to_histogram() as well.
+class VolumeStatisticsBuilder {
+public:
+    explicit VolumeStatisticsBuilder(VoxelFormat format);
+
+    void add(const uint8_t* samples, size_t count);
+
+    bool needs_histogram_pass() const { return _format == VoxelFormat::FLOAT32; }
+    void add_to_histogram(const uint8_t* samples, size_t count);
+
+    void finish(VolumeStatistics& out);
+
+private:
+    void merge(float chunk_min, float chunk_max, size_t count, const std::vector<uint32_t>& chunk_histogram);
+
+    VoxelFormat _format;
+    size_t _num_bins;
+    std::mutex _mutex;
+    uint64_t _num_voxels = 0;
+    float _min_value;
+    float _max_value;
+    std::vector<uint64_t> _histogram;
+};
+
+#endif // VOLUME_STATISTICS_H
@@ -22,7 +22,7 @@ CompressedVolume::CompressedVolume(
 
 }
 
-void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar)> func)
+void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const
 {
 	const auto &ray = at(i, j);
 	for (size_t k = 0; k+1 < ray.size(); k+=2)
@@ -31,7 +31,7 @@ void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar)>
 	}
 }
 
-void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func)
+void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func) const
 {
 	const auto &ray = at(i, j);
 	for (size_t k = 0; k + 1 < ray.size(); k += 2)
@@ -40,7 +40,7 @@ void CompressedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar,
 	}
 }
 
-void CompressedVolume::copy_volume_from(const CompressedVolume voxel)
+void CompressedVolume::copy_volume_from(const CompressedVolume &voxel)
 {
 	m_Origin = voxel.origin();
 	m_Extent = voxel.extent();
@@ -58,7 +58,7 @@ void CompressedVolume::copy_volume_from(const CompressedVolume voxel)
 
 }
 
-double CompressedVolume::get_volume()
+double CompressedVolume::get_volume() const
 {
 	double vol = 0.f;
 	double dexel_size = m_Spacing;
@@ -73,7 +73,7 @@ double CompressedVolume::get_volume()
 	return vol;
 }
 
-int CompressedVolume::numSegments()
+int CompressedVolume::numSegments() const
 {
 	int num_segs=0;
 	for (int x = 0; x < m_GridSize(0); x++)
@@ -90,7 +90,10 @@ void CompressedVolume::appendSegment(int i, int j, Scalar begin_pt, Scalar end_p
 void CompressedVolume::reshape(int xsize, int ysize)
 {
 	m_GridSize << xsize, ysize;
-	m_Data.assign(xsize*ysize, {});
+	// Empty the dexels but keep their storage, so reusing a volume as an output doesn't reallocate them
+	m_Data.resize(xsize*ysize);
+	for (auto &ray : m_Data)
+		ray.clear();
 }
 
 void CompressedVolume::resize(int xsize, int ysize)
@@ -22,16 +22,16 @@ namespace voroffset3d
 		void save(std::ostream &out) const;
 		void load(std::istream &in);
 
-		void copy_volume_from(const CompressedVolume voxel);
-		double get_volume();
-		int numSegments();
+		void copy_volume_from(const CompressedVolume &voxel);
+		double get_volume() const;
+		int numSegments() const;
 		const std::vector<Scalar> & at(int x, int y) const { return m_Data[x + m_GridSize[0] * y]; }
 		std::vector<Scalar> & at(int x, int y) { return m_Data[x + m_GridSize[0] * y]; }
 
 
 		// Apply a function to each segment in the structure
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) override;
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func1) override;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const override;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func1) const override;
 
 		virtual void appendSegment(int i, int j, Scalar begin_pt, Scalar end_pt, Scalar radius) override;
 
@@ -26,8 +26,8 @@ namespace voroffset3d
 		//CompressedVolumeBase() {}
 
 		// Apply a function to each segment in the structure
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func) = 0;
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) = 0;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func) const = 0;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const = 0;
 
 		// Append a segment to the given segments vector
 		virtual void appendSegment(int i, int j, Scalar begin_pt, Scalar end_pt, Scalar radius) = 0;
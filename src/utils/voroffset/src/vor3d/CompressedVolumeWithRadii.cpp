@@ -21,23 +21,23 @@ CompressedVolumeWithRadii::CompressedVolumeWithRadii(
 	
 }
 // ----------------------------------------------------------------------------
-void CompressedVolumeWithRadii::iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func)
+void CompressedVolumeWithRadii::iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func) const
 {
 	auto &m_ray = at(i, j);
-	for (const SegmentWithRadius s : m_ray)
+	for (const SegmentWithRadius &s : m_ray)
 		func(s.y1, s.y2, s.r);
 
 }
 
-void CompressedVolumeWithRadii::iterate(int i, int j, std::function<void(Scalar, Scalar)> func)
+void CompressedVolumeWithRadii::iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const
 {
 	auto &m_ray = at(i, j);
-	for (const SegmentWithRadius s : m_ray)
+	for (const SegmentWithRadius &s : m_ray)
 		func(s.y1, s.y2);
 
 }
 
-void CompressedVolumeWithRadii::copy_volume_from(const CompressedVolumeWithRadii voxel)
+void CompressedVolumeWithRadii::copy_volume_from(const CompressedVolumeWithRadii &voxel)
 {
 	m_Origin = voxel.origin();
 	m_Extent = voxel.extent();
@@ -54,7 +54,7 @@ void CompressedVolumeWithRadii::copy_volume_from(const CompressedVolumeWithRadii
 
 }
 
-double CompressedVolumeWithRadii::get_volume()
+double CompressedVolumeWithRadii::get_volume() const
 {
 	double vol = 0.f;
 	double dexel_size = m_Spacing;
@@ -69,7 +69,7 @@ double CompressedVolumeWithRadii::get_volume()
 	return vol;
 }
 
-int CompressedVolumeWithRadii::numSegments()
+int CompressedVolumeWithRadii::numSegments() const
 {
 	int num_segs=0;
 	for (int x = 0; x < m_GridSize(0); x++)
@@ -88,7 +88,10 @@ void CompressedVolumeWithRadii::appendSegment(int i, int j, Scalar begin_pt, Sca
 void CompressedVolumeWithRadii::reshape(int xsize, int ysize)
 {
 	m_GridSize << xsize, ysize;
-	m_Data.assign(xsize*ysize, {});
+	// Empty the dexels but keep their storage, so reusing a volume as an output doesn't reallocate them
+	m_Data.resize(xsize*ysize);
+	for (auto &ray : m_Data)
+		ray.clear();
 }
 
 void CompressedVolumeWithRadii::resize(int xsize, int ysize)
@@ -18,16 +18,16 @@ namespace voroffset3d
 		CompressedVolumeWithRadii(Eigen::Vector3d origin, Eigen::Vector3d extent, double voxel_size, int padding);
 		CompressedVolumeWithRadii() = default;
 
-		void copy_volume_from(const CompressedVolumeWithRadii voxel);
-		double get_volume();
-		int numSegments();
+		void copy_volume_from(const CompressedVolumeWithRadii &voxel);
+		double get_volume() const;
+		int numSegments() const;
 		const std::vector<SegmentWithRadius> & at(int x, int y) const { return m_Data[x + m_GridSize[0] * y]; }
 		std::vector<SegmentWithRadius> & at(int x, int y) { return m_Data[x + m_GridSize[0] * y]; }
 
 		// Apply a function to each segment in the structure
 		//void iterate(std::function<void(int, int, Scalar, Scalar)> func) const;
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) override;
-		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func1) override;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const override;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func1) const override;
 
 		virtual void appendSegment(int i, int j, Scalar begin_pt, Scalar end_pt, Scalar radius) override;
 
@@ -6,7 +6,7 @@ namespace voroffset3d
 	void halfDilate(
 		Morpho2D &vor,
 		bool is_apply_power_alg,
-		CompressedVolumeBase &input,
+		const CompressedVolumeBase &input,
 		CompressedVolumeBase &output,
 		int x0, int y0, int deltaX, int deltaY)
 	{
@@ -21,12 +21,12 @@ namespace voroffset3d
 	void halfDilate(
 		Morpho2D &vor,
 		bool is_apply_power_alg,
-		CompressedVolumeBase &input,
+		const CompressedVolumeBase &input,
 		CompressedVolumeBase &output,
 		int x0, int y0, int deltaX, int deltaY);
 
 	template<typename CompressedVolumeType>
-	void unionMap(CompressedVolumeType voxel_1, CompressedVolumeType voxel_2, CompressedVolumeType &result);
+	void unionMap(const CompressedVolumeType &voxel_1, const CompressedVolumeType &voxel_2, CompressedVolumeType &result);
 }
 
 #include "vor3d/HalfDilationOperator.hpp"
\ No newline at end of file
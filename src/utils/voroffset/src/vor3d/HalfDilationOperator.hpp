@@ -3,7 +3,7 @@
 namespace voroffset3d
 {
 	template<typename CompressedVolumeType>
-	void unionMap(CompressedVolumeType voxel_1, CompressedVolumeType voxel_2, CompressedVolumeType &result)
+	void unionMap(const CompressedVolumeType &voxel_1, const CompressedVolumeType &voxel_2, CompressedVolumeType &result)
 	{
 		int x_size = voxel_1.gridSize()(0);
 		int y_size = voxel_1.gridSize()(1);
@@ -258,7 +258,7 @@ namespace voroffset3d
 		}
 	}
 
-	void negate_ray(std::vector<SegmentWithRadius> input, std::vector<SegmentWithRadius> &result, double y_min, double y_max)
+	void negate_ray(const std::vector<SegmentWithRadius> &input, std::vector<SegmentWithRadius> &result, double y_min, double y_max)
 	{
 		size_t size_ = input.size();
 		result.clear();
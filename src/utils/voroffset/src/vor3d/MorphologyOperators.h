@@ -29,7 +29,7 @@ namespace voroffset3d
 
 	// negate ray which is occluded by [y_min, y_max]
 	void negate_ray(std::vector<double> &result, double y_min, double y_max);
-	void negate_ray(std::vector<SegmentWithRadius> input, std::vector<SegmentWithRadius> &result, double y_min, double y_max);
+	void negate_ray(const std::vector<SegmentWithRadius> &input, std::vector<SegmentWithRadius> &result, double y_min, double y_max);
 
 	// negate ray based on the range [y_min, y_max], i.e. delete the segments which don't overlap with [y_min, y_max]
 	// as well as negate the segments which are occluded by [y_min, y_max]
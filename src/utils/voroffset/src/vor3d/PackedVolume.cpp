@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+#include "vor3d/PackedVolume.h"
+#include <algorithm>
+#include <limits>
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace voroffset3d;
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PackedVolume::finalize(const CompressedVolume &volume)
+{
+	m_Origin = volume.origin();
+	m_Extent = volume.extent();
+	m_Spacing = volume.spacing();
+	m_Padding = volume.padding();
+	m_GridSize = volume.gridSize();
+
+	// Size everything first so the endpoints are allocated once
+	const int num_dexels = numDexels();
+	m_Offsets.resize(num_dexels + 1);
+	size_t num_endpoints = 0;
+	for (int i = 0; i < num_dexels; i++)
+	{
+		m_Offsets[i] = uint32_t(num_endpoints);
+		num_endpoints += volume.at(i % m_GridSize[0], i / m_GridSize[0]).size();
+	}
+	vor_assert(num_endpoints <= std::numeric_limits<uint32_t>::max());
+	m_Offsets[num_dexels] = uint32_t(num_endpoints);
+
+	m_Endpoints.resize(num_endpoints);
+	for (int i = 0; i < num_dexels; i++)
+	{
+		const std::vector<Scalar> &ray = volume.at(i % m_GridSize[0], i / m_GridSize[0]);
+		std::copy(ray.begin(), ray.end(), m_Endpoints.begin() + m_Offsets[i]);
+	}
+	updateAppendDexel();
+}
+
+void PackedVolume::unpack(CompressedVolume &volume) const
+{
+	volume.reset(m_Origin, m_Extent, m_Spacing, m_Padding, m_GridSize[0], m_GridSize[1]);
+	for (int y = 0; y < m_GridSize[1]; y++)
+		for (int x = 0; x < m_GridSize[0]; x++)
+		{
+			const DexelSpan ray = at(x, y);
+			volume.at(x, y).assign(ray.begin(), ray.end());
+		}
+}
+
+double PackedVolume::get_volume() const
+{
+	double length = 0;
+	for (size_t k = 0; k + 1 < m_Endpoints.size(); k += 2)
+		length += double(m_Endpoints[k + 1]) - double(m_Endpoints[k]);
+	return m_Spacing * m_Spacing * m_Spacing * length;
+}
+
+void PackedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const
+{
+	const DexelSpan ray = at(i, j);
+	for (size_t k = 0; k + 1 < ray.size(); k += 2)
+	{
+		func(ray[k], ray[k + 1]);
+	}
+}
+
+void PackedVolume::iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func) const
+{
+	const DexelSpan ray = at(i, j);
+	for (size_t k = 0; k + 1 < ray.size(); k += 2)
+	{
+		func(ray[k], ray[k + 1], 0.f);
+	}
+}
+
+void PackedVolume::appendSegment(int i, int j, Scalar begin_pt, Scalar end_pt, Scalar radius)
+{
+	vor_assert(i >= 0 && i < m_GridSize[0] && j >= 0 && j < m_GridSize[1]);
+	const int dexel = i + m_GridSize[0] * j;
+	vor_assert_msg(dexel >= m_AppendDexel,
+		"PackedVolume segments must be appended in dexel order, build the volume with finalize() instead");
+
+	// The endpoints of this dexel are the last ones, merge the segment into them like vor3d::appendSegment().
+	// Radii aren't stored, like in CompressedVolume.
+	const size_t dexel_begin = m_Offsets[dexel];
+	PackedScalar a = PackedScalar(begin_pt), b = PackedScalar(end_pt);
+	while (m_Endpoints.size() > dexel_begin && m_Endpoints.rbegin()[1] >= a)
+	{
+		b = std::max(b, m_Endpoints.back());
+		m_Endpoints.resize(m_Endpoints.size() - 2);
+	}
+	if (m_Endpoints.size() == dexel_begin || m_Endpoints.back() < a)
+	{
+		m_Endpoints.push_back(a);
+		m_Endpoints.push_back(b);
+	}
+	else if (m_Endpoints.back() < b)
+	{
+		m_Endpoints.back() = b;
+	}
+
+	// Every dexel after this one now starts after its endpoints
+	vor_assert(m_Endpoints.size() <= std::numeric_limits<uint32_t>::max());
+	std::fill(m_Offsets.begin() + dexel + 1, m_Offsets.end(), uint32_t(m_Endpoints.size()));
+	m_AppendDexel = dexel;
+}
+
+void PackedVolume::updateAppendDexel()
+{
+	// Offsets don't decrease, the dexels from the first one starting at the end are empty
+	const auto first_empty = std::lower_bound(m_Offsets.begin(), m_Offsets.end(), m_Offsets.back());
+	m_AppendDexel = std::max(int(first_empty - m_Offsets.begin()) - 1, 0);
+}
+
+void PackedVolume::reshape(int xsize, int ysize)
+{
+	m_GridSize << xsize, ysize;
+	m_Offsets.assign(xsize*ysize + 1, 0);
+	m_Endpoints.clear();
+	m_AppendDexel = 0;
+}
+
+void PackedVolume::resize(int xsize, int ysize)
+{
+	m_GridSize << xsize, ysize;
+	const uint32_t end = m_Offsets.empty() ? 0 : m_Offsets.back();
+	if (m_Offsets.empty())
+		m_Offsets.push_back(0);
+	m_Offsets.resize(xsize*ysize + 1, end);
+	m_Endpoints.resize(m_Offsets.back());
+	updateAppendDexel();
+}
+
+void PackedVolume::clear()
+{
+	std::fill(m_Offsets.begin(), m_Offsets.end(), 0);
+	m_Endpoints.clear();
+	m_AppendDexel = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+#include "vor3d/CompressedVolumeBase.h"
+#include "vor3d/CompressedVolume.h"
+#include <cstdint>
+////////////////////////////////////////////////////////////////////////////////
+
+namespace voroffset3d
+{
+	// Endpoints of a PackedVolume, single precision is plenty for coordinates in voxels
+	typedef float PackedScalar;
+
+	// Read-only view of the endpoints of one dexel of a PackedVolume, two per segment
+	class DexelSpan
+	{
+	private:
+		const PackedScalar *m_Begin;
+		const PackedScalar *m_End;
+
+	public:
+		DexelSpan(const PackedScalar *begin, const PackedScalar *end) : m_Begin(begin), m_End(end) {}
+
+		const PackedScalar * begin() const { return m_Begin; }
+		const PackedScalar * end() const { return m_End; }
+		size_t size() const { return size_t(m_End - m_Begin); }
+		bool empty() const { return m_Begin == m_End; }
+		PackedScalar operator[](size_t i) const { return m_Begin[i]; }
+	};
+
+	// A CompressedVolume with the endpoints of all of its dexels in one contiguous array, the dexels
+	// delimited by an array of offsets (like the rows of a CSR matrix). A sweep over it reads memory
+	// in order instead of chasing one heap allocation per dexel.
+	//
+	// It is built from a complete CompressedVolume with finalize(). appendSegment() can only add segments
+	// to the last dexel that has any or to a dexel after it (x fastest, then y), and moves the offsets of
+	// every dexel after that one, so it is only meant for small additions. reshape() and clear() empty
+	// every dexel and resize() keeps the dexels that are still in the grid by index, like
+	// CompressedVolume::resize().
+	class PackedVolume : public CompressedVolumeBase
+	{
+	private:
+		// m_Offsets[i] is where dexel i starts in m_Endpoints, with one more entry for the end of the last one
+		std::vector<uint32_t> m_Offsets;
+		std::vector<PackedScalar> m_Endpoints;
+
+		// First dexel appendSegment() accepts, the last one with any endpoints
+		int m_AppendDexel = 0;
+
+		void updateAppendDexel();
+
+	public:
+		// Interface
+		PackedVolume() = default;
+		explicit PackedVolume(const CompressedVolume &volume) { finalize(volume); }
+
+		// Copy the grid and the segments of volume, replacing the current contents
+		void finalize(const CompressedVolume &volume);
+
+		// Copy back into the one vector per dexel layout
+		void unpack(CompressedVolume &volume) const;
+
+		double get_volume() const;
+		int numSegments() const { return int(m_Endpoints.size() / 2); }
+		DexelSpan at(int x, int y) const
+		{
+			const size_t i = size_t(x) + size_t(m_GridSize[0]) * size_t(y);
+			return DexelSpan(m_Endpoints.data() + m_Offsets[i], m_Endpoints.data() + m_Offsets[i + 1]);
+		}
+
+		// Apply a function to each segment in the structure
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar)> func) const override;
+		virtual void iterate(int i, int j, std::function<void(Scalar, Scalar, Scalar)> func1) const override;
+
+		virtual void appendSegment(int i, int j, Scalar begin_pt, Scalar end_pt, Scalar radius) override;
+
+		virtual void reshape(int xsize, int ysize) override;
+		virtual void resize(int xsize, int ysize) override;
+		virtual void clear() override;
+	};
+
+} // namespace voroffset3d
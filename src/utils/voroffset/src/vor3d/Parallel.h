@@ -0,0 +1,86 @@
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+#ifdef USE_TBB
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
+#endif
+////////////////////////////////////////////////////////////////////////////////
+#ifndef GRAIN_SIZE
+#define GRAIN_SIZE 10
+#endif
+
+namespace voroffset3d
+{
+	// How the sweeps of a morphology operator are split across threads
+	struct ParallelOptions
+	{
+		// Number of worker threads, 0 for one per core and 1 to run serially
+		int num_threads = 0;
+
+		// Number of consecutive sweep lines a worker takes at a time
+		int grain_size = GRAIN_SIZE;
+	};
+
+	/**
+	* @brief      Call func(begin, end) on chunks of [begin, end), in parallel as requested by options.
+	*             Uses TBB when the library is built with USE_TBB and a pool of std::threads otherwise.
+	*             Returns once every chunk is done.
+	*
+	* @param[in]  begin, end	{ Range of sweep lines. }
+	* @param[in]  options		{ Thread count and grain size. }
+	* @param[in]  func			{ Called with the bounds of each chunk, possibly concurrently. }
+	**/
+	template<typename Func>
+	void parallelFor(int begin, int end, const ParallelOptions &options, const Func &func)
+	{
+		if (end <= begin)
+			return;
+		const int grain = std::max(options.grain_size, 1);
+		int num_threads = options.num_threads;
+		if (num_threads <= 0)
+			num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+		if (num_threads == 1)
+		{
+			func(begin, end);
+			return;
+		}
+
+#ifdef USE_TBB
+		tbb::task_arena arena(num_threads);
+		arena.execute([&]()
+		{
+			tbb::parallel_for(tbb::blocked_range<int>(begin, end, grain), [&](const tbb::blocked_range<int> &range)
+			{
+				func(range.begin(), range.end());
+			});
+		});
+#else
+		const int num_chunks = (end - begin + grain - 1) / grain;
+		num_threads = std::min(num_threads, num_chunks);
+		std::atomic<int> next_chunk(0);
+		auto worker = [&]()
+		{
+			for (int c = next_chunk++; c < num_chunks; c = next_chunk++)
+			{
+				const int chunk_begin = begin + c * grain;
+				func(chunk_begin, std::min(end, chunk_begin + grain));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(num_threads - 1);
+		for (int i = 1; i < num_threads; ++i)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread &t : threads)
+			t.join();
+#endif
+	}
+}
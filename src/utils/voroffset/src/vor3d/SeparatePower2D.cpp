@@ -160,7 +160,7 @@ double SeparatePowerMorpho2D::rayIntersect(PointWithRadiusX p, PointWithRadiusX
 // -----------------------------------------------------------------------------
 
 // Assumes that it != m_S.end()
-void SeparatePowerMorpho2D::exploreLeft(P_const_iter it, PointWithRadiusX p, int i)
+SeparatePowerMorpho2D::P_const_iter SeparatePowerMorpho2D::exploreLeft(P_const_iter it, PointWithRadiusX p, int i)
 {
 	while (it != m_P.begin())
 	{
@@ -179,9 +179,10 @@ void SeparatePowerMorpho2D::exploreLeft(P_const_iter it, PointWithRadiusX p, int
 					m_Q_P[x_sup].push_back(*it);
 				}
 			}
-			return;
+			return std::next(it);
 		}
 	}
+	return std::next(it);
 }
 
 // Assumes that it != m_S.end()
@@ -235,7 +236,7 @@ void SeparatePowerMorpho2D::insertPoint(PointWithRadiusX p)
 	}
 	while (it != m_P.begin() && p.contains(*std::prev(it)))
 	{
-		m_P.erase(std::prev(it));
+		it = m_P.erase(std::prev(it));
 	}
 	P_const_iter jt = m_P.insert(it, p);
 	int xsup = (int)std::floor(p.x + p.r) + 1;
@@ -284,7 +285,7 @@ void SeparatePowerMorpho2D::removeInactivePoints(int i)
 			it = m_P.erase(it);
 			if (it != m_P.begin() && it != m_P.end())
 			{
-				exploreLeft(std::prev(it), *it, i);
+				it = exploreLeft(std::prev(it), *it, i);
 				exploreRight(it, *std::prev(it), i);
 			}
 		}
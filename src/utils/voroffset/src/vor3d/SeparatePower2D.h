@@ -3,6 +3,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "vor3d/Common.h"
 #include "vor3d/Morpho2D.h"
+#include "vor3d/SweepSet.h"
 #include <iostream>
 #include <vector>
 #include <array>
@@ -30,7 +31,9 @@ namespace voroffset3d
 		std::vector<SegmentWithRadiusX> m_S;
 		std::vector<SegmentWithRadiusX> m_S_New;
 		std::vector<SegmentWithRadiusX> m_S_Tmp;
-		std::set<PointWithRadiusX> m_P;
+		// Nodes of m_P, so the sweep doesn't go to the heap for every seed
+		NodePool m_Pool;
+		SweepSet<PointWithRadiusX> m_P = makeSweepSet<PointWithRadiusX>(m_Pool);
 		std::vector<PointWithRadiusX> m_P_Tmp;
 
 		// Candidate Voronoi vertices sorted by ascending x
@@ -38,7 +41,7 @@ namespace voroffset3d
 
 		// Typedefs
 		typedef std::vector<SegmentWithRadiusX>::const_iterator S_const_iter;
-		typedef std::set<PointWithRadiusX>::const_iterator P_const_iter;
+		typedef SweepSet<PointWithRadiusX>::const_iterator P_const_iter;
 
 		/////////////
 		// Methods //
@@ -47,8 +50,8 @@ namespace voroffset3d
 		// Assumes that y_p < y_q < y_r
 		double rayIntersect(PointWithRadiusX p, PointWithRadiusX q, PointWithRadiusX r) const;
 
-		// Assumes that it != m_S.end()
-		void exploreLeft(P_const_iter it, PointWithRadiusX p, int i);
+		// Assumes that it != m_S.end(), returns the iterator to the point after the ones explored
+		P_const_iter exploreLeft(P_const_iter it, PointWithRadiusX p, int i);
 
 		// Assumes that it != m_S.end()
 		void exploreRight(P_const_iter it, PointWithRadiusX p, int i);
@@ -0,0 +1,195 @@
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <set>
+#include <utility>
+#include <vector>
+////////////////////////////////////////////////////////////////////////////////
+// Container holding the seeds of the sweep line of the 2D morphology operators:
+//   0: std::set with the default allocator
+//   1: std::set with its nodes allocated from a NodePool owned by the operator
+//   2: FlatSet, a sorted vector
+#ifndef VOR3D_SWEEP_SET
+#define VOR3D_SWEEP_SET 2
+#endif
+
+namespace voroffset3d
+{
+	// Monotonic arena of fixed size nodes. Freed nodes go on a free list and are handed out again,
+	// the memory itself is only released when the pool is destroyed. Not thread-safe: each 2D operator
+	// owns one and an operator is only used by one thread at a time.
+	class NodePool
+	{
+	private:
+		// Nodes per block, the first block is allocated on the first allocation
+		static const size_t BLOCK_NODES = 1024;
+
+		struct FreeNode { FreeNode *next; };
+
+		size_t m_NodeSize = 0;
+		FreeNode *m_FreeList = nullptr;
+		std::vector<std::unique_ptr<char[]>> m_Blocks;
+		size_t m_BlockUsed = BLOCK_NODES;
+
+	public:
+		NodePool() = default;
+		NodePool(const NodePool &) = delete;
+		NodePool & operator=(const NodePool &) = delete;
+
+		// Size of the nodes of this pool, set by the first allocation
+		size_t nodeSize() const { return m_NodeSize; }
+
+		void * allocate(size_t size)
+		{
+			if (m_NodeSize == 0)
+			{
+				// Round up so every node in a block is aligned like the block
+				const size_t align = alignof(std::max_align_t);
+				m_NodeSize = (std::max(size, sizeof(FreeNode)) + align - 1) / align * align;
+			}
+			if (m_FreeList != nullptr)
+			{
+				FreeNode *node = m_FreeList;
+				m_FreeList = node->next;
+				return node;
+			}
+			if (m_BlockUsed == BLOCK_NODES)
+			{
+				m_Blocks.emplace_back(new char[BLOCK_NODES * m_NodeSize]);
+				m_BlockUsed = 0;
+			}
+			return m_Blocks.back().get() + m_NodeSize * m_BlockUsed++;
+		}
+
+		void deallocate(void *p)
+		{
+			FreeNode *node = static_cast<FreeNode *>(p);
+			node->next = m_FreeList;
+			m_FreeList = node;
+		}
+	};
+
+	// Allocator taking single objects of the pool's node size from a NodePool and everything else from the heap,
+	// so a node based container using it allocates its nodes from the pool
+	template<typename T>
+	class PoolAllocator
+	{
+	public:
+		typedef T value_type;
+
+		NodePool *m_Pool;
+
+		explicit PoolAllocator(NodePool *pool) : m_Pool(pool) {}
+		template<typename U>
+		PoolAllocator(const PoolAllocator<U> &other) : m_Pool(other.m_Pool) {}
+
+		T * allocate(size_t n)
+		{
+			if (usesPool(n))
+				return static_cast<T *>(m_Pool->allocate(sizeof(T)));
+			return static_cast<T *>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T *p, size_t n)
+		{
+			if (usesPool(n))
+				m_Pool->deallocate(p);
+			else
+				::operator delete(p);
+		}
+
+		template<typename U>
+		bool operator==(const PoolAllocator<U> &other) const { return m_Pool == other.m_Pool; }
+		template<typename U>
+		bool operator!=(const PoolAllocator<U> &other) const { return m_Pool != other.m_Pool; }
+
+	private:
+		bool usesPool(size_t n) const
+		{
+			return n == 1 && (m_Pool->nodeSize() == 0 || sizeof(T) <= m_Pool->nodeSize());
+		}
+	};
+
+	// Sorted vector with the part of the std::set interface the sweeps use. Inserting and erasing
+	// invalidates the iterators after the position they happen at, unlike std::set.
+	template<typename T, typename Compare = std::less<T>>
+	class FlatSet
+	{
+	private:
+		std::vector<T> m_Data;
+		Compare m_Less;
+
+	public:
+		typedef typename std::vector<T>::const_iterator const_iterator;
+		typedef const_iterator iterator;
+
+		const_iterator begin() const { return m_Data.begin(); }
+		const_iterator end() const { return m_Data.end(); }
+		size_t size() const { return m_Data.size(); }
+		bool empty() const { return m_Data.empty(); }
+		void clear() { m_Data.clear(); }
+
+		const_iterator lower_bound(const T &value) const
+		{
+			return std::lower_bound(m_Data.begin(), m_Data.end(), value, m_Less);
+		}
+
+		const_iterator find(const T &value) const
+		{
+			const_iterator it = lower_bound(value);
+			return (it != end() && !m_Less(value, *it)) ? it : end();
+		}
+
+		std::pair<const_iterator, bool> insert(const T &value)
+		{
+			return insertAt(lower_bound(value), value);
+		}
+
+		// The hint is used if value goes right before it, like std::set
+		const_iterator insert(const_iterator hint, const T &value)
+		{
+			const bool after_prev = hint == begin() || m_Less(*std::prev(hint), value);
+			const bool before_hint = hint == end() || !m_Less(*hint, value);
+			return insertAt(after_prev && before_hint ? hint : lower_bound(value), value).first;
+		}
+
+		const_iterator erase(const_iterator it) { return m_Data.erase(it); }
+
+	private:
+		// pos is the lower bound of value
+		std::pair<const_iterator, bool> insertAt(const_iterator pos, const T &value)
+		{
+			if (pos != end() && !m_Less(value, *pos))
+				return std::make_pair(pos, false);
+			return std::make_pair(const_iterator(m_Data.insert(pos, value)), true);
+		}
+	};
+
+	// The container selected by VOR3D_SWEEP_SET and the arguments to construct it with
+#if VOR3D_SWEEP_SET == 2
+	template<typename T>
+	using SweepSet = FlatSet<T>;
+	template<typename T>
+	inline SweepSet<T> makeSweepSet(NodePool &) { return SweepSet<T>(); }
+#elif VOR3D_SWEEP_SET == 1
+	template<typename T>
+	using SweepSet = std::set<T, std::less<T>, PoolAllocator<T>>;
+	template<typename T>
+	inline SweepSet<T> makeSweepSet(NodePool &pool) { return SweepSet<T>(std::less<T>(), PoolAllocator<T>(&pool)); }
+#else
+	template<typename T>
+	using SweepSet = std::set<T>;
+	template<typename T>
+	inline SweepSet<T> makeSweepSet(NodePool &) { return SweepSet<T>(); }
+#endif
+
+	inline const char * sweepSetName()
+	{
+		return VOR3D_SWEEP_SET == 2 ? "flat" : VOR3D_SWEEP_SET == 1 ? "pooled" : "std::set";
+	}
+}
@@ -1,11 +1,20 @@
 #include"vor3d/Voronoi.h"
 #include"vor3d/MorphologyOperators.h"
+#include <utility>
 using namespace voroffset3d;
 
 #ifndef MY_TYPE_EPS
 #define MY_TYPE_EPS 1e-10
 #endif
-void VoronoiMorpho::erosion(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+void VoronoiMorpho::erosion(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+{
+	// The input is negated before it is dilated, so it has to be copied once
+	CompressedVolume negated;
+	negated.copy_volume_from(input);
+	erosion(std::move(negated), result, radius, time_1, time_2);
+}
+
+void VoronoiMorpho::erosion(CompressedVolume &&input, CompressedVolume &result, double radius, double &time_1, double &time_2)
 {
 	double z_min = input.origin()(2) / input.spacing() - 1;
 	double z_max = input.origin()(2) / input.spacing() + 2 * input.padding() + input.extent()(2) / input.spacing() + 1;
@@ -88,7 +97,7 @@ void VoronoiMorpho::negateInv(CompressedVolume &result, double z_min, double z_m
 		}
 }
 
-double VoronoiMorpho::calculateXor(CompressedVolume voxel_1, CompressedVolume voxel_2, CompressedVolume &result)
+double VoronoiMorpho::calculateXor(const CompressedVolume &voxel_1, const CompressedVolume &voxel_2, CompressedVolume &result)
 /**
 * @brief      calculate the xor between two voxels, with the assumption that these two voxels have the same gridesize
 *
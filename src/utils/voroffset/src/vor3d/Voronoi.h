@@ -15,7 +15,7 @@ namespace voroffset3d
 
 	public:
 		virtual ~VoronoiMorpho() = default;
-		virtual void dilation(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2) = 0;
+		virtual void dilation(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2) = 0;
 		/**
 		* @brief      dilate the input with given radius
 		*
@@ -26,8 +26,10 @@ namespace voroffset3d
 		* @param[in]  time_2		{ time cost by second pass}
 		* 
 		**/
-		virtual void erosion(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2);
-		double calculateXor(CompressedVolume voxel_1, CompressedVolume voxel_2, CompressedVolume &result);
+		virtual void erosion(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2);
+		// Same as above, negating input in place instead of a copy of it
+		void erosion(CompressedVolume &&input, CompressedVolume &result, double radius, double &time_1, double &time_2);
+		double calculateXor(const CompressedVolume &voxel_1, const CompressedVolume &voxel_2, CompressedVolume &result);
 		/**
 		* @brief      calculate the xor between two voxels, with the assumption that these two voxels have the same gridesize
 		*
@@ -536,7 +536,7 @@ double VoronoiMorpho2D::treatSegments(Segment lp, Segment ab, Segment qr) const
 // -----------------------------------------------------------------------------
 
 // Assumes that it != m_S.end()
-void VoronoiMorpho2D::exploreLeft(S_const_iter it, Segment qr, int i)
+VoronoiMorpho2D::S_const_iter VoronoiMorpho2D::exploreLeft(S_const_iter it, Segment qr, int i)
 {
 	while (it != m_S.begin())
 	{
@@ -555,9 +555,10 @@ void VoronoiMorpho2D::exploreLeft(S_const_iter it, Segment qr, int i)
 					m_Q[x_sup].push_back(*it);
 				}
 			}
-			return;
+			return std::next(it);
 		}
 	}
+	return std::next(it);
 }
 
 // Assumes that it != m_S.end()
@@ -600,7 +601,7 @@ void VoronoiMorpho2D::insertSegment(int i, double j1, double j2, double r)
 	}
 	while (it != m_S.begin() && s.contains(*std::prev(it)))
 	{
-		m_S.erase(std::prev(it));
+		it = m_S.erase(std::prev(it));
 	}
 	// 2nd step: See if we have to split the neighboring segments on the right
 	if (it != m_S.end())
@@ -639,21 +640,22 @@ void VoronoiMorpho2D::insertSegment(int i, double j1, double j2, double r)
 				m_new_segs.push_back(lp);
 			}
 			Segment ab(jt->x, jt->y1, s.y1);
-			jt = m_S.erase(jt);
+			it = m_S.erase(jt);
 			//m_S.insert(jt, ab);
 			//if (xsup < m_XMax) { m_Q[xsup].push_back(ab); }
 			m_new_segs.push_back(ab);
 		}
 	}
+	// Inserting may invalidate it with a flat set, the new segment is placed with a lookup instead
 	for (int k = 0; k < m_new_segs.size(); k++)
 	{
-		m_S.insert(it, m_new_segs[k]);
+		m_S.insert(m_new_segs[k]);
 		int xsup = (int)std::floor(m_new_segs[k].x + m_Radius) + 1;
 		if (xsup < m_XMax) { m_Q[xsup].push_back(m_new_segs[k]); }
 	}
 	// 3rd step: Insert the new segment in the list of seeds
 	//it = m_S.lower_bound(s);
-	S_const_iter jt = m_S.insert(it, s);
+	S_const_iter jt = m_S.insert(s).first;
 	it = std::next(jt);
 	int xsup = (int)std::floor(s.x + m_Radius)+1;
 	if (xsup < m_XMax) { m_Q[xsup].push_back(s); }
@@ -683,7 +685,7 @@ void VoronoiMorpho2D::removeInactiveSegments(int i)
 			it = m_S.erase(it);
 			if (it != m_S.begin() && it != m_S.end())
 			{
-				exploreLeft(std::prev(it), *it, i);
+				it = exploreLeft(std::prev(it), *it, i);
 				exploreRight(it, *std::prev(it), i);
 			}
 		}
@@ -3,6 +3,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "vor3d/Common.h"
 #include "vor3d/Morpho2D.h"
+#include "vor3d/SweepSet.h"
 #include <iostream>
 #include <vector>
 #include <array>
@@ -33,14 +34,17 @@ namespace voroffset3d
 		double m_YMax, m_YMin;
 		double m_Radius;
 		double m_DexelSize;
+		// Nodes of m_S, so the sweep doesn't go to the heap for every seed
+		NodePool m_Pool;
+
 		// Seeds above sorted by ascending y of their midpoint
-		std::set<Segment> m_S;
+		SweepSet<Segment> m_S = makeSweepSet<Segment>(m_Pool);
 
 		// Candidate Voronoi vertices sorted by ascending x
 		std::vector<std::vector<Segment> > m_Q;
 
 		// Typedefs
-		typedef std::set<Segment>::const_iterator S_const_iter;
+		typedef SweepSet<Segment>::const_iterator S_const_iter;
 
 		/////////////
 		// Methods //
@@ -52,8 +56,8 @@ namespace voroffset3d
 		// Assumes that y_lp < y_ab < y_qr
 		double treatSegments(Segment lp, Segment ab, Segment qr) const;
 
-		// Assumes that it != m_S.end()
-		void exploreLeft(S_const_iter it, Segment qr, int i);
+		// Assumes that it != m_S.end(), returns the iterator to the seed after the ones explored
+		S_const_iter exploreLeft(S_const_iter it, Segment qr, int i);
 
 		// Assumes that it != m_S.end()
 		void exploreRight(S_const_iter it, Segment lp, int i);
@@ -13,7 +13,7 @@
 using namespace voroffset3d;
 
 
-void VoronoiMorphoBruteForce::dilation(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+void VoronoiMorphoBruteForce::dilation(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2)
 {
 	int x_size = input.gridSize()(0);
 	int y_size = input.gridSize()(1);
@@ -68,7 +68,7 @@ void VoronoiMorphoBruteForce::dilation(CompressedVolume input, CompressedVolume
 }
 
 
-void VoronoiMorphoBruteForce::unionMap(std::vector<MyPoint> vec, std::vector<double> &result)
+void VoronoiMorphoBruteForce::unionMap(std::vector<MyPoint> &vec, std::vector<double> &result)
 {
 	result.clear();
 	size_t inter_num = vec.size();
@@ -6,29 +6,29 @@
 #include "vor3d/MorphologyOperators.h"
 #include "vor3d/HalfDilationOperator.h"
 #include "vor3d/Timer.h"
-////////////////////////////////////////////////////////////////////////////////
-#ifdef USE_TBB
-#include "tbb/blocked_range.h"
-#include "tbb/parallel_for.h"
-#include "tbb/task_scheduler_init.h"
-////////////////////////////////////////////////////////////////////////////////
-#ifndef GRAIN_SIZE
-#define GRAIN_SIZE 10
-#endif
-#endif
-
 ////////////////////////////////////////////////////////////////////////////////
 
 using namespace voroffset3d;
 
-void VoronoiMorphoVorPower::dilation(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+void VoronoiMorphoVorPower::dilation(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+{
+	dilate(input, result, radius, time_1, time_2);
+}
+
+void VoronoiMorphoVorPower::dilation(const PackedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2)
+{
+	dilate(input, result, radius, time_1, time_2);
+}
+
+void VoronoiMorphoVorPower::dilate(const CompressedVolumeBase &input, CompressedVolume &result, double radius, double &time_1, double &time_2)
 {
 	int xsize = input.gridSize()(0);
 	int ysize = input.gridSize()(1);
 	m_zmin = input.origin()(2) / input.spacing();
 	m_zmax = input.origin()(2) / input.spacing() + 2 * input.padding() + input.extent()(2) / input.spacing();
-	CompressedVolumeWithRadii output1, output2, mid_output;
-	CompressedVolume output3, output4;
+	// The sweeps' outputs are kept between calls, so dilating again reuses their dexels' storage
+	CompressedVolumeWithRadii &output1 = m_output1, &output2 = m_output2, &mid_output = m_midOutput;
+	CompressedVolume &output3 = m_output3, &output4 = m_output4;
 	output1.reshape(xsize, ysize);
 	output2.reshape(xsize, ysize);
 	output3.reshape(xsize, ysize);
@@ -38,58 +38,34 @@ void VoronoiMorphoVorPower::dilation(CompressedVolume input, CompressedVolume &r
 
 	// 1st pass
 	Timer time_pass_1;
-#ifdef USE_TBB
-	auto firstpass = [&](const tbb::blocked_range<uint32_t> &range)
+	parallelFor(0, xsize, m_parallel, [&](int x_begin, int x_end)
 	{
+		// x-direction
 		VoronoiMorpho2D op_x(ysize, m_zmin, m_zmax, radius, input.spacing());
-		for (uint32_t phaseIdx = range.begin(); phaseIdx < range.end(); ++phaseIdx)
-		{
-			const uint32_t x = phaseIdx;
-#else
-			// x-direction
-			VoronoiMorpho2D op_x(ysize, m_zmin, m_zmax, radius, input.spacing());
-		for (int x = 0; x < xsize; x++) {
-#endif
+		for (int x = x_begin; x < x_end; x++) {
 			halfDilate(op_x, true, input, output1, x, 0, 0, +1);
 			op_x.resetData();
 			halfDilate(op_x, true, input, output2, x, ysize - 1, 0, -1);
 			op_x.resetData();
 		}
-#ifdef USE_TBB
-	};
-
-	tbb::blocked_range<uint32_t> rangex(0u, (uint32_t)xsize, GRAIN_SIZE);
-	tbb::parallel_for(rangex, firstpass);
-#endif
+	});
 
 	unionMap(output1, output2, mid_output);
 	time_1 = time_pass_1.get();
 
 	// 2nd pass
 	Timer time_pass_2;
-#ifdef USE_TBB
-	auto secondpass = [&](const tbb::blocked_range<uint32_t> &range)
+	parallelFor(0, ysize, m_parallel, [&](int y_begin, int y_end)
 	{
+		// y-direction
 		SeparatePowerMorpho2D op_y(xsize, m_zmin, m_zmax, input.spacing());
-		for (uint32_t phaseIdy = range.begin(); phaseIdy < range.end(); ++phaseIdy)
-		{
-			const uint32_t y = phaseIdy;
-#else
-		SeparatePowerMorpho2D op_y(xsize, m_zmin, m_zmax, input.spacing());
-		for(int y=0;y<ysize;y++) {
-#endif
-			//std::cout << y << std::endl;
+		for (int y = y_begin; y < y_end; y++) {
 			halfDilate(op_y, false, mid_output, output3, 0, y, +1, 0);
 			op_y.resetData();
 			halfDilate(op_y, false, mid_output, output4, xsize - 1, y, -1, 0);
 			op_y.resetData();
 		}
-#ifdef USE_TBB
-	};
-
-	tbb::blocked_range<uint32_t> rangey(0u, (uint32_t)ysize, GRAIN_SIZE);
-	tbb::parallel_for(rangey, secondpass);
-#endif
+	});
 
 	unionMap(output3, output4, result);
 	time_2 = time_pass_2.get();
@@ -1,15 +1,34 @@
 #pragma once
 
 #include"vor3d/Voronoi.h"
+#include"vor3d/PackedVolume.h"
+#include"vor3d/Parallel.h"
 
 namespace voroffset3d
 {
 	class VoronoiMorphoVorPower : public VoronoiMorpho
 	{
 	public:
-		virtual void dilation(CompressedVolume input, CompressedVolume &result, double radius, double &time_1, double &time_2) override;
+		VoronoiMorphoVorPower() = default;
+		explicit VoronoiMorphoVorPower(const ParallelOptions &options) : m_parallel(options) {}
+
+		virtual void dilation(const CompressedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2) override;
+		// Same as above, with the input's endpoints in one contiguous array
+		void dilation(const PackedVolume &input, CompressedVolume &result, double radius, double &time_1, double &time_2);
+
+		// Both sweep passes are split by rows across threads, each row writes only to its own dexels
+		void setParallelOptions(const ParallelOptions &options) { m_parallel = options; }
+		const ParallelOptions & parallelOptions() const { return m_parallel; }
 
 	private:
+		// Both layouts of the input are read through CompressedVolumeBase::iterate()
+		void dilate(const CompressedVolumeBase &input, CompressedVolume &result, double radius, double &time_1, double &time_2);
+
 		double m_zmin, m_zmax;
+		ParallelOptions m_parallel;
+
+		// Outputs of the forward and backward sweeps of each pass and the union of the first two
+		CompressedVolumeWithRadii m_output1, m_output2, m_midOutput;
+		CompressedVolume m_output3, m_output4;
 	};
 }
\ No newline at end of file